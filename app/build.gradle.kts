@@ -102,6 +102,11 @@ android {
     buildFeatures {
         viewBinding = true
     }
+
+    // Bundled tracks and ROMs are mapped straight from the APK, which needs them stored
+    androidResources {
+        noCompress += listOf("lmp", "nsf", "s3m", "rom")
+    }
 }
 
 dependencies {
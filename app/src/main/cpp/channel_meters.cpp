@@ -0,0 +1,135 @@
+/*
+ * channel_meters.cpp
+ *
+ * Per-channel peak/RMS accumulators. All accumulation happens on the render
+ * thread; the snapshot is taken from the same JNI-serialized engine, so the
+ * state needs no locking of its own.
+ */
+
+#include "channel_meters.h"
+
+#include <cmath>
+#include <cstdlib>
+
+struct ChannelMeter {
+  float peak;     // max |x| since last snapshot (0..1)
+  double sumSq;   // sum of x^2 since last snapshot
+  uint32_t count; // samples accumulated since last snapshot
+  float heldPeak; // level pushed by the backend (decays per snapshot)
+  float heldRms;
+  bool pushed; // true if this channel is fed via channel_meters_set_level
+};
+
+static ChannelMeter gMeters[METER_MAX_CHANNELS];
+static std::vector<std::string> gMeterLabels;
+static int gMeterCount = 0;
+
+// Release factor applied per snapshot (~30 fps) to backend-pushed levels
+static const float METER_PUSHED_DECAY = 0.80f;
+
+void channel_meters_configure(const std::vector<std::string> &labels) {
+  gMeterCount = (int)labels.size();
+  if (gMeterCount > METER_MAX_CHANNELS)
+    gMeterCount = METER_MAX_CHANNELS;
+  gMeterLabels.assign(labels.begin(), labels.begin() + gMeterCount);
+  for (int i = 0; i < METER_MAX_CHANNELS; i++)
+    gMeters[i] = ChannelMeter{0.0f, 0.0, 0, 0.0f, 0.0f, false};
+}
+
+void channel_meters_clear() {
+  std::vector<std::string> none;
+  channel_meters_configure(none);
+}
+
+int channel_meters_count() { return gMeterCount; }
+
+const std::string &channel_meters_label(int ch) {
+  static const std::string empty;
+  if (ch < 0 || ch >= gMeterCount)
+    return empty;
+  return gMeterLabels[ch];
+}
+
+void channel_meters_accumulate(int ch, const int16_t *samples, int count,
+                               int stride) {
+  if (ch < 0 || ch >= gMeterCount || count <= 0)
+    return;
+  ChannelMeter &m = gMeters[ch];
+  int peak = 0;
+  int64_t sumSq = 0;
+  for (int i = 0; i < count; i++) {
+    int s = samples[i * stride];
+    int a = s < 0 ? -s : s;
+    if (a > peak)
+      peak = a;
+    sumSq += (int64_t)s * s;
+  }
+  float p = (float)peak / 32768.0f;
+  if (p > m.peak)
+    m.peak = p;
+  m.sumSq += (double)sumSq / (32768.0 * 32768.0);
+  m.count += (uint32_t)count;
+}
+
+void channel_meters_accumulate_ring(int ch, const int16_t *ring, int ringSize,
+                                    int writeIdx, int count) {
+  if (count > ringSize)
+    count = ringSize;
+  if (count <= 0)
+    return;
+  int start = writeIdx - count;
+  if (start >= 0) {
+    channel_meters_accumulate(ch, ring + start, count, 1);
+  } else {
+    // Wrapped: tail of the ring, then the head up to writeIdx
+    channel_meters_accumulate(ch, ring + ringSize + start, -start, 1);
+    channel_meters_accumulate(ch, ring, writeIdx, 1);
+  }
+}
+
+void channel_meters_accumulate_sums(int ch, float peak, double sumSq,
+                                    uint32_t count) {
+  if (ch < 0 || ch >= gMeterCount || count == 0)
+    return;
+  ChannelMeter &m = gMeters[ch];
+  if (peak > m.peak)
+    m.peak = peak;
+  m.sumSq += sumSq;
+  m.count += count;
+}
+
+void channel_meters_set_level(int ch, float peak, float rms) {
+  if (ch < 0 || ch >= gMeterCount)
+    return;
+  ChannelMeter &m = gMeters[ch];
+  m.pushed = true;
+  if (peak > m.heldPeak)
+    m.heldPeak = peak;
+  if (rms > m.heldRms)
+    m.heldRms = rms;
+}
+
+int channel_meters_snapshot(float *out, int maxValues) {
+  int n = 0;
+  for (int ch = 0; ch < gMeterCount; ch++) {
+    if (n + METER_VALUES_PER_CH > maxValues)
+      break;
+    ChannelMeter &m = gMeters[ch];
+    float peak, rms;
+    if (m.pushed) {
+      peak = m.heldPeak;
+      rms = m.heldRms;
+      m.heldPeak *= METER_PUSHED_DECAY;
+      m.heldRms *= METER_PUSHED_DECAY;
+    } else {
+      peak = m.peak;
+      rms = m.count ? (float)std::sqrt(m.sumSq / (double)m.count) : 0.0f;
+      m.peak = 0.0f;
+      m.sumSq = 0.0;
+      m.count = 0;
+    }
+    out[n++] = peak > 1.0f ? 1.0f : peak;
+    out[n++] = rms > 1.0f ? 1.0f : rms;
+  }
+  return n;
+}
@@ -0,0 +1,58 @@
+/*
+ * channel_meters.h
+ *
+ * Lightweight per-channel peak/RMS metering shared by every backend.
+ * Backends feed raw per-channel taps (KSS ch_wave, master mix), push
+ * ready-made levels (libopenmpt channel VU) or add sums from a tap of their
+ * own (libvgm devices, see patches/libvgm-tap-device-levels.patch).
+ * Cores that mix their voices internally (gme, libADLMIDI) are metered on
+ * the master mix only.
+ * The UI collects everything with one packed snapshot per frame, which is
+ * orders of magnitude cheaper than running an FFT per channel.
+ */
+
+#ifndef CHANNEL_METERS_H
+#define CHANNEL_METERS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Upper bound on metered channels (module channels past it aren't metered)
+#define METER_MAX_CHANNELS 64
+
+// Values per channel in the packed snapshot: [peak, rms]
+#define METER_VALUES_PER_CH 2
+
+// Configure the meter set for a newly opened track. Resets all accumulators.
+void channel_meters_configure(const std::vector<std::string> &labels);
+
+// Drop all channels (no track loaded).
+void channel_meters_clear();
+
+int channel_meters_count();
+const std::string &channel_meters_label(int ch);
+
+// Accumulate |x| peak and x^2 sum from a strided int16 tap.
+void channel_meters_accumulate(int ch, const int16_t *samples, int count,
+                               int stride);
+
+// Accumulate from a 512-entry ring tap, reading the last `count` samples that
+// end at `writeIdx` (exclusive). Used for libkss ch_wave buffers.
+void channel_meters_accumulate_ring(int ch, const int16_t *ring, int ringSize,
+                                    int writeIdx, int count);
+
+// Add sums a backend took from its own tap: max |x| and sum of x^2 (both
+// in full scale units) over `count` samples.
+void channel_meters_accumulate_sums(int ch, float peak, double sumSq,
+                                    uint32_t count);
+
+// Push a ready-made level in 0..1 (peak and rms). Levels pushed this way
+// decay between snapshots instead of being reset.
+void channel_meters_set_level(int ch, float peak, float rms);
+
+// Write [peak, rms] per channel into `out` (capacity `maxValues` floats),
+// then reset the accumulators. Returns the number of floats written.
+int channel_meters_snapshot(float *out, int maxValues);
+
+#endif // CHANNEL_METERS_H
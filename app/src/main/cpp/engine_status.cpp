@@ -0,0 +1,57 @@
+/*
+ * engine_status.cpp
+ *
+ * Allocation, seqlock writer and event ring for the shared engine status block.
+ */
+
+#include "engine_status.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+static EngineStatusBlock *gStatusBlock = nullptr;
+
+EngineStatusBlock *engine_status_block() {
+  if (gStatusBlock)
+    return gStatusBlock;
+
+  void *mem = nullptr;
+  if (posix_memalign(&mem, 4096, sizeof(EngineStatusBlock)) != 0)
+    return nullptr;
+  memset(mem, 0, sizeof(EngineStatusBlock));
+
+  EngineStatusBlock *blk = new (mem) EngineStatusBlock();
+  blk->magic = ENGINE_STATUS_MAGIC;
+  blk->version = ENGINE_STATUS_VERSION;
+  blk->seq.store(0, std::memory_order_relaxed);
+  blk->eventWriteIdx.store(0, std::memory_order_relaxed);
+  blk->spectrumBins = STATUS_SPECTRUM_BINS;
+  gStatusBlock = blk;
+  return gStatusBlock;
+}
+
+void engine_status_begin_write(EngineStatusBlock *blk) {
+  uint32_t s = blk->seq.load(std::memory_order_relaxed);
+  blk->seq.store(s + 1, std::memory_order_relaxed);
+  // Make the odd sequence visible before any payload store
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void engine_status_end_write(EngineStatusBlock *blk) {
+  // Payload stores must land before the even sequence is published
+  std::atomic_thread_fence(std::memory_order_release);
+  uint32_t s = blk->seq.load(std::memory_order_relaxed);
+  blk->seq.store(s + 1, std::memory_order_release);
+}
+
+void engine_status_push_event(EngineStatusBlock *blk, int32_t type,
+                              int32_t arg, int64_t sample) {
+  uint32_t idx = blk->eventWriteIdx.load(std::memory_order_relaxed);
+  EngineEvent &evt = blk->events[idx & (STATUS_EVENT_CAPACITY - 1)];
+  evt.type = type;
+  evt.arg = arg;
+  evt.sample = sample;
+  // Publish the slot contents before the new index
+  blk->eventWriteIdx.store(idx + 1, std::memory_order_release);
+}
@@ -0,0 +1,127 @@
+/*
+ * engine_status.h
+ *
+ * Native-owned status block shared with Kotlin as a direct ByteBuffer.
+ * The render thread publishes position, end state, channel levels and output
+ * loudness meters after every buffer, and the spectra at most 30 times a
+ * second; UI threads read the block without taking a lock. Consistency is
+ * guaranteed by a seqlock: `seq` is odd while a write is in progress, and
+ * readers retry until they see the same even value before and after copying.
+ *
+ * Engine events (loop point, end of stream, underrun, PSF generation ready,
+ * track change, crossfade overload) go through a separate single-producer
+ * ring at the end of the block. The producer fills a slot and then advances
+ * `eventWriteIdx` with release semantics; the reader keeps its own index, so
+ * events are never lost to a later status update and carry the exact sample
+ * they happened at.
+ *
+ * The layout is fixed and mirrored in engine/EngineStatus.kt. Scalars live in
+ * the 256-byte header so new fields can be added without moving the arrays.
+ */
+
+#ifndef ENGINE_STATUS_H
+#define ENGINE_STATUS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#define ENGINE_STATUS_MAGIC 0x534D4756 // "VGMS"
+#define ENGINE_STATUS_VERSION 4
+
+#define STATUS_SPECTRUM_BINS 512
+#define STATUS_MAX_LEVELS 128           // METER_MAX_CHANNELS * [peak, rms]
+#define STATUS_MAX_CHANNEL_SPECTRUM 1024 // 64 channels * 16 bands
+
+// flags
+#define STATUS_FLAG_LOADED 0x01
+#define STATUS_FLAG_ENDED 0x02
+#define STATUS_FLAG_PSF_READY 0x04
+
+// Event ring (power of two)
+#define STATUS_EVENT_CAPACITY 64
+
+enum EngineEventType {
+  ENGINE_EVENT_LOOP = 1,      // arg = loops completed so far; sample =
+                              // where the loop point is heard
+  ENGINE_EVENT_END = 2,       // end of stream; sample = last rendered frame
+  ENGINE_EVENT_UNDERRUN = 3,  // arg = frames missing from the request
+  ENGINE_EVENT_PSF_READY = 4, // PSF generation produced its initial buffer
+  ENGINE_EVENT_TRACK_CHANGED = 5, // prepared next track took over; sample =
+                                  // its position (> 0 after a crossfade)
+  ENGINE_EVENT_XFADE_OVERLOAD = 6, // arg = % of real time two decoders need
+};
+
+// `sample` is in track time, like the current and total sample counts: the
+// position in the song, not a count of output frames. With the time stretch
+// on, one output frame covers `speed` track samples; consumers that need
+// output time divide by the speed.
+struct EngineEvent {
+  int32_t type;
+  int32_t arg;
+  int64_t sample; // track sample position the event refers to
+};
+
+struct EngineStatusBlock {
+  uint32_t magic;             // 0
+  uint32_t version;           // 4
+  std::atomic<uint32_t> seq;  // 8   odd while the writer is active
+  uint32_t flags;             // 12
+  int64_t currentSample;      // 16
+  int64_t totalSamples;       // 24
+  int32_t sampleRate;         // 32
+  int32_t playerType;         // 36
+  uint32_t underruns;         // 40  short renders while not ended
+  uint32_t fillCount;         // 44  nFillBuffer calls since open
+  int32_t spectrumBins;       // 48
+  int32_t levelCount;         // 52  floats valid in levels[]
+  int32_t channelSpectrumLen; // 56  floats valid in channelSpectrum[]
+  std::atomic<uint32_t> eventWriteIdx; // 60  total events ever pushed
+  float limiterReductionDb;            // 64  current gain reduction, dB >= 0
+  float limiterMaxReductionDb;         // 68  deepest reduction this song
+  uint32_t limiterEngagements;         // 72  times the limiter kicked in
+  uint32_t reserved76;                 // 76
+  int64_t limiterFrames;               // 80  frames through the limiter
+  int64_t limiterLimitedFrames;        // 88  of which with gain < 1
+  float momentaryLufs;                 // 96  output loudness, last 400 ms
+  float shortTermLufs;                 // 100 last 3 s
+  float integratedLufs;                // 104 this song, gated
+  float truePeakDb;                    // 108 last 400 ms, dBTP
+  float maxTruePeakDb;                 // 112 this song
+  float correlation;                   // 116 -1 .. +1
+  uint8_t reservedHeader[256 - 120];
+
+  float spectrum[STATUS_SPECTRUM_BINS];              // 256
+  float levels[STATUS_MAX_LEVELS];                   // 2304
+  float channelSpectrum[STATUS_MAX_CHANNEL_SPECTRUM]; // 2816
+
+  EngineEvent events[STATUS_EVENT_CAPACITY]; // 6912
+};
+
+static_assert(offsetof(EngineStatusBlock, currentSample) == 16,
+              "status layout");
+static_assert(offsetof(EngineStatusBlock, spectrum) == 256, "status layout");
+static_assert(offsetof(EngineStatusBlock, levels) == 2304, "status layout");
+static_assert(offsetof(EngineStatusBlock, channelSpectrum) == 2816,
+              "status layout");
+static_assert(offsetof(EngineStatusBlock, eventWriteIdx) == 60,
+              "status layout");
+static_assert(offsetof(EngineStatusBlock, limiterLimitedFrames) == 88,
+              "status layout");
+static_assert(offsetof(EngineStatusBlock, correlation) == 116,
+              "status layout");
+static_assert(offsetof(EngineStatusBlock, events) == 6912, "status layout");
+
+// Lazily allocated, page-aligned, lives for the whole process.
+EngineStatusBlock *engine_status_block();
+
+// Writer side of the seqlock. Only the render/engine thread writes.
+void engine_status_begin_write(EngineStatusBlock *blk);
+void engine_status_end_write(EngineStatusBlock *blk);
+
+// Append an event to the ring. Same single writer as the status fields; the
+// oldest entry is overwritten if the reader falls a full ring behind.
+void engine_status_push_event(EngineStatusBlock *blk, int32_t type,
+                              int32_t arg, int64_t sample);
+
+#endif // ENGINE_STATUS_H
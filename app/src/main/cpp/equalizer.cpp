@@ -0,0 +1,222 @@
+/*
+ * equalizer.cpp
+ *
+ * Biquad cascade in transposed direct form II, vectorised across the two
+ * stereo channels.
+ */
+
+#include "equalizer.h"
+
+#include <cmath>
+#include <cstring>
+
+// Two-lane float vector (L, R). The compiler maps it to NEON / SSE.
+typedef float v2f __attribute__((vector_size(8)));
+
+struct Coeffs {
+  float b0, b1, b2, a1, a2; // normalised by a0
+};
+
+struct Band {
+  int type = EQ_PEAKING;
+  float freq = 1000.0f;
+  float gainDb = 0.0f;
+  float q = 0.707f;
+
+  Coeffs target = {1, 0, 0, 0, 0};
+  Coeffs cur = {1, 0, 0, 0, 0};
+  Coeffs step = {0, 0, 0, 0, 0};
+  int rampLeft = 0;
+
+  v2f z1 = {0, 0};
+  v2f z2 = {0, 0};
+};
+
+static Band gBands[EQ_MAX_BANDS];
+static int gRate = 44100;
+static bool gEnabled = true;
+
+static bool isFlat(const Coeffs &c) {
+  return c.b0 == 1.0f && c.b1 == 0.0f && c.b2 == 0.0f && c.a1 == 0.0f &&
+         c.a2 == 0.0f;
+}
+
+static Coeffs designBand(const Band &b) {
+  Coeffs c = {1, 0, 0, 0, 0};
+  if (!gEnabled || b.gainDb == 0.0f || b.freq <= 0.0f ||
+      b.freq >= gRate * 0.5f)
+    return c;
+
+  double A = std::pow(10.0, b.gainDb / 40.0);
+  double w0 = 2.0 * M_PI * b.freq / gRate;
+  double cw = std::cos(w0);
+  double alpha = std::sin(w0) / (2.0 * (b.q > 0.01f ? b.q : 0.01f));
+  double b0, b1, b2, a0, a1, a2;
+
+  if (b.type == EQ_PEAKING) {
+    b0 = 1 + alpha * A;
+    b1 = -2 * cw;
+    b2 = 1 - alpha * A;
+    a0 = 1 + alpha / A;
+    a1 = -2 * cw;
+    a2 = 1 - alpha / A;
+  } else {
+    double sq = 2 * std::sqrt(A) * alpha;
+    if (b.type == EQ_LOW_SHELF) {
+      b0 = A * ((A + 1) - (A - 1) * cw + sq);
+      b1 = 2 * A * ((A - 1) - (A + 1) * cw);
+      b2 = A * ((A + 1) - (A - 1) * cw - sq);
+      a0 = (A + 1) + (A - 1) * cw + sq;
+      a1 = -2 * ((A - 1) + (A + 1) * cw);
+      a2 = (A + 1) + (A - 1) * cw - sq;
+    } else {
+      b0 = A * ((A + 1) + (A - 1) * cw + sq);
+      b1 = -2 * A * ((A - 1) + (A + 1) * cw);
+      b2 = A * ((A + 1) + (A - 1) * cw - sq);
+      a0 = (A + 1) - (A - 1) * cw + sq;
+      a1 = 2 * ((A - 1) - (A + 1) * cw);
+      a2 = (A + 1) - (A - 1) * cw - sq;
+    }
+  }
+  c.b0 = (float)(b0 / a0);
+  c.b1 = (float)(b1 / a0);
+  c.b2 = (float)(b2 / a0);
+  c.a1 = (float)(a1 / a0);
+  c.a2 = (float)(a2 / a0);
+  return c;
+}
+
+// Recompute the band's target and start gliding towards it.
+static void retarget(Band &b, bool ramp) {
+  b.target = designBand(b);
+  if (!ramp) {
+    b.cur = b.target;
+    b.rampLeft = 0;
+    return;
+  }
+  float inv = 1.0f / EQ_RAMP_FRAMES;
+  b.step.b0 = (b.target.b0 - b.cur.b0) * inv;
+  b.step.b1 = (b.target.b1 - b.cur.b1) * inv;
+  b.step.b2 = (b.target.b2 - b.cur.b2) * inv;
+  b.step.a1 = (b.target.a1 - b.cur.a1) * inv;
+  b.step.a2 = (b.target.a2 - b.cur.a2) * inv;
+  b.rampLeft = EQ_RAMP_FRAMES;
+}
+
+void eq_set_sample_rate(int rate) {
+  if (rate <= 0 || rate == gRate)
+    return;
+  gRate = rate;
+  for (Band &b : gBands)
+    retarget(b, false);
+}
+
+bool eq_set_band(int band, int type, float freqHz, float gainDb, float q) {
+  if (band < 0 || band >= EQ_MAX_BANDS || type < EQ_LOW_SHELF ||
+      type > EQ_HIGH_SHELF)
+    return false;
+  Band &b = gBands[band];
+  b.type = type;
+  b.freq = freqHz;
+  b.gainDb = gainDb;
+  b.q = q;
+  retarget(b, true);
+  return true;
+}
+
+void eq_set_enabled(bool enabled) {
+  if (enabled == gEnabled)
+    return;
+  gEnabled = enabled;
+  for (Band &b : gBands)
+    retarget(b, true);
+}
+
+bool eq_enabled() { return gEnabled; }
+
+bool eq_active() {
+  for (const Band &b : gBands) {
+    if (b.rampLeft > 0 || !isFlat(b.cur))
+      return true;
+  }
+  return false;
+}
+
+// Glide part of the block: coefficients advance every frame.
+static int processRamp(Band &b, float *x, int frames) {
+  int n = frames < b.rampLeft ? frames : b.rampLeft;
+  v2f z1 = b.z1, z2 = b.z2;
+  for (int i = 0; i < n; i++) {
+    b.cur.b0 += b.step.b0;
+    b.cur.b1 += b.step.b1;
+    b.cur.b2 += b.step.b2;
+    b.cur.a1 += b.step.a1;
+    b.cur.a2 += b.step.a2;
+    v2f in = {x[i * 2], x[i * 2 + 1]};
+    v2f out = in * b.cur.b0 + z1;
+    z1 = in * b.cur.b1 - out * b.cur.a1 + z2;
+    z2 = in * b.cur.b2 - out * b.cur.a2;
+    x[i * 2] = out[0];
+    x[i * 2 + 1] = out[1];
+  }
+  b.z1 = z1;
+  b.z2 = z2;
+  b.rampLeft -= n;
+  if (b.rampLeft == 0)
+    b.cur = b.target; // land exactly, so flat bands become bypassable
+  return n;
+}
+
+// Steady part: fixed coefficients held in vector registers.
+static void processSteady(Band &b, float *x, int frames) {
+  const v2f b0 = {b.cur.b0, b.cur.b0};
+  const v2f b1 = {b.cur.b1, b.cur.b1};
+  const v2f b2 = {b.cur.b2, b.cur.b2};
+  const v2f a1 = {b.cur.a1, b.cur.a1};
+  const v2f a2 = {b.cur.a2, b.cur.a2};
+  v2f z1 = b.z1, z2 = b.z2;
+  for (int i = 0; i < frames; i++) {
+    v2f in;
+    memcpy(&in, x + i * 2, sizeof(in));
+    v2f out = b0 * in + z1;
+    z1 = b1 * in - a1 * out + z2;
+    z2 = b2 * in - a2 * out;
+    memcpy(x + i * 2, &out, sizeof(out));
+  }
+  // Flush denormals from the decaying state
+  for (int c = 0; c < 2; c++) {
+    if (std::fabs(z1[c]) < 1e-20f)
+      z1[c] = 0.0f;
+    if (std::fabs(z2[c]) < 1e-20f)
+      z2[c] = 0.0f;
+  }
+  b.z1 = z1;
+  b.z2 = z2;
+}
+
+void eq_process(float *interleaved, int frames) {
+  for (Band &b : gBands) {
+    if (b.rampLeft == 0 && isFlat(b.cur))
+      continue;
+    float *x = interleaved;
+    int left = frames;
+    if (b.rampLeft > 0) {
+      int done = processRamp(b, x, left);
+      x += done * 2;
+      left -= done;
+    }
+    if (left > 0 && !isFlat(b.cur))
+      processSteady(b, x, left);
+    else if (isFlat(b.cur)) {
+      b.z1 = v2f{0, 0};
+      b.z2 = v2f{0, 0};
+    }
+  }
+}
+
+void eq_reset() {
+  for (Band &b : gBands) {
+    b.z1 = v2f{0, 0};
+    b.z2 = v2f{0, 0};
+  }
+}
@@ -0,0 +1,48 @@
+/*
+ * equalizer.h
+ *
+ * Parametric equalizer for the engine's float effects chain: up to
+ * EQ_MAX_BANDS low-shelf / peaking / high-shelf biquads (RBJ cookbook) run as
+ * a cascade over interleaved stereo blocks, both channels in one two-lane
+ * vector. Coefficients are only recomputed when a band changes; the filter
+ * then glides to them over EQ_RAMP_FRAMES so parameter changes don't click.
+ * Flat bands are skipped, so an idle EQ costs nothing.
+ *
+ * Called from the JNI thread only, like the rest of the engine.
+ */
+
+#ifndef EQUALIZER_H
+#define EQUALIZER_H
+
+#define EQ_MAX_BANDS 8
+
+// Frames over which coefficients move to new targets
+#define EQ_RAMP_FRAMES 512
+
+enum EqBandType {
+  EQ_LOW_SHELF = 0,
+  EQ_PEAKING = 1,
+  EQ_HIGH_SHELF = 2,
+};
+
+void eq_set_sample_rate(int rate);
+
+// Configure one band. gainDb == 0 makes it flat (bypassed). q is the peaking
+// bandwidth or the shelf slope (0.707 = Butterworth). Returns false for an
+// invalid band index or type.
+bool eq_set_band(int band, int type, float freqHz, float gainDb, float q);
+
+// Master switch; disabling glides every band to flat.
+void eq_set_enabled(bool enabled);
+bool eq_enabled();
+
+// True while any band is non-flat or still ramping.
+bool eq_active();
+
+// Filter `frames` interleaved stereo frames in place.
+void eq_process(float *interleaved, int frames);
+
+// Clear the filter history (after a discontinuity such as a seek).
+void eq_reset();
+
+#endif // EQUALIZER_H
@@ -0,0 +1,217 @@
+/*
+ * limiter.cpp
+ *
+ * Three rotating blocks: the one being played, the next one (peak known) and
+ * the one being filled. Gains for a block are decided when the block after it
+ * has been filled.
+ */
+
+#include "limiter.h"
+
+#include <android/log.h>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#define LOGD(...)                                                              \
+  __android_log_print(ANDROID_LOG_DEBUG, "VgmLimiter", __VA_ARGS__)
+
+// Inter-sample points estimated per frame in true-peak mode (4x oversampling)
+#define TP_PHASES 3
+#define TP_TAPS 8
+// Frames of the previous block kept for the interpolator
+#define TP_HISTORY (TP_TAPS - 1)
+
+static int gRate = 44100;
+static bool gTruePeak = false;
+
+static int gBlock = 0; // frames per block
+static std::vector<float> gBuf; // 3 blocks, interleaved stereo
+static int gPlay = 0, gNext = 1, gFill = 2; // block indices into gBuf
+static int gPos = 0;                        // frame within the blocks
+static float gGainFrom = 1.0f; // gain ramp across the block being played
+static float gGainTo = 1.0f;
+static float gNextTarget = 1.0f; // largest gain the next block allows
+static float gRelease = 0.0f;    // per-block release factor
+
+static float gTpCoef[TP_PHASES][TP_TAPS];
+
+static LimiterStats gStats;
+
+static float *block(int idx) { return gBuf.data() + (size_t)idx * gBlock * 2; }
+
+static void configure() {
+  gBlock = (int)(LIMITER_LOOKAHEAD_MS * gRate / 1000.0f + 0.5f);
+  if (gBlock < TP_TAPS)
+    gBlock = TP_TAPS;
+  gBuf.assign((size_t)gBlock * 2 * 3, 0.0f);
+  gRelease = std::exp(-(float)gBlock / (LIMITER_RELEASE_MS * gRate / 1000.0f));
+
+  // Windowed-sinc interpolators for the points 1/4, 2/4 and 3/4 of the way
+  // from frame n to n+1, using frames n-3..n+4
+  for (int p = 0; p < TP_PHASES; p++) {
+    float frac = (p + 1) / 4.0f;
+    float sum = 0.0f;
+    for (int j = 0; j < TP_TAPS; j++) {
+      float t = (float)(j - 3) - frac;
+      float sinc = std::sin((float)M_PI * t) / ((float)M_PI * t);
+      float win = 0.5f + 0.5f * std::cos((float)M_PI * t / 4.5f);
+      gTpCoef[p][j] = sinc * win;
+      sum += gTpCoef[p][j];
+    }
+    for (int j = 0; j < TP_TAPS; j++)
+      gTpCoef[p][j] /= sum;
+  }
+  limiter_reset();
+}
+
+void limiter_set_sample_rate(int rate) {
+  if (rate <= 0 || rate == gRate)
+    return;
+  gRate = rate;
+  if (!gBuf.empty())
+    configure();
+}
+
+void limiter_set_true_peak(bool enabled) { gTruePeak = enabled; }
+bool limiter_true_peak() { return gTruePeak; }
+
+int limiter_latency() {
+  if (gBuf.empty())
+    configure();
+  return gBlock * 2;
+}
+
+void limiter_reset() {
+  if (!gBuf.empty())
+    memset(gBuf.data(), 0, gBuf.size() * sizeof(float));
+  gPlay = 0;
+  gNext = 1;
+  gFill = 2;
+  gPos = 0;
+  gGainFrom = 1.0f;
+  gGainTo = 1.0f;
+  gNextTarget = 1.0f;
+}
+
+void limiter_reset_stats() {
+  if (gStats.frames > 0)
+    LOGD("song done: limited %.1f%% of frames, %u engagements, max %.1f dB",
+         100.0 * gStats.limitedFrames / gStats.frames, gStats.engagements,
+         gStats.maxReductionDb);
+  float current = gStats.reductionDb;
+  gStats = LimiterStats();
+  gStats.reductionDb = current;
+}
+
+void limiter_get_stats(LimiterStats *out) { *out = gStats; }
+
+static float gainToDb(float g) { return g < 1.0f ? -20.0f * std::log10(g) : 0; }
+
+// Estimated true peak of one channel of `b`, with `prev` supplying the
+// interpolator's history. Points in the last few frames of `prev` count
+// towards this block.
+static float truePeak(const float *prev, const float *b, int c, float peak) {
+  float x[TP_HISTORY + 1024];
+  int n = gBlock < 1024 ? gBlock : 1024;
+  for (int i = 0; i < TP_HISTORY; i++)
+    x[i] = prev[(gBlock - TP_HISTORY + i) * 2 + c];
+  for (int i = 0; i < n; i++)
+    x[TP_HISTORY + i] = b[i * 2 + c];
+  for (int i = 3; i + 4 < TP_HISTORY + n; i++) {
+    const float *s = x + i - 3;
+    for (int p = 0; p < TP_PHASES; p++) {
+      float y = 0.0f;
+      for (int j = 0; j < TP_TAPS; j++)
+        y += s[j] * gTpCoef[p][j];
+      y = std::fabs(y);
+      if (y > peak)
+        peak = y;
+    }
+  }
+  return peak;
+}
+
+// Largest gain that keeps block `b` under the ceiling.
+static float blockTarget(const float *prev, const float *b) {
+  float peak = 0.0f;
+  for (int i = 0; i < gBlock * 2; i++) {
+    float a = std::fabs(b[i]);
+    if (a > peak)
+      peak = a;
+  }
+  // Inter-sample overs stay well below 6 dB on real material
+  if (gTruePeak && peak > LIMITER_CEILING * 0.5f) {
+    peak = truePeak(prev, b, 0, peak);
+    peak = truePeak(prev, b, 1, peak);
+  }
+  return peak > LIMITER_CEILING ? LIMITER_CEILING / peak : 1.0f;
+}
+
+// The block being filled is complete: it becomes the next block, the next
+// block starts playing, and its gain ramp is decided.
+static void rotate() {
+  float target = blockTarget(block(gNext), block(gFill));
+
+  float from = gGainTo;
+  float to = 1.0f - (1.0f - from) * gRelease;
+  if (to > 0.9999f)
+    to = 1.0f;
+  if (to > gNextTarget)
+    to = gNextTarget;
+  if (to > target)
+    to = target;
+
+  int played = gPlay;
+  gPlay = gNext;
+  gNext = gFill;
+  gFill = played;
+  gGainFrom = from;
+  gGainTo = to;
+  gNextTarget = target;
+
+  gStats.frames += gBlock;
+  if (from < 1.0f || to < 1.0f) {
+    gStats.limitedFrames += gBlock;
+    if (from == 1.0f)
+      gStats.engagements++;
+  }
+  float low = from < to ? from : to;
+  gStats.reductionDb = gainToDb(to);
+  if (gainToDb(low) > gStats.maxReductionDb)
+    gStats.maxReductionDb = gainToDb(low);
+}
+
+void limiter_process(float *interleaved, int frames) {
+  if (gBuf.empty())
+    configure();
+
+  float *x = interleaved;
+  while (frames > 0) {
+    int n = gBlock - gPos;
+    if (n > frames)
+      n = frames;
+
+    memcpy(block(gFill) + gPos * 2, x, (size_t)n * 2 * sizeof(float));
+    const float *out = block(gPlay) + gPos * 2;
+    if (gGainFrom == 1.0f && gGainTo == 1.0f) {
+      memcpy(x, out, (size_t)n * 2 * sizeof(float));
+    } else {
+      float step = (gGainTo - gGainFrom) / gBlock;
+      float g = gGainFrom + step * gPos;
+      for (int i = 0; i < n; i++) {
+        x[i * 2] = out[i * 2] * g;
+        x[i * 2 + 1] = out[i * 2 + 1] * g;
+        g += step;
+      }
+    }
+
+    x += n * 2;
+    frames -= n;
+    gPos += n;
+    if (gPos == gBlock) {
+      gPos = 0;
+      rotate();
+    }
+  }
+}
@@ -0,0 +1,61 @@
+/*
+ * limiter.h
+ *
+ * Lookahead brickwall limiter at the end of the engine's float effects chain.
+ * Audio is delayed by two blocks of LIMITER_LOOKAHEAD_MS. The peak of each
+ * block is known before any of it is played. Gain is computed once per block
+ * and ramped linearly across the block before it. The ramp ends at or below
+ * what the loudest block it touches allows, so no sample leaves above
+ * LIMITER_CEILING. Release is exponential.
+ *
+ * Blocks whose peak is below the ceiling, played while the gain is already
+ * at unity, are only copied through the delay. Most material costs one peak
+ * scan. The optional true-peak mode also estimates inter-sample peaks with
+ * 4x polyphase interpolation, so the DAC's reconstruction doesn't clip.
+ *
+ * Called from the JNI thread only, like the rest of the engine.
+ */
+
+#ifndef LIMITER_H
+#define LIMITER_H
+
+#include <cstdint>
+
+// Output ceiling, -0.3 dBFS
+#define LIMITER_CEILING 0.966f
+
+// Block length; the total delay is twice this
+#define LIMITER_LOOKAHEAD_MS 1.5f
+
+// Time for the gain to recover by 1/e
+#define LIMITER_RELEASE_MS 80.0f
+
+struct LimiterStats {
+  int64_t frames;        // frames processed since the last stats reset
+  int64_t limitedFrames; // of which played with gain below unity
+  uint32_t engagements;  // times the gain left unity
+  float maxReductionDb;  // deepest reduction, positive dB
+  float reductionDb;     // current reduction, positive dB
+};
+
+void limiter_set_sample_rate(int rate);
+
+void limiter_set_true_peak(bool enabled);
+bool limiter_true_peak();
+
+// Limit an interleaved stereo float block in place. Output lags input by
+// twice the lookahead.
+void limiter_process(float *interleaved, int frames);
+
+// Frames the output lags the input by. Feeding this many frames of silence
+// plays out the delay line.
+int limiter_latency();
+
+// Clear the delay line and return to unity gain.
+void limiter_reset();
+
+// Per-song counters; the gain state is left alone.
+void limiter_reset_stats();
+void limiter_get_stats(LimiterStats *out);
+
+#endif // LIMITER_H
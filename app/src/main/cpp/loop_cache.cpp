@@ -0,0 +1,248 @@
+/*
+ * loop_cache.cpp
+ *
+ * Capture, seam search and playback of the cached loop body. Runs on the
+ * JNI render thread only.
+ */
+
+#include "loop_cache.h"
+
+#include <android/log.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define LOGD(...)                                                              \
+  __android_log_print(ANDROID_LOG_DEBUG, "VgmLoopCache", __VA_ARGS__)
+
+enum class LoopCacheState { IDLE, CAPTURING, READY, FAILED };
+
+static LoopCacheState gState = LoopCacheState::IDLE;
+static std::vector<int16_t> gPcm; // interleaved stereo, captured from gStart
+static int64_t gStart = 0;
+static int64_t gApproxLen = -1;
+static int64_t gMargin = 0;
+static int64_t gLength = 0; // verified loop length in frames
+static int64_t gMaxFrames = 0;
+static int64_t gWindowLimit = 0; // frames past gStart searched for a window
+// Seam search, resumed on every feed
+static int64_t gWindow = -1; // compared window, frames past gStart
+static int64_t gWindowScan = 0;
+static int64_t gCandidate = 0;
+static int64_t gBest = -1;
+static int64_t gBestSum = -1;
+
+void loop_cache_reset() {
+  gState = LoopCacheState::IDLE;
+  gPcm.clear();
+  gPcm.shrink_to_fit();
+  gStart = 0;
+  gApproxLen = -1;
+  gMargin = 0;
+  gLength = 0;
+  gWindow = -1;
+  gWindowScan = 0;
+  gCandidate = 0;
+  gBest = -1;
+  gBestSum = -1;
+}
+
+static void tryVerify();
+
+static void fail(const char *why) {
+  LOGD("loop cache disabled: %s", why);
+  gState = LoopCacheState::FAILED;
+  gPcm.clear();
+  gPcm.shrink_to_fit();
+}
+
+void loop_cache_begin(int64_t loopStart, int64_t approxLen, int64_t margin,
+                      int sampleRate) {
+  loop_cache_reset();
+  gMaxFrames = (int64_t)LOOP_CACHE_MAX_SECONDS * sampleRate;
+  gWindowLimit = (int64_t)LOOP_CACHE_WINDOW_SECONDS * sampleRate;
+  gStart = loopStart;
+  gState = LoopCacheState::CAPTURING;
+  if (approxLen >= 0)
+    loop_cache_set_length(approxLen, margin);
+}
+
+void loop_cache_set_length(int64_t approxLen, int64_t margin) {
+  if (gState != LoopCacheState::CAPTURING)
+    return;
+  if (approxLen <= margin + LOOP_CACHE_VERIFY_FRAMES) {
+    fail("loop too short");
+    return;
+  }
+  if (approxLen + margin > gMaxFrames) {
+    fail("loop too long");
+    return;
+  }
+  gApproxLen = approxLen;
+  gMargin = margin;
+  int64_t room = gMaxFrames - (approxLen + margin + LOOP_CACHE_VERIFY_FRAMES);
+  if (gWindowLimit > room)
+    gWindowLimit = room > 0 ? room : 0;
+  gPcm.reserve((size_t)(approxLen + margin + LOOP_CACHE_VERIFY_FRAMES +
+                        gWindowLimit) *
+               2);
+  // Late-reported lengths may already have enough audio captured
+  tryVerify();
+}
+
+bool loop_cache_capturing() { return gState == LoopCacheState::CAPTURING; }
+bool loop_cache_ready() { return gState == LoopCacheState::READY; }
+bool loop_cache_failed() { return gState == LoopCacheState::FAILED; }
+int64_t loop_cache_start() { return gStart; }
+int64_t loop_cache_length() { return gLength; }
+
+// Frames to capture: the compared window one loop (plus margin) later, or
+// as far as a window may be looked for while none is found yet.
+static int64_t captureWanted() {
+  int64_t window = gWindow >= 0 ? gWindow : gWindowLimit;
+  return window + gApproxLen + gMargin + LOOP_CACHE_VERIFY_FRAMES;
+}
+
+// Look for a window loud enough to compare, in half-window steps from
+// where the last call stopped. Sets gWindow if one is found.
+static void findWindow(int64_t captured) {
+  const int64_t step = LOOP_CACHE_VERIFY_FRAMES / 2;
+  const int64_t minSum =
+      (int64_t)LOOP_CACHE_MIN_LEVEL * LOOP_CACHE_VERIFY_FRAMES * 2;
+  for (; gWindowScan <= gWindowLimit; gWindowScan += step) {
+    if (gWindowScan + gApproxLen + gMargin + LOOP_CACHE_VERIFY_FRAMES >
+        captured)
+      return;
+    const int16_t *w = gPcm.data() + gWindowScan * 2;
+    int64_t sum = 0;
+    for (int i = 0; i < LOOP_CACHE_VERIFY_FRAMES * 2; i++)
+      sum += std::abs((int)w[i]);
+    if (sum >= minSum) {
+      gWindow = gWindowScan;
+      return;
+    }
+  }
+}
+
+// Candidate `k` of the seam search: gApproxLen, then alternately one frame
+// shorter and longer, out to gMargin either side.
+static int64_t candidateLength(int64_t k) {
+  return gApproxLen + ((k & 1) ? -(k + 1) / 2 : k / 2);
+}
+
+// Compare the window with the audio one candidate length later, for up to
+// LOOP_CACHE_SEAM_CANDIDATES candidates. The closest length with the lowest
+// difference wins. Returns false while candidates are left.
+static bool searchSeam() {
+  const int16_t *a = gPcm.data() + gWindow * 2;
+  int64_t last = std::min<int64_t>(gCandidate + LOOP_CACHE_SEAM_CANDIDATES,
+                                   2 * gMargin + 1);
+  for (; gCandidate < last && gBestSum != 0; gCandidate++) {
+    int64_t d = candidateLength(gCandidate);
+    if (d <= 0)
+      continue;
+    const int16_t *b = a + d * 2;
+    int64_t sum = 0;
+    bool ok = true;
+    for (int i = 0; i < LOOP_CACHE_VERIFY_FRAMES * 2; i++) {
+      int diff = std::abs((int)a[i] - (int)b[i]);
+      sum += diff;
+      // Ties go to the earlier, closer candidate
+      if (diff > LOOP_CACHE_SEAM_TOLERANCE ||
+          (gBestSum >= 0 && sum >= gBestSum)) {
+        ok = false;
+        break;
+      }
+    }
+    if (ok) {
+      gBest = d;
+      gBestSum = sum;
+    }
+  }
+  return gCandidate > 2 * gMargin || gBestSum == 0;
+}
+
+// Once a loud enough window and the same window one loop later are
+// captured, locate the seam and switch to cached playback.
+static void tryVerify() {
+  int64_t captured = (int64_t)gPcm.size() / 2;
+  if (gWindow < 0) {
+    findWindow(captured);
+    if (gWindow < 0) {
+      if (captured >= captureWanted())
+        fail("loop start too quiet");
+      return;
+    }
+  }
+  if (captured < captureWanted() || !searchSeam())
+    return;
+
+  if (gBest < 0) {
+    fail("seam mismatch");
+    return;
+  }
+  int64_t seam = gBest;
+  gLength = seam;
+  gPcm.resize((size_t)seam * 2);
+  gPcm.shrink_to_fit();
+  gState = LoopCacheState::READY;
+  LOGD("loop cache ready: start=%lld length=%lld (approx %lld, window %lld)",
+       (long long)gStart, (long long)gLength, (long long)gApproxLen,
+       (long long)gWindow);
+}
+
+void loop_cache_feed(const int16_t *frames, int count, int64_t startSample) {
+  if (gState != LoopCacheState::CAPTURING || count <= 0)
+    return;
+
+  int64_t captured = (int64_t)gPcm.size() / 2;
+  int64_t want = gApproxLen >= 0 ? captureWanted() : gMaxFrames;
+  // Once enough is captured, later buffers only advance the seam search
+  if (captured < want) {
+    int64_t expectedPos = gStart + captured;
+    int64_t end = startSample + count;
+    if (end <= expectedPos)
+      return;
+    if (startSample > expectedPos) {
+      // A gap (seek or dropped buffer) breaks the capture
+      fail("capture interrupted");
+      return;
+    }
+    int64_t skip = expectedPos - startSample;
+    int64_t take = end - expectedPos;
+    if (captured + take > want)
+      take = want - captured;
+    gPcm.insert(gPcm.end(), frames + skip * 2, frames + (skip + take) * 2);
+    captured += take;
+  }
+
+  if (gApproxLen < 0) {
+    if (captured >= gMaxFrames)
+      fail("loop length never reported");
+    return;
+  }
+  tryVerify();
+}
+
+int64_t loop_cache_equivalent(int64_t sample) {
+  if (gState != LoopCacheState::READY || sample < gStart || gLength <= 0)
+    return sample;
+  return gStart + (sample - gStart) % gLength;
+}
+
+int loop_cache_read(int16_t *dst, int frames, int64_t startSample) {
+  if (gState != LoopCacheState::READY || startSample < gStart)
+    return 0;
+  int64_t offset = (startSample - gStart) % gLength;
+  int done = 0;
+  while (done < frames) {
+    int64_t avail = gLength - offset;
+    int chunk = (int)((frames - done) < avail ? (frames - done) : avail);
+    memcpy(dst + done * 2, gPcm.data() + offset * 2,
+           (size_t)chunk * 2 * sizeof(int16_t));
+    done += chunk;
+    offset = 0;
+  }
+  return done;
+}
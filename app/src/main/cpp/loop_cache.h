@@ -0,0 +1,74 @@
+/*
+ * loop_cache.h
+ *
+ * PCM cache of a track's loop body for endless-loop playback. While the
+ * emulator plays through the loop the first time, the raw backend output is
+ * captured; once a full loop plus a verification tail is available, the seam
+ * is located by comparing a window near the start of the capture with the
+ * same window one loop later, trying the candidate lengths closest to the
+ * expected one first. The window must be loud enough to tell lengths apart,
+ * so a loop that opens with silence is compared a little further in. The
+ * search is spread over several rendered buffers. If the two match, further
+ * loop passes are served from memory instead of running the chip emulation.
+ * If they don't (non-deterministic emulation, loop longer than the cache
+ * limit), the cache gives up and playback stays emulated.
+ *
+ * All positions are output sample frames as counted by the engine.
+ */
+
+#ifndef LOOP_CACHE_H
+#define LOOP_CACHE_H
+
+#include <cstdint>
+
+// Largest loop body we are willing to hold in memory (~31 MB at 44.1 kHz)
+#define LOOP_CACHE_MAX_SECONDS 180
+
+// Frames compared past the loop end to verify the seam
+#define LOOP_CACHE_VERIFY_FRAMES 2048
+
+// Largest per-sample difference still accepted as the same audio
+#define LOOP_CACHE_SEAM_TOLERANCE 16
+
+// Mean absolute sample value the compared window needs; quieter audio would
+// match at any length
+#define LOOP_CACHE_MIN_LEVEL 64
+
+// How far into the loop the capture may go looking for such a window
+#define LOOP_CACHE_WINDOW_SECONDS 2
+
+// Seam candidates compared per rendered buffer
+#define LOOP_CACHE_SEAM_CANDIDATES 256
+
+void loop_cache_reset();
+
+// Start capturing at `loopStart`. `approxLen` is the expected loop length
+// (or -1 if not known yet), `margin` how far the real seam may be off.
+void loop_cache_begin(int64_t loopStart, int64_t approxLen, int64_t margin,
+                      int sampleRate);
+
+// Supply the loop length once it becomes known (backends that only report
+// loops as they happen).
+void loop_cache_set_length(int64_t approxLen, int64_t margin);
+
+bool loop_cache_capturing();
+bool loop_cache_ready();
+bool loop_cache_failed();
+
+// Offer freshly rendered interleaved stereo frames starting at `startSample`.
+// Frames outside the capture window are ignored. Verifies the seam once
+// enough audio is captured.
+void loop_cache_feed(const int16_t *frames, int count, int64_t startSample);
+
+int64_t loop_cache_start();
+int64_t loop_cache_length();
+
+// Fill `frames` frames starting at `startSample` (>= loop_cache_start())
+// from the cached loop body. Returns the number of frames written.
+int loop_cache_read(int16_t *dst, int frames, int64_t startSample);
+
+// Map a position inside the cached loop region to the same point of the
+// first loop pass.
+int64_t loop_cache_equivalent(int64_t sample);
+
+#endif // LOOP_CACHE_H
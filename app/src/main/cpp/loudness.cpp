@@ -0,0 +1,294 @@
+/*
+ * loudness.cpp
+ *
+ * K-weighting coefficients follow BS.1770-4, re-derived for the actual
+ * sample rate (the standard only tabulates 48 kHz).
+ */
+
+#include "loudness.h"
+
+#include <cmath>
+#include <cstring>
+
+#define TP_PHASES 3
+#define TP_TAPS 8
+// Frames per pass of the true-peak kernel
+#define TP_CHUNK 256
+
+// Left/right pair for the filters, four frames for the interpolator
+typedef double v2d __attribute__((vector_size(16)));
+typedef float v4f __attribute__((vector_size(16)));
+
+struct TruePeakCoefs {
+  float c[TP_PHASES][TP_TAPS];
+  TruePeakCoefs() {
+    // Windowed-sinc interpolators for 1/4, 2/4 and 3/4 between two frames
+    for (int p = 0; p < TP_PHASES; p++) {
+      float frac = (p + 1) / 4.0f;
+      float sum = 0.0f;
+      for (int j = 0; j < TP_TAPS; j++) {
+        float t = (float)(j - 3) - frac;
+        float sinc = std::sin((float)M_PI * t) / ((float)M_PI * t);
+        float win = 0.5f + 0.5f * std::cos((float)M_PI * t / 4.5f);
+        c[p][j] = sinc * win;
+        sum += c[p][j];
+      }
+      for (int j = 0; j < TP_TAPS; j++)
+        c[p][j] /= sum;
+    }
+  }
+};
+
+// Built once, thread-safe (function-local static)
+static const TruePeakCoefs &tpCoefs() {
+  static const TruePeakCoefs coefs;
+  return coefs;
+}
+
+static float energyToLufs(double e) {
+  return e > 0.0 ? (float)(-0.691 + 10.0 * std::log10(e)) : -INFINITY;
+}
+
+// Energy at the centre of each histogram bin, built once
+struct BinEnergies {
+  double e[LOUDNESS_HIST_BINS];
+  BinEnergies() {
+    for (int b = 0; b < LOUDNESS_HIST_BINS; b++) {
+      double lufs = -70.0 + (b + 0.5) * 0.1;
+      e[b] = std::pow(10.0, (lufs + 0.691) / 10.0);
+    }
+  }
+};
+
+static double binEnergy(int bin) {
+  static const BinEnergies table;
+  return table.e[bin];
+}
+
+void loudness_init(LoudnessMeter *m, int sampleRate) {
+  memset(m, 0, sizeof(*m));
+  m->rate = sampleRate;
+  m->stepFrames = sampleRate / 10;
+
+  // Stage 1: high shelf, +4 dB above ~1.7 kHz (head diffraction)
+  double f0 = 1681.974450955533;
+  double G = 3.999843853973347;
+  double Q = 0.7071752369554196;
+  double K = std::tan(M_PI * f0 / sampleRate);
+  double Vh = std::pow(10.0, G / 20.0);
+  double Vb = std::pow(Vh, 0.4996667741545416);
+  double a0 = 1.0 + K / Q + K * K;
+  m->coef[0][0] = (Vh + Vb * K / Q + K * K) / a0;
+  m->coef[0][1] = 2.0 * (K * K - Vh) / a0;
+  m->coef[0][2] = (Vh - Vb * K / Q + K * K) / a0;
+  m->coef[0][3] = 2.0 * (K * K - 1.0) / a0;
+  m->coef[0][4] = (1.0 - K / Q + K * K) / a0;
+
+  // Stage 2: high pass at ~38 Hz (RLB weighting)
+  f0 = 38.13547087602444;
+  Q = 0.5003270373238773;
+  K = std::tan(M_PI * f0 / sampleRate);
+  a0 = 1.0 + K / Q + K * K;
+  m->coef[1][0] = 1.0;
+  m->coef[1][1] = -2.0;
+  m->coef[1][2] = 1.0;
+  m->coef[1][3] = 2.0 * (K * K - 1.0) / a0;
+  m->coef[1][4] = (1.0 - K / Q + K * K) / a0;
+}
+
+static inline v4f vabs(v4f v) {
+  const v4f zero = {0, 0, 0, 0};
+  return v < zero ? -v : v;
+}
+
+static inline v4f vmax(v4f a, v4f b) { return a > b ? a : b; }
+
+// K-weight n frames, both channels at once, and add their energy to the
+// current step.
+static void kWeight(LoudnessMeter *m, const float *x, int n) {
+  v2d k[2][5];
+  for (int st = 0; st < 2; st++)
+    for (int i = 0; i < 5; i++)
+      k[st][i] = v2d{m->coef[st][i], m->coef[st][i]};
+  v2d z[2][2];
+  memcpy(z, m->z, sizeof(z));
+
+  v2d acc = {0, 0};
+  for (int i = 0; i < n; i++) {
+    v2d y = {x[i * 2], x[i * 2 + 1]};
+    for (int st = 0; st < 2; st++) {
+      v2d in = y;
+      y = k[st][0] * in + z[st][0];
+      z[st][0] = k[st][1] * in - k[st][3] * y + z[st][1];
+      z[st][1] = k[st][2] * in - k[st][4] * y;
+    }
+    acc += y * y;
+  }
+
+  memcpy(m->z, z, sizeof(z));
+  m->stepSum += acc[0] + acc[1];
+}
+
+// Largest magnitude among channel c of n frames and the points 4x
+// oversampling puts between them. h holds the channel's previous
+// TP_TAPS - 1 samples and is advanced. Each output window s[i..i+7]
+// interpolates between s[i+3] and s[i+4], four frames behind the newest.
+static float truePeakChunk(float *h, const float *x, int c, int n,
+                           float peak) {
+  const TruePeakCoefs &tp = tpCoefs();
+  float s[TP_TAPS - 1 + TP_CHUNK];
+  memcpy(s, h, sizeof(float) * (TP_TAPS - 1));
+  for (int i = 0; i < n; i++)
+    s[TP_TAPS - 1 + i] = x[i * 2 + c];
+
+  // Four frames per vector; unaligned loads go through memcpy
+  v4f vpeak = {peak, peak, peak, peak};
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    v4f win[TP_TAPS];
+    for (int j = 0; j < TP_TAPS; j++)
+      memcpy(&win[j], s + i + j, sizeof(v4f));
+    vpeak = vmax(vpeak, vabs(win[TP_TAPS - 1]));
+    for (int p = 0; p < TP_PHASES; p++) {
+      v4f y = win[0] * tp.c[p][0];
+      for (int j = 1; j < TP_TAPS; j++)
+        y += win[j] * tp.c[p][j];
+      vpeak = vmax(vpeak, vabs(y));
+    }
+  }
+  for (int l = 0; l < 4; l++) {
+    if (vpeak[l] > peak)
+      peak = vpeak[l];
+  }
+
+  // Tail frames one at a time
+  for (; i < n; i++) {
+    const float *w = s + i;
+    float a = std::fabs(w[TP_TAPS - 1]);
+    if (a > peak)
+      peak = a;
+    for (int p = 0; p < TP_PHASES; p++) {
+      float y = 0.0f;
+      for (int j = 0; j < TP_TAPS; j++)
+        y += w[j] * tp.c[p][j];
+      y = std::fabs(y);
+      if (y > peak)
+        peak = y;
+    }
+  }
+
+  memcpy(h, s + n, sizeof(float) * (TP_TAPS - 1));
+  return peak;
+}
+
+static void finishStep(LoudnessMeter *m) {
+  int slot = m->stepCount % LOUDNESS_STEPS;
+  m->steps[slot] = m->stepSum / m->stepFrames;
+  m->stepPeaks[slot] = m->stepPeak;
+  m->stepCount++;
+  m->stepSum = 0.0;
+  m->stepPeak = 0.0f;
+  m->stepPos = 0;
+  if (m->stepCount < 4)
+    return;
+
+  // 400 ms gating block = last four steps
+  double e = 0.0;
+  for (int i = 1; i <= 4; i++)
+    e += m->steps[(m->stepCount - i) % LOUDNESS_STEPS];
+  float lufs = energyToLufs(e / 4.0);
+  if (lufs < -70.0f)
+    return;
+  int bin = (int)((lufs + 70.0f) * 10.0f);
+  if (bin >= LOUDNESS_HIST_BINS)
+    bin = LOUDNESS_HIST_BINS - 1;
+  m->hist[bin]++;
+  m->blocks++;
+}
+
+void loudness_feed(LoudnessMeter *m, const float *interleaved, int frames) {
+  // Chunks never cross a step, so each step knows its own peak
+  while (frames > 0) {
+    int n = m->stepFrames - m->stepPos;
+    if (n > frames)
+      n = frames;
+    if (n > TP_CHUNK)
+      n = TP_CHUNK;
+
+    kWeight(m, interleaved, n);
+    float p = truePeakChunk(m->tpHist[0], interleaved, 0, n, m->stepPeak);
+    m->stepPeak = truePeakChunk(m->tpHist[1], interleaved, 1, n, p);
+    if (m->stepPeak > m->truePeak)
+      m->truePeak = m->stepPeak;
+
+    interleaved += n * 2;
+    frames -= n;
+    m->stepPos += n;
+    if (m->stepPos == m->stepFrames)
+      finishStep(m);
+  }
+}
+
+float loudness_integrated(const LoudnessMeter *m) {
+  if (m->blocks == 0)
+    return LOUDNESS_SILENCE;
+
+  // Absolute gate is applied on entry; the relative gate sits 10 LU below
+  // the mean of everything above it
+  double sum = 0.0;
+  for (int b = 0; b < LOUDNESS_HIST_BINS; b++)
+    sum += m->hist[b] * binEnergy(b);
+  float relGate = energyToLufs(sum / m->blocks) - 10.0f;
+
+  int first = (int)std::ceil((relGate + 70.0f) * 10.0f - 0.5f);
+  if (first < 0)
+    first = 0;
+  sum = 0.0;
+  uint64_t count = 0;
+  for (int b = first; b < LOUDNESS_HIST_BINS; b++) {
+    sum += m->hist[b] * binEnergy(b);
+    count += m->hist[b];
+  }
+  if (count == 0)
+    return LOUDNESS_SILENCE;
+  return energyToLufs(sum / count);
+}
+
+static float recentLoudness(const LoudnessMeter *m, int steps) {
+  int n = m->stepCount < steps ? m->stepCount : steps;
+  if (n == 0)
+    return LOUDNESS_SILENCE;
+  double e = 0.0;
+  for (int i = 1; i <= n; i++)
+    e += m->steps[(m->stepCount - i) % LOUDNESS_STEPS];
+  float lufs = energyToLufs(e / n);
+  return lufs < LOUDNESS_SILENCE ? LOUDNESS_SILENCE : lufs;
+}
+
+float loudness_momentary(const LoudnessMeter *m) {
+  return recentLoudness(m, 4);
+}
+
+float loudness_short_term(const LoudnessMeter *m) {
+  return recentLoudness(m, LOUDNESS_STEPS);
+}
+
+static float peakToDb(float peak) {
+  return peak > 0.0f ? 20.0f * std::log10(peak) : -INFINITY;
+}
+
+float loudness_true_peak_db(const LoudnessMeter *m) {
+  return peakToDb(m->truePeak);
+}
+
+float loudness_momentary_true_peak_db(const LoudnessMeter *m) {
+  // The step in progress plus the three before it
+  float peak = m->stepPeak;
+  int n = m->stepCount < 3 ? m->stepCount : 3;
+  for (int i = 1; i <= n; i++) {
+    float p = m->stepPeaks[(m->stepCount - i) % LOUDNESS_STEPS];
+    if (p > peak)
+      peak = p;
+  }
+  return peakToDb(peak);
+}
@@ -0,0 +1,71 @@
+/*
+ * loudness.h
+ *
+ * EBU R128 / ITU-R BS.1770 loudness measurement of a stereo stream.
+ * Audio is K-weighted (high shelf + high pass) and its mean square is
+ * collected per 100 ms step. 400 ms blocks (75% overlap) are kept in a
+ * 0.1 LU histogram, so the integrated value takes the two-stage gate
+ * (-70 LUFS absolute, -10 LU relative) with constant memory, however long
+ * the stream runs. The true peak is estimated with 4x polyphase
+ * oversampling.
+ *
+ * Both kernels are written for SIMD: the K-weighting runs left and right
+ * through one two-lane double vector (one NEON register), and the
+ * oversampling FIR computes four frames per vector. Feeding costs a few
+ * percent of one core at 44.1 kHz on a low-end phone, cheap enough for the
+ * live output meters as well as offline analysis.
+ *
+ * Each LoudnessMeter is independent; separate meters may run on separate
+ * threads.
+ */
+
+#ifndef LOUDNESS_H
+#define LOUDNESS_H
+
+#include <cstdint>
+
+#define LOUDNESS_HIST_BINS 1000 // -70 .. +30 LUFS in 0.1 LU
+#define LOUDNESS_STEPS 30       // 100 ms steps kept (3 s short-term window)
+
+// Reported when nothing passed the gate
+#define LOUDNESS_SILENCE -70.0f
+
+struct LoudnessMeter {
+  int rate;
+  // K-weighting, two biquads per channel: [stage][b0 b1 b2 a1 a2]
+  double coef[2][5];
+  double z[2][2][2]; // [stage][state][channel]
+
+  // Mean-square accumulation of the current 100 ms step
+  int stepFrames;
+  int stepPos;
+  double stepSum;
+  double steps[LOUDNESS_STEPS]; // energy of recent steps, ring
+  int stepCount;                // steps completed in total
+  float stepPeak;               // true peak of the current step
+  float stepPeaks[LOUDNESS_STEPS]; // true peak of recent steps, ring
+
+  uint32_t hist[LOUDNESS_HIST_BINS];
+  uint64_t blocks;
+
+  float tpHist[2][7]; // interpolator history per channel
+  float truePeak;     // linear, >= sample peak
+};
+
+void loudness_init(LoudnessMeter *m, int sampleRate);
+
+// Feed interleaved stereo frames, full scale = 1.0.
+void loudness_feed(LoudnessMeter *m, const float *interleaved, int frames);
+
+// Gated loudness of everything fed so far, in LUFS.
+float loudness_integrated(const LoudnessMeter *m);
+
+// Ungated loudness over the last 400 ms / 3 s, in LUFS.
+float loudness_momentary(const LoudnessMeter *m);
+float loudness_short_term(const LoudnessMeter *m);
+
+// True peak in dBTP, of everything fed so far / of the last 400 ms.
+float loudness_true_peak_db(const LoudnessMeter *m);
+float loudness_momentary_true_peak_db(const LoudnessMeter *m);
+
+#endif // LOUDNESS_H
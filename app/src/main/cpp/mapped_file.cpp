@@ -0,0 +1,496 @@
+/*
+ * mapped_file.cpp
+ *
+ * The loader keeps gzip data compressed in the mapping and inflates it as
+ * libvgm reads; its length is the ISIZE field of the gzip trailer, as with
+ * libvgm's own FileLoader.
+ *
+ * mapped_file_loader_load sets the DATA_LOADER fields DataLoader_Load would
+ * (buffer, sizes, LOADED), so libvgm's reads find everything loaded and
+ * never call back. DataLoader_Reset would free() the buffer, so
+ * mapped_file_loader_free takes it back first. Those fields are private to
+ * libvgm; the asserts below pin the layout this was written against, so a
+ * submodule update that changes it stops the build. The clean way is a
+ * loader hook in libvgm itself, carried as a patch in patches/ like the
+ * other libvgm changes.
+ */
+
+#include "mapped_file.h"
+
+#include "vgz_cache.h"
+#include "zip_archive.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <new>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+// Four-character code of the loader, "MMAP"
+#define MAPPED_LOADER_TYPE 0x4D4D4150
+// Scratch for skipping forward through gzip data
+#define MAPPED_LOADER_SKIP 4096
+// Start of a sequentially read mapping paged in at once; read-ahead
+// follows the parse through the rest
+#define MAPPED_FILE_WILLNEED_BYTES (256 << 10)
+
+static std::atomic<AAssetManager *> gAssetManager(nullptr);
+static std::mutex gScratchLock;
+static std::string gScratchDir;
+
+static void advise(void *addr, size_t len, MappedFileAccess access) {
+  if (access == MAPPED_FILE_RANDOM) {
+    madvise(addr, len, MADV_RANDOM);
+  } else {
+    madvise(addr, len, MADV_SEQUENTIAL);
+    madvise(addr, std::min<size_t>(len, MAPPED_FILE_WILLNEED_BYTES),
+            MADV_WILLNEED);
+  }
+}
+
+bool mapped_file_open_fd(MappedFile *f, int fd, int64_t offset, size_t size,
+                         MappedFileAccess access) {
+  memset(f, 0, sizeof(*f));
+  if (fd < 0 || offset < 0 || size == 0)
+    return false;
+  int64_t page = sysconf(_SC_PAGESIZE);
+  int64_t start = offset & ~(page - 1);
+  size_t lead = (size_t)(offset - start);
+  void *map = mmap(nullptr, size + lead, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                   fd, (off_t)start);
+  if (map == MAP_FAILED)
+    return false;
+  f->map = map;
+  f->mapSize = size + lead;
+  f->data = (uint8_t *)map + lead;
+  f->size = size;
+  advise(f->map, f->mapSize, access);
+  return true;
+}
+
+void mapped_file_set_asset_manager(AAssetManager *manager) {
+  gAssetManager.store(manager, std::memory_order_release);
+}
+
+void mapped_file_set_scratch_dir(const char *dir) {
+  std::lock_guard<std::mutex> lock(gScratchLock);
+  gScratchDir = dir;
+}
+
+bool mapped_file_alloc(MappedFile *f, size_t size) {
+  memset(f, 0, sizeof(*f));
+  if (size == 0)
+    return false;
+  void *map = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (map == MAP_FAILED)
+    return false;
+  f->map = map;
+  f->mapSize = size;
+  f->data = (uint8_t *)map;
+  f->size = size;
+  return true;
+}
+
+// A compressed asset has no file range to map; read it into anonymous
+// memory, which mapped_file_close unmaps like any other mapping.
+static bool readAsset(MappedFile *f, AAsset *asset) {
+  int64_t length = AAsset_getLength64(asset);
+  if (length <= 0 || !mapped_file_alloc(f, (size_t)length))
+    return false;
+  int64_t got = 0;
+  while (got < length) {
+    int n = AAsset_read(asset, f->data + got, (size_t)(length - got));
+    if (n <= 0)
+      break;
+    got += n;
+  }
+  if (got != length) {
+    mapped_file_close(f);
+    return false;
+  }
+  return true;
+}
+
+static bool openAsset(MappedFile *f, const char *name,
+                      MappedFileAccess access) {
+  AAssetManager *manager = gAssetManager.load(std::memory_order_acquire);
+  if (!manager)
+    return false;
+  AAsset *asset = AAssetManager_open(manager, name, AASSET_MODE_RANDOM);
+  if (!asset)
+    return false;
+  int64_t start, length;
+  int fd = AAsset_openFileDescriptor64(asset, &start, &length);
+  bool ok;
+  if (fd >= 0) {
+    // Stored: the asset is a byte range of the APK
+    ok = mapped_file_open_fd(f, fd, start, (size_t)length, access);
+    close(fd);
+  } else {
+    ok = readAsset(f, asset);
+  }
+  AAsset_close(asset);
+  return ok;
+}
+
+bool mapped_file_open(MappedFile *f, const char *path,
+                      MappedFileAccess access) {
+  memset(f, 0, sizeof(*f));
+  size_t prefix = strlen(MAPPED_FILE_ASSET_PREFIX);
+  if (strncmp(path, MAPPED_FILE_ASSET_PREFIX, prefix) == 0)
+    return openAsset(f, path + prefix, access);
+  std::string zip, entry;
+  if (zip_archive_split(path, &zip, &entry))
+    return zip_archive_open_entry(f, zip.c_str(), entry.c_str(), access);
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  bool ok = fstat(fd, &st) == 0 && st.st_size > 0 &&
+            mapped_file_open_fd(f, fd, 0, (size_t)st.st_size, access);
+  close(fd);
+  return ok;
+}
+
+void mapped_file_advise(const MappedFile *f, MappedFileAccess access) {
+  if (f->map)
+    advise(f->map, f->mapSize, access);
+}
+
+void mapped_file_close(MappedFile *f) {
+  if (f->map)
+    munmap(f->map, f->mapSize);
+  memset(f, 0, sizeof(*f));
+}
+
+// ---------------------------------------------------------------------------
+// libvgm DATA_LOADER over a mapping
+// ---------------------------------------------------------------------------
+
+// DATA_LOADER as in libvgm's utils/DataLoader.h
+struct LoaderLayout {
+  UINT8 status;
+  UINT32 bytesTotal;
+  UINT32 bytesLoaded;
+  UINT32 readStopOfs;
+  UINT8 *data;
+  const DATA_LOADER_CALLBACKS *callbacks;
+  void *context;
+};
+
+#define LOADER_FIELD(ours, theirs)                                           \
+  static_assert(offsetof(DATA_LOADER, theirs) ==                             \
+                        offsetof(LoaderLayout, ours) &&                      \
+                    sizeof(DATA_LOADER::theirs) == sizeof(LoaderLayout::ours), \
+                "DATA_LOADER::" #theirs " moved; see mapped_file_loader_load")
+static_assert(sizeof(DATA_LOADER) == sizeof(LoaderLayout),
+              "DATA_LOADER changed; see mapped_file_loader_load");
+LOADER_FIELD(status, _status);
+LOADER_FIELD(bytesTotal, _bytesTotal);
+LOADER_FIELD(bytesLoaded, _bytesLoaded);
+LOADER_FIELD(readStopOfs, _readStopOfs);
+LOADER_FIELD(data, _data);
+LOADER_FIELD(callbacks, _callbacks);
+LOADER_FIELD(context, _context);
+#undef LOADER_FIELD
+
+struct MappedLoader {
+  MappedFile file;
+  MappedFile inflated; // gzip data inflated for libvgm, if any
+  bool borrowed;    // the DATA_LOADER's buffer is ours
+  bool gzip;
+  bool inflating; // zs is initialised
+  z_stream zs;
+  UINT32 length; // uncompressed
+  UINT32 pos;
+};
+
+static bool startInflate(MappedLoader *l) {
+  memset(&l->zs, 0, sizeof(l->zs));
+  l->zs.next_in = l->file.data;
+  l->zs.avail_in = (uInt)l->file.size;
+  l->inflating = inflateInit2(&l->zs, 16 + MAX_WBITS) == Z_OK;
+  l->pos = 0;
+  return l->inflating;
+}
+
+static void endInflate(MappedLoader *l) {
+  if (l->inflating)
+    inflateEnd(&l->zs);
+  l->inflating = false;
+}
+
+static UINT8 loaderOpen(void *context) {
+  MappedLoader *l = (MappedLoader *)context;
+  l->pos = 0;
+  if (!l->gzip)
+    return 0x00;
+  endInflate(l);
+  return startInflate(l) ? 0x00 : 0xFF;
+}
+
+static UINT32 loaderRead(void *context, UINT8 *buffer, UINT32 numBytes) {
+  MappedLoader *l = (MappedLoader *)context;
+  if (numBytes > l->length - l->pos)
+    numBytes = l->length - l->pos;
+  if (!l->gzip) {
+    memcpy(buffer, l->file.data + l->pos, numBytes);
+    l->pos += numBytes;
+    return numBytes;
+  }
+  if (!l->inflating)
+    return 0;
+  l->zs.next_out = buffer;
+  l->zs.avail_out = numBytes;
+  while (l->zs.avail_out > 0) {
+    int ret = inflate(&l->zs, Z_NO_FLUSH);
+    if (ret != Z_OK)
+      break;
+  }
+  UINT32 got = numBytes - l->zs.avail_out;
+  l->pos += got;
+  return got;
+}
+
+static UINT8 loaderSeek(void *context, UINT32 offset, UINT8 whence) {
+  MappedLoader *l = (MappedLoader *)context;
+  int64_t target = offset;
+  if (whence == SEEK_CUR)
+    target += l->pos;
+  else if (whence == SEEK_END)
+    target += l->length;
+  if (target < 0 || target > l->length)
+    return 0xFF;
+  if (!l->gzip) {
+    l->pos = (UINT32)target;
+    return 0x00;
+  }
+  // Deflate can only be read forwards
+  if (target < l->pos) {
+    endInflate(l);
+    if (!startInflate(l))
+      return 0xFF;
+  }
+  UINT8 skip[MAPPED_LOADER_SKIP];
+  while (l->pos < target) {
+    UINT32 n = (UINT32)std::min<int64_t>(MAPPED_LOADER_SKIP, target - l->pos);
+    if (loaderRead(l, skip, n) != n)
+      return 0xFF;
+  }
+  return 0x00;
+}
+
+static UINT8 loaderClose(void *context) {
+  endInflate((MappedLoader *)context);
+  return 0x00;
+}
+
+static INT32 loaderTell(void *context) {
+  return (INT32)((MappedLoader *)context)->pos;
+}
+
+static UINT32 loaderLength(void *context) {
+  return ((MappedLoader *)context)->length;
+}
+
+static UINT8 loaderEof(void *context) {
+  MappedLoader *l = (MappedLoader *)context;
+  return l->pos >= l->length;
+}
+
+static UINT8 loaderDeinit(void *context) {
+  MappedLoader *l = (MappedLoader *)context;
+  endInflate(l);
+  mapped_file_close(&l->file);
+  mapped_file_close(&l->inflated);
+  delete l;
+  return 0x00;
+}
+
+static const DATA_LOADER_CALLBACKS kMappedLoaderCallbacks = {
+    MAPPED_LOADER_TYPE, "Mapped File Loader",
+    loaderOpen,         loaderRead,
+    loaderSeek,         loaderClose,
+    loaderTell,         loaderLength,
+    loaderEof,          loaderDeinit,
+};
+
+DATA_LOADER *mapped_file_loader(const char *path) {
+  MappedLoader *l = new (std::nothrow) MappedLoader();
+  if (!l)
+    return nullptr;
+  if (!mapped_file_open(&l->file, path, MAPPED_FILE_SEQUENTIAL)) {
+    delete l;
+    return nullptr;
+  }
+  const uint8_t *d = l->file.data;
+  size_t size = l->file.size;
+  l->gzip = size >= 18 && d[0] == 0x1F && d[1] == 0x8B;
+  if (l->gzip) {
+    const uint8_t *t = d + size - 4;
+    l->length = (UINT32)t[0] | (UINT32)t[1] << 8 | (UINT32)t[2] << 16 |
+                (UINT32)t[3] << 24;
+  } else {
+    l->length = size > 0xFFFFFFFFu ? 0xFFFFFFFFu : (UINT32)size;
+  }
+
+  DATA_LOADER *loader = (DATA_LOADER *)calloc(1, sizeof(DATA_LOADER));
+  if (!loader) {
+    loaderDeinit(l);
+    return nullptr;
+  }
+  DataLoader_Setup(loader, &kMappedLoaderCallbacks, l);
+  return loader;
+}
+
+// An unlinked, empty file in the scratch directory, or -1.
+static int openScratchFile() {
+  std::string dir;
+  {
+    std::lock_guard<std::mutex> lock(gScratchLock);
+    dir = gScratchDir;
+  }
+  if (dir.empty())
+    return -1;
+  int fd = open(dir.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+  if (fd >= 0)
+    return fd;
+  // Filesystems without O_TMPFILE
+  std::string name = dir + "/scratch-XXXXXX";
+  fd = mkstemp(&name[0]);
+  if (fd >= 0)
+    unlink(name.c_str());
+  return fd;
+}
+
+// Inflate all gzip data of `l` into `out`, a window at a time; with `drop`,
+// each window is dropped from memory once full. Fails unless the stream ends
+// right there with a matching CRC-32.
+static bool inflateAll(MappedLoader *l, MappedFile *out, bool drop) {
+  bool ok = startInflate(l);
+  size_t done = 0;
+  while (ok && done < out->size) {
+    UINT32 n = (UINT32)std::min<size_t>(MAPPED_FILE_SPILL_WINDOW,
+                                        out->size - done);
+    ok = loaderRead(l, out->data + done, n) == n;
+    if (drop)
+      madvise(out->data + done, n, MADV_DONTNEED);
+    done += n;
+  }
+  if (ok) {
+    // inflate checks the trailer only once asked past the last byte; any
+    // byte it still produces means the trailer's size was wrong
+    uint8_t extra;
+    l->zs.next_out = &extra;
+    l->zs.avail_out = 1;
+    ok = inflate(&l->zs, Z_FINISH) == Z_STREAM_END && l->zs.avail_out == 1;
+  }
+  endInflate(l);
+  return ok;
+}
+
+// Inflate the gzip data of `l` into `fd`, mapped shared at l->inflated:
+// the kernel writes the dropped windows back and pages them in again as
+// playback reads them.
+static bool inflateToFile(MappedLoader *l, int fd) {
+  size_t size = l->length;
+  void *map = MAP_FAILED;
+  if (ftruncate(fd, (off_t)size) == 0)
+    map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED)
+    return false;
+  l->inflated.map = map;
+  l->inflated.mapSize = size;
+  l->inflated.data = (uint8_t *)map;
+  l->inflated.size = size;
+  if (!inflateAll(l, &l->inflated, true)) {
+    mapped_file_close(&l->inflated);
+    return false;
+  }
+  mapped_file_advise(&l->inflated, MAPPED_FILE_SEQUENTIAL);
+  return true;
+}
+
+static bool spill(MappedLoader *l) {
+  int fd = openScratchFile();
+  if (fd < 0)
+    return false;
+  bool ok = inflateToFile(l, fd);
+  close(fd);
+  return ok;
+}
+
+// Inflate the gzip data of `l` into a new vgz_cache entry, mapped privately
+// at l->inflated like any cached one, so writes don't reach the cache.
+static bool inflateToCache(MappedLoader *l) {
+  std::string tmp;
+  int fd = vgz_cache_create(&l->file, l->length, &tmp);
+  if (fd < 0)
+    return false;
+  bool ok = inflateToFile(l, fd);
+  if (ok) {
+    mapped_file_close(&l->inflated);
+    ok = mapped_file_open_fd(&l->inflated, fd, 0, l->length,
+                             MAPPED_FILE_SEQUENTIAL);
+  }
+  close(fd);
+  vgz_cache_commit(&l->file, tmp, ok);
+  return ok;
+}
+
+static bool inflateToMemory(MappedLoader *l) {
+  if (!mapped_file_alloc(&l->inflated, l->length))
+    return false;
+  if (!inflateAll(l, &l->inflated, false)) {
+    mapped_file_close(&l->inflated);
+    return false;
+  }
+  return true;
+}
+
+UINT8 mapped_file_loader_load(DATA_LOADER *loader) {
+  if (loader->_callbacks != &kMappedLoaderCallbacks)
+    return DataLoader_Load(loader);
+  MappedLoader *l = (MappedLoader *)loader->_context;
+  MappedFile *buffer;
+  if (!l->gzip)
+    buffer = &l->file;
+  else if (vgz_cache_open(&l->inflated, &l->file) || inflateToCache(l) ||
+           (l->length >= MAPPED_FILE_SPILL_BYTES && spill(l)) ||
+           inflateToMemory(l))
+    buffer = &l->inflated;
+  else
+    return 0xFF;
+
+  DataLoader_Reset(loader);
+  loader->_data = buffer->data;
+  loader->_bytesTotal = l->length;
+  loader->_bytesLoaded = l->length;
+  loader->_readStopOfs = l->length;
+  loader->_status = DLSTAT_LOADED;
+  l->borrowed = true;
+  return 0x00;
+}
+
+void mapped_file_loader_free(DATA_LOADER *loader) {
+  if (!loader)
+    return;
+  if (loader->_callbacks == &kMappedLoaderCallbacks &&
+      ((MappedLoader *)loader->_context)->borrowed) {
+    loader->_data = nullptr;
+    loader->_bytesTotal = 0;
+    loader->_bytesLoaded = 0;
+    loader->_status = DLSTAT_EMPTY;
+  }
+  DataLoader_Deinit(loader);
+}
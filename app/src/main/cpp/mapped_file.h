@@ -0,0 +1,105 @@
+/*
+ * mapped_file.h
+ *
+ * Read-only access to input files through mmap, shared by every backend.
+ * Parsers get a pointer into the page cache instead of a heap copy made
+ * with fread, so a file read again shortly after (import probes the same
+ * file for its track count, range and length) costs no I/O and no copy.
+ *
+ * The mapping is private and writable: libraries that take a non-const
+ * buffer may scribble on it, and only the pages they touch are copied. The
+ * file itself is opened read-only and never changes.
+ *
+ * The access hint is passed to madvise: SEQUENTIAL for a parse from start
+ * to end (read-ahead, and the start is paged in now), RANDOM for indexes
+ * and headers looked up at a few offsets (no read-ahead).
+ *
+ * libvgm reads through a DATA_LOADER; mapped_file_loader() provides one
+ * over a mapping, inflating .vgz from the mapped bytes. VGMPlayer wants the
+ * whole file in the loader's buffer, which DataLoader_Load fills from the
+ * heap; mapped_file_loader_load() hands it the mapping instead, so a VGM
+ * with tens of MB of sample data costs page cache, read in as playback
+ * reaches it and reclaimable, not heap. A .vgz is mapped from its entry in
+ * vgz_cache.h, inflated into a new one on a miss, a window at a time. If
+ * it isn't cached, large ones are inflated into an unlinked file in the
+ * scratch directory and mapped from there for the same reason; small ones
+ * into anonymous memory.
+ *
+ * Files bundled with the app are named MAPPED_FILE_ASSET_PREFIX followed by
+ * their path under assets/. Assets stored uncompressed in the APK (see
+ * noCompress in build.gradle.kts) are mapped straight from the APK; others
+ * are inflated into anonymous memory. Entries of zip packs are named as in
+ * zip_archive.h and mapped the same way.
+ *
+ * Each MappedFile is independent; separate ones may be used on separate
+ * threads.
+ */
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <android/asset_manager.h>
+#include <cstddef>
+#include <cstdint>
+
+#include "libvgm/utils/DataLoader.h"
+
+#define MAPPED_FILE_ASSET_PREFIX "asset:///"
+// Inflated size from which .vgz data goes to a scratch file, not memory
+#define MAPPED_FILE_SPILL_BYTES (8 << 20)
+// Inflated bytes kept mapped while writing a scratch file
+#define MAPPED_FILE_SPILL_WINDOW (4 << 20)
+
+enum MappedFileAccess {
+  MAPPED_FILE_SEQUENTIAL = 0,
+  MAPPED_FILE_RANDOM = 1,
+};
+
+// Zero-initialised means closed.
+struct MappedFile {
+  uint8_t *data; // the requested bytes
+  size_t size;
+  void *map;      // page-aligned start of the mapping
+  size_t mapSize;
+};
+
+// Resolve MAPPED_FILE_ASSET_PREFIX paths with `manager`, which must stay
+// valid from then on.
+void mapped_file_set_asset_manager(AAssetManager *manager);
+
+// Directory for scratch files (the app's cache directory). Without one,
+// large .vgz data is inflated into memory.
+void mapped_file_set_scratch_dir(const char *dir);
+
+// Map all of `path`, a file or an asset. False, leaving `f` closed, if it
+// can't be opened or is empty.
+bool mapped_file_open(MappedFile *f, const char *path,
+                      MappedFileAccess access);
+
+// Map `size` bytes of `fd` from `offset` on (any alignment). The caller
+// keeps ownership of `fd`; it may be closed once this returns.
+bool mapped_file_open_fd(MappedFile *f, int fd, int64_t offset, size_t size,
+                         MappedFileAccess access);
+
+// Map `size` bytes of zeroed anonymous memory, for data produced in memory.
+bool mapped_file_alloc(MappedFile *f, size_t size);
+
+void mapped_file_advise(const MappedFile *f, MappedFileAccess access);
+
+// Unmap, leaving `f` closed. Does nothing if it already is.
+void mapped_file_close(MappedFile *f);
+
+// A libvgm loader reading `path` through a mapping, gzip-compressed or not.
+// Null if the file can't be mapped. Freed by DataLoader_Deinit, or by
+// mapped_file_loader_free once mapped_file_loader_load has been used.
+DATA_LOADER *mapped_file_loader(const char *path);
+
+// DataLoader_Load for a loader from mapped_file_loader, leaving it loaded
+// with a mapping as its buffer (see above). Same result codes. Not for
+// loaders handed to libvgm, which frees them itself.
+UINT8 mapped_file_loader_load(DATA_LOADER *loader);
+
+// Free a loader from mapped_file_loader, loaded or not.
+void mapped_file_loader_free(DATA_LOADER *loader);
+
+#endif // MAPPED_FILE_H
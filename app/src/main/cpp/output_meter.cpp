@@ -0,0 +1,118 @@
+/*
+ * output_meter.cpp
+ *
+ * The int16 output is converted to float once per buffer and shared by the
+ * loudness meter and the correlation sums.
+ */
+
+#include "output_meter.h"
+
+#include "loudness.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+typedef float v4f __attribute__((vector_size(16)));
+
+// Correlation averaging time constant
+#define CORRELATION_MS 300.0f
+
+static int gRate = 44100;
+static bool gEnabled = true;
+static LoudnessMeter gMeter;
+static bool gInitialized = false;
+static std::vector<float> gScratch;
+
+// Smoothed L*R, L*L and R*R
+static float gLR = 0.0f;
+static float gLL = 0.0f;
+static float gRR = 0.0f;
+
+void output_meter_set_sample_rate(int rate) {
+  if (rate <= 0 || rate == gRate)
+    return;
+  gRate = rate;
+  output_meter_reset();
+}
+
+void output_meter_set_enabled(bool enabled) {
+  if (enabled && !gEnabled)
+    output_meter_reset();
+  gEnabled = enabled;
+}
+
+bool output_meter_enabled() { return gEnabled; }
+
+void output_meter_reset() {
+  loudness_init(&gMeter, gRate);
+  gInitialized = true;
+  gLR = gLL = gRR = 0.0f;
+}
+
+void output_meter_feed(const int16_t *interleaved, int frames) {
+  if (!gEnabled || frames <= 0)
+    return;
+  if (!gInitialized)
+    output_meter_reset();
+
+  gScratch.resize((size_t)frames * 2);
+  float *x = gScratch.data();
+  for (int i = 0; i < frames * 2; i++)
+    x[i] = interleaved[i] * (1.0f / 32768.0f);
+
+  loudness_feed(&gMeter, x, frames);
+
+  // Channel products, two frames per vector: [L0 R0 L1 R1]
+  v4f lr = {0, 0, 0, 0};
+  v4f sq = {0, 0, 0, 0};
+  int i = 0;
+  for (; i + 2 <= frames; i += 2) {
+    v4f v;
+    memcpy(&v, x + i * 2, sizeof(v));
+    v4f swapped = {v[1], v[0], v[3], v[2]};
+    lr += v * swapped;
+    sq += v * v;
+  }
+  float sumLR = lr[0] + lr[2];
+  float sumLL = sq[0] + sq[2];
+  float sumRR = sq[1] + sq[3];
+  for (; i < frames; i++) {
+    sumLR += x[i * 2] * x[i * 2 + 1];
+    sumLL += x[i * 2] * x[i * 2];
+    sumRR += x[i * 2 + 1] * x[i * 2 + 1];
+  }
+
+  // One-pole average of the per-frame means, weighted by block length
+  float a = std::exp(-(float)frames / (CORRELATION_MS * gRate / 1000.0f));
+  gLR = gLR * a + sumLR / frames * (1.0f - a);
+  gLL = gLL * a + sumLL / frames * (1.0f - a);
+  gRR = gRR * a + sumRR / frames * (1.0f - a);
+}
+
+static float clampDb(float db) {
+  return db > LOUDNESS_SILENCE ? db : LOUDNESS_SILENCE;
+}
+
+void output_meter_get(OutputMeterValues *out) {
+  if (!gEnabled || !gInitialized) {
+    out->momentaryLufs = out->shortTermLufs = out->integratedLufs =
+        LOUDNESS_SILENCE;
+    out->truePeakDb = out->maxTruePeakDb = LOUDNESS_SILENCE;
+    out->correlation = 0.0f;
+    return;
+  }
+  out->momentaryLufs = loudness_momentary(&gMeter);
+  out->shortTermLufs = loudness_short_term(&gMeter);
+  out->integratedLufs = loudness_integrated(&gMeter);
+  out->truePeakDb = clampDb(loudness_momentary_true_peak_db(&gMeter));
+  out->maxTruePeakDb = clampDb(loudness_true_peak_db(&gMeter));
+
+  // Silence (or one silent channel) reads as uncorrelated
+  float norm = std::sqrt(gLL * gRR);
+  out->correlation = norm > 1e-9f ? gLR / norm : 0.0f;
+  if (out->correlation > 1.0f)
+    out->correlation = 1.0f;
+  if (out->correlation < -1.0f)
+    out->correlation = -1.0f;
+}
@@ -0,0 +1,46 @@
+/*
+ * output_meter.h
+ *
+ * Live loudness metering of what the engine actually plays: momentary (400
+ * ms), short-term (3 s) and integrated EBU R128 loudness, true peak and
+ * stereo correlation, taken from the final PCM of every nFillBuffer call
+ * (after effects, fade, time stretch and limiter). The loudness and true
+ * peak come from a LoudnessMeter. Correlation is the normalised L*R
+ * product, averaged with a 300 ms time constant: +1 is mono, 0 unrelated
+ * channels, -1 out of phase.
+ *
+ * Integrated values and the maximum true peak restart for every song. The
+ * meter is on by default; when disabled it costs nothing and reports
+ * silence.
+ *
+ * Called from the JNI thread only, like the rest of the engine.
+ */
+
+#ifndef OUTPUT_METER_H
+#define OUTPUT_METER_H
+
+#include <cstdint>
+
+struct OutputMeterValues {
+  float momentaryLufs;  // LOUDNESS_SILENCE (-70) when silent
+  float shortTermLufs;
+  float integratedLufs; // this song
+  float truePeakDb;     // last 400 ms, dBTP, -70 when silent
+  float maxTruePeakDb;  // this song
+  float correlation;    // -1 .. +1
+};
+
+void output_meter_set_sample_rate(int rate);
+
+void output_meter_set_enabled(bool enabled);
+bool output_meter_enabled();
+
+// Start a new song: integrated loudness and peak hold restart.
+void output_meter_reset();
+
+// Feed interleaved stereo output.
+void output_meter_feed(const int16_t *interleaved, int frames);
+
+void output_meter_get(OutputMeterValues *out);
+
+#endif // OUTPUT_METER_H
@@ -0,0 +1,171 @@
+/*
+ * prefetch.cpp
+ *
+ * A file is mapped with MAPPED_FILE_RANDOM, so the open itself starts no
+ * read-ahead, then read a chunk at a time: MADV_WILLNEED queues the chunk
+ * and touching a byte of each page waits for it. The mapping is dropped
+ * afterwards; the pages stay in the page cache for the real open.
+ *
+ * Requests are told apart by a generation number, bumped by each one; the
+ * worker compares it between chunks.
+ */
+
+#include "prefetch.h"
+
+#include "mapped_file.h"
+#include "vgz_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <thread>
+#include <unistd.h>
+
+#include <android/log.h>
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, "VgmJNI", __VA_ARGS__)
+
+// ANDROID_PRIORITY_BACKGROUND
+#define PREFETCH_NICE 10
+// psflibs a PSF may name: _lib, then _lib2 to _lib9
+#define PSF_MAX_LIBS 9
+
+static std::mutex gLock;
+// Never destroyed: the worker waits on it until the process is gone
+static std::condition_variable &gWake = *new std::condition_variable();
+static std::vector<std::string> gPending;
+static bool gHasPending = false;
+static bool gStarted = false;
+static std::atomic<uint64_t> gGeneration(0);
+
+struct Request {
+  uint64_t generation;
+  size_t budget; // bytes left to read
+};
+
+static bool cancelled(const Request &r) {
+  return gGeneration.load(std::memory_order_relaxed) != r.generation;
+}
+
+static uint32_t le32(const uint8_t *p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+         (uint32_t)p[3] << 24;
+}
+
+// Bring the pages of `f` in, a chunk at a time. False once cancelled or
+// out of budget.
+static bool readPages(const MappedFile *f, Request *r) {
+  static const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  const volatile uint8_t *bytes = (const volatile uint8_t *)f->map;
+  for (size_t off = 0; off < f->mapSize; off += PREFETCH_CHUNK) {
+    if (cancelled(*r) || r->budget == 0)
+      return false;
+    size_t n = std::min<size_t>(PREFETCH_CHUNK, f->mapSize - off);
+    n = std::min(n, r->budget);
+    madvise((uint8_t *)f->map + off, n, MADV_WILLNEED);
+    for (size_t p = 0; p < n; p += page)
+      (void)bytes[off + p];
+    r->budget -= n;
+  }
+  return true;
+}
+
+// The psflibs named by the PSF in `f`, resolved against `path`.
+static std::vector<std::string> psfLibs(const MappedFile *f,
+                                        const std::string &path) {
+  std::vector<std::string> libs;
+  const uint8_t *d = f->data;
+  size_t size = f->size;
+  if (size < 16 || memcmp(d, "PSF", 3) != 0)
+    return libs;
+  uint64_t tags = 16 + (uint64_t)le32(d + 4) + le32(d + 8);
+  if (tags + 5 > size || memcmp(d + tags, "[TAG]", 5) != 0)
+    return libs;
+  size_t slash = path.rfind('/');
+  std::string dir =
+      slash == std::string::npos ? "" : path.substr(0, slash + 1);
+
+  const char *p = (const char *)d + tags + 5;
+  const char *end = (const char *)d + size;
+  while (p < end) {
+    const char *eol = (const char *)memchr(p, '\n', end - p);
+    if (!eol)
+      eol = end;
+    const char *eq = (const char *)memchr(p, '=', eol - p);
+    if (eq && eq - p >= 4 && strncasecmp(p, "_lib", 4) == 0 &&
+        (eq - p == 4 || (eq - p == 5 && p[4] >= '2' && p[4] <= '9'))) {
+      std::string name(eq + 1, eol);
+      while (!name.empty() && (name.back() == '\r' || name.back() == ' '))
+        name.pop_back();
+      if (!name.empty() && libs.size() < PSF_MAX_LIBS)
+        libs.push_back(dir + name);
+    }
+    p = eol + 1;
+  }
+  return libs;
+}
+
+static void prefetchFile(const std::string &path, Request *r) {
+  MappedFile f;
+  if (!mapped_file_open(&f, path.c_str(), MAPPED_FILE_RANDOM))
+    return;
+  // A cached .vgz is opened from its cache entry, not inflated
+  MappedFile cached = {};
+  const MappedFile *data = vgz_cache_open(&cached, &f) ? &cached : &f;
+  bool ok = readPages(data, r);
+  mapped_file_close(&cached);
+  std::vector<std::string> libs = psfLibs(&f, path);
+  mapped_file_close(&f);
+  for (const std::string &lib : libs) {
+    if (!ok)
+      break;
+    MappedFile l;
+    if (mapped_file_open(&l, lib.c_str(), MAPPED_FILE_RANDOM)) {
+      ok = readPages(&l, r);
+      mapped_file_close(&l);
+    }
+  }
+}
+
+static void worker() {
+  setpriority(PRIO_PROCESS, gettid(), PREFETCH_NICE);
+  for (;;) {
+    std::vector<std::string> paths;
+    Request r;
+    {
+      std::unique_lock<std::mutex> lock(gLock);
+      gWake.wait(lock, [] { return gHasPending; });
+      paths.swap(gPending);
+      gHasPending = false;
+      r.generation = gGeneration.load(std::memory_order_relaxed);
+    }
+    r.budget = PREFETCH_BUDGET_BYTES;
+    for (const std::string &path : paths) {
+      if (cancelled(r) || r.budget == 0)
+        break;
+      prefetchFile(path, &r);
+    }
+    LOGD("Prefetch: %zu files, %zu bytes read%s", paths.size(),
+         (size_t)PREFETCH_BUDGET_BYTES - r.budget,
+         cancelled(r) ? ", cancelled" : "");
+  }
+}
+
+void prefetch_files(const std::vector<std::string> &paths) {
+  std::lock_guard<std::mutex> lock(gLock);
+  gGeneration.fetch_add(1, std::memory_order_relaxed);
+  gPending = paths;
+  gHasPending = !paths.empty();
+  if (!gHasPending)
+    return;
+  if (!gStarted) {
+    std::thread(worker).detach();
+    gStarted = true;
+  }
+  gWake.notify_one();
+}
@@ -0,0 +1,35 @@
+/*
+ * prefetch.h
+ *
+ * Reads the files of the tracks coming up next into the page cache while
+ * the current one plays, so switching tracks doesn't wait on cold reads
+ * from flash. Opening a track from a pack also warms the pack's entry
+ * index (and inflates a deflated entry into the zip_archive.h cache), and
+ * a .vgz already in vgz_cache.h has its cache entry read instead of the
+ * compressed data being inflated. The dependencies of a track are read
+ * after it: the psflibs a PSF names in its _lib tags. ROMs libvgm asks for
+ * are kept mapped by rom_cache.h already.
+ *
+ * A single background thread (at background priority) does the reading,
+ * at most PREFETCH_CHUNK bytes at a time and PREFETCH_BUDGET_BYTES per
+ * request, so it never has more than one small read queued in front of
+ * playback's own. Each request replaces the previous one: reading stops
+ * at the next chunk and starts over on the new list.
+ *
+ * Safe to call from any thread.
+ */
+
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <string>
+#include <vector>
+
+#define PREFETCH_CHUNK (256 << 10)
+#define PREFETCH_BUDGET_BYTES (24 << 20)
+
+// Read `paths` (as passed to mapped_file_open) in order, dropping whatever
+// was being read; an empty list just cancels.
+void prefetch_files(const std::vector<std::string> &paths);
+
+#endif // PREFETCH_H
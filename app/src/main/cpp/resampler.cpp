@@ -0,0 +1,174 @@
+/*
+ * resampler.cpp
+ *
+ * Tap j of a phase sits at input frame floor(pos) - taps/2 + 1 + j. The
+ * input starts with taps/2 - 1 silent frames, so the first output lands on
+ * the first input frame and the stream is not delayed.
+ */
+
+#include "resampler.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+typedef float v4f __attribute__((vector_size(16)));
+
+// Input frames consumed before it is worth compacting the buffer
+#define RESAMPLER_COMPACT_FRAMES 4096
+
+struct ResamplerPreset {
+  int taps;
+  double beta;   // Kaiser window shape
+  float rolloff; // passband edge, fraction of Nyquist
+};
+
+static const ResamplerPreset kPresets[] = {
+    {8, 5.0, 0.80f},  // LOW
+    {16, 7.0, 0.88f}, // MEDIUM
+    {32, 9.0, 0.94f}, // HIGH
+};
+
+static double besselI0(double x) {
+  double sum = 1.0, term = 1.0;
+  for (int k = 1; k < 32; k++) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+    if (term < sum * 1e-12)
+      break;
+  }
+  return sum;
+}
+
+static float cutoffFor(const Resampler *r) {
+  float c = kPresets[r->quality].rolloff;
+  return r->ratio > 1.0 ? (float)(c / r->ratio) : c;
+}
+
+static void buildTable(Resampler *r, float cutoff) {
+  int n = r->taps;
+  int half = n / 2;
+  double beta = kPresets[r->quality].beta;
+  double norm = besselI0(beta);
+  r->coefs.resize((size_t)(RESAMPLER_PHASES + 1) * n * 2);
+  double h[64];
+  for (int p = 0; p <= RESAMPLER_PHASES; p++) {
+    double frac = (double)p / RESAMPLER_PHASES;
+    double sum = 0.0;
+    for (int j = 0; j < n; j++) {
+      double d = j - (half - 1) - frac; // distance from the output point
+      double x = d / half;
+      double w = besselI0(beta * std::sqrt(std::fmax(0.0, 1.0 - x * x))) / norm;
+      double t = M_PI * cutoff * d;
+      h[j] = (t == 0.0 ? 1.0 : std::sin(t) / t) * w;
+      sum += h[j];
+    }
+    // Unity gain at DC for every phase
+    float *c = r->coefs.data() + (size_t)p * n * 2;
+    for (int j = 0; j < n; j++)
+      c[j * 2] = c[j * 2 + 1] = (float)(h[j] / sum);
+  }
+  r->cutoff = cutoff;
+}
+
+void resampler_init(Resampler *r, ResamplerQuality quality) {
+  r->quality = quality;
+  r->taps = kPresets[quality].taps;
+  r->ratio = 1.0;
+  buildTable(r, cutoffFor(r));
+  resampler_reset(r);
+}
+
+void resampler_set_quality(Resampler *r, ResamplerQuality quality) {
+  if (quality == r->quality)
+    return;
+  double ratio = r->ratio;
+  resampler_init(r, quality);
+  resampler_set_ratio(r, ratio);
+}
+
+void resampler_set_ratio(Resampler *r, double ratio) {
+  if (!(ratio > 0.0))
+    return;
+  r->ratio = ratio;
+  // Rebuilding costs about a millisecond; small ratio changes keep the table
+  float cutoff = cutoffFor(r);
+  if (std::fabs(cutoff - r->cutoff) > r->cutoff * 0.005f)
+    buildTable(r, cutoff);
+}
+
+void resampler_reset(Resampler *r) {
+  r->in.assign((size_t)(r->taps / 2 - 1) * 2, 0.0f);
+  r->pos = r->taps / 2 - 1;
+}
+
+static int64_t inputFrames(const Resampler *r) {
+  return (int64_t)(r->in.size() / 2);
+}
+
+int resampler_input_wanted(const Resampler *r, int frames) {
+  if (frames <= 0)
+    return 0;
+  double last = r->pos + (frames - 1) * r->ratio;
+  int64_t need = (int64_t)last + r->taps / 2 + 1 - inputFrames(r);
+  return need > 0 ? (int)need : 0;
+}
+
+void resampler_push(Resampler *r, const float *interleaved, int frames) {
+  r->in.insert(r->in.end(), interleaved, interleaved + (size_t)frames * 2);
+}
+
+int resampler_pull(Resampler *r, float *interleaved, int frames) {
+  int n = r->taps;
+  int half = n / 2;
+  int64_t have = inputFrames(r);
+  int out = 0;
+  while (out < frames) {
+    int64_t i = (int64_t)r->pos;
+    if (i + half >= have)
+      break;
+    double fp = (r->pos - i) * RESAMPLER_PHASES;
+    int p = (int)fp;
+    v4f g;
+    g[0] = g[1] = g[2] = g[3] = (float)(fp - p);
+
+    const float *a = r->coefs.data() + (size_t)p * n * 2;
+    const float *b = a + n * 2;
+    const float *x = r->in.data() + (size_t)(i - half + 1) * 2;
+    v4f acc = {0, 0, 0, 0};
+    for (int k = 0; k < n * 2; k += 4) {
+      v4f va, vb, vx;
+      memcpy(&va, a + k, sizeof(va));
+      memcpy(&vb, b + k, sizeof(vb));
+      memcpy(&vx, x + k, sizeof(vx));
+      acc += (va + (vb - va) * g) * vx;
+    }
+    // Lanes hold L, R of even taps and L, R of odd taps
+    interleaved[out * 2] = acc[0] + acc[2];
+    interleaved[out * 2 + 1] = acc[1] + acc[3];
+    out++;
+    r->pos += r->ratio;
+  }
+
+  int64_t drop = (int64_t)r->pos - half + 1;
+  if (drop >= RESAMPLER_COMPACT_FRAMES) {
+    r->in.erase(r->in.begin(), r->in.begin() + (size_t)drop * 2);
+    r->pos -= drop;
+  }
+  return out;
+}
+
+int resampler_buffered(const Resampler *r) {
+  int64_t left = inputFrames(r) - (int64_t)(r->pos + 0.5);
+  return left > 0 ? (int)left : 0;
+}
+
+int resampler_take_raw(Resampler *r, float *interleaved, int frames) {
+  int64_t i = (int64_t)(r->pos + 0.5);
+  int left = resampler_buffered(r);
+  int n = left < frames ? left : frames;
+  if (n > 0)
+    memcpy(interleaved, r->in.data() + i * 2, (size_t)n * 2 * sizeof(float));
+  r->pos = (double)(i + n);
+  return n;
+}
@@ -0,0 +1,195 @@
+/*
+ * reverb.cpp
+ *
+ * Feedback delay network: eight damped delay lines fed back through a
+ * normalised 8x8 Hadamard matrix. Left input drives the even lines and right
+ * input the odd ones; the wet output is read the same way.
+ */
+
+#include "reverb.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// All eight lines as one vector. The compiler splits it into two NEON / SSE
+// registers.
+typedef float v8f __attribute__((vector_size(32)));
+
+// Frames per processing chunk; must stay below the shortest line
+#define REVERB_CHUNK 64
+
+// Mutually prime-ish line lengths, ~30-75 ms
+static const float kLineMs[REVERB_LINES] = {29.7f, 37.1f, 41.1f, 43.7f,
+                                            53.3f, 59.9f, 67.1f, 73.7f};
+static const float kDecaySeconds = 1.8f; // RT60
+static const float kDamping = 0.3f;      // one-pole lowpass in the loop
+static const float kInputGain = 0.35f;
+static const float kWetGain = 0.25f;
+
+static int gRate = 44100;
+static bool gEnabled = false;
+static bool gIdle = true;
+
+static std::vector<float> gLines; // REVERB_LINES * gSize, line after line
+static unsigned gSize = 0;
+static unsigned gMask = 0;
+static unsigned gWrite = 0;
+static int gLen[REVERB_LINES];
+static int gMaxLen = 0;
+static v8f gGain;
+static v8f gLp;
+static int gSilentFrames = 0;
+
+static void configure() {
+  gMaxLen = 0;
+  float gain[REVERB_LINES];
+  for (int l = 0; l < REVERB_LINES; l++) {
+    gLen[l] = (int)(kLineMs[l] * gRate / 1000.0f + 0.5f);
+    if (gLen[l] < REVERB_CHUNK)
+      gLen[l] = REVERB_CHUNK;
+    if (gLen[l] > gMaxLen)
+      gMaxLen = gLen[l];
+    // Per-line loss giving -60 dB after kDecaySeconds
+    gain[l] = std::pow(10.0f, -3.0f * gLen[l] / (kDecaySeconds * gRate));
+  }
+  memcpy(&gGain, gain, sizeof(gGain));
+
+  gSize = 1;
+  while (gSize < (unsigned)(gMaxLen + REVERB_CHUNK))
+    gSize <<= 1;
+  gMask = gSize - 1;
+  gLines.assign((size_t)gSize * REVERB_LINES, 0.0f);
+  reverb_reset();
+}
+
+void reverb_set_sample_rate(int rate) {
+  if (rate <= 0 || rate == gRate)
+    return;
+  gRate = rate;
+  if (!gLines.empty())
+    configure();
+}
+
+void reverb_set_enabled(bool enabled) {
+  gEnabled = enabled;
+  if (enabled && gLines.empty())
+    configure();
+}
+
+bool reverb_enabled() { return gEnabled; }
+
+bool reverb_active() { return gEnabled || !gIdle; }
+
+void reverb_reset() {
+  if (!gLines.empty())
+    memset(gLines.data(), 0, gLines.size() * sizeof(float));
+  gLp = v8f{0, 0, 0, 0, 0, 0, 0, 0};
+  gWrite = 0;
+  gSilentFrames = 0;
+  gIdle = true;
+}
+
+// Orthogonal mix of the eight lines (fast Walsh-Hadamard, 1/sqrt(8) scaled).
+static inline void hadamard(v8f &v) {
+  float h[REVERB_LINES];
+  memcpy(h, &v, sizeof(h));
+  for (int span = 1; span < REVERB_LINES; span <<= 1) {
+    for (int i = 0; i < REVERB_LINES; i += span * 2) {
+      for (int j = i; j < i + span; j++) {
+        float a = h[j];
+        float b = h[j + span];
+        h[j] = a + b;
+        h[j + span] = a - b;
+      }
+    }
+  }
+  memcpy(&v, h, sizeof(v));
+  v *= 0.35355339f;
+}
+
+static void processChunk(float *x, int n) {
+  alignas(32) float taps[REVERB_CHUNK * REVERB_LINES];
+
+  // Gather: each line's outputs for the chunk are contiguous in the line
+  for (int l = 0; l < REVERB_LINES; l++) {
+    const float *line = gLines.data() + (size_t)l * gSize;
+    unsigned r = gWrite - (unsigned)gLen[l];
+    for (int i = 0; i < n; i++)
+      taps[i * REVERB_LINES + l] = line[(r + i) & gMask];
+  }
+
+  const float in = gEnabled ? kInputGain : 0.0f;
+  v8f lp = gLp;
+  v8f energy = {0, 0, 0, 0, 0, 0, 0, 0};
+  float inPeak = 0.0f;
+  for (int i = 0; i < n; i++) {
+    v8f y;
+    memcpy(&y, taps + i * REVERB_LINES, sizeof(y));
+    energy += y * y;
+
+    float dl = x[i * 2];
+    float dr = x[i * 2 + 1];
+    x[i * 2] = dl + (y[0] + y[2] + y[4] + y[6]) * kWetGain;
+    x[i * 2 + 1] = dr + (y[1] + y[3] + y[5] + y[7]) * kWetGain;
+
+    lp = y + (lp - y) * kDamping;
+    v8f fb = lp * gGain;
+    hadamard(fb);
+    float il = dl * in;
+    float ir = dr * in;
+    fb += v8f{il, ir, il, ir, il, ir, il, ir};
+    memcpy(taps + i * REVERB_LINES, &fb, sizeof(fb));
+
+    float p = std::fabs(dl) > std::fabs(dr) ? std::fabs(dl) : std::fabs(dr);
+    if (p > inPeak)
+      inPeak = p;
+  }
+  gLp = lp;
+
+  // Scatter the new line inputs
+  for (int l = 0; l < REVERB_LINES; l++) {
+    float *line = gLines.data() + (size_t)l * gSize;
+    for (int i = 0; i < n; i++)
+      line[(gWrite + i) & gMask] = taps[i * REVERB_LINES + l];
+  }
+  gWrite += n;
+
+  // Once nothing has gone in and nothing above the threshold has come out
+  // for a full pass over the longest line, the network holds only silence
+  float peakEnergy = 0.0f;
+  for (int l = 0; l < REVERB_LINES; l++) {
+    if (energy[l] > peakEnergy)
+      peakEnergy = energy[l];
+  }
+  bool silent = (!gEnabled || inPeak < REVERB_SILENCE) &&
+                peakEnergy < REVERB_SILENCE * REVERB_SILENCE * n;
+  gSilentFrames = silent ? gSilentFrames + n : 0;
+  if (gSilentFrames >= gMaxLen + REVERB_CHUNK)
+    reverb_reset();
+}
+
+void reverb_process(float *interleaved, int frames) {
+  if (!reverb_active())
+    return;
+  if (gLines.empty())
+    configure();
+
+  float *x = interleaved;
+  int left = frames;
+  while (left > 0) {
+    int n = left < REVERB_CHUNK ? left : REVERB_CHUNK;
+    if (gIdle) {
+      // Wake up only for actual sound
+      bool sound = false;
+      for (int i = 0; i < n * 2 && !sound; i++)
+        sound = std::fabs(x[i]) >= REVERB_SILENCE;
+      if (sound)
+        gIdle = false;
+    }
+    if (!gIdle)
+      processChunk(x, n);
+    x += n * 2;
+    left -= n;
+  }
+}
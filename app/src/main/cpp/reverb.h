@@ -0,0 +1,42 @@
+/*
+ * reverb.h
+ *
+ * Algorithmic room reverb for the engine's float effects chain: an eight-line
+ * feedback delay network with a Hadamard mixing matrix and per-line damping.
+ * Delay lengths are given in milliseconds and converted for the current
+ * output rate, so the room sounds the same at 44.1 and 48 kHz. Each line is a
+ * power-of-two buffer indexed with a mask.
+ *
+ * Blocks are processed in chunks no longer than the shortest line, so the
+ * reads of a chunk never see its own writes. The eight lines then run in
+ * lockstep as one vector. Once input has been silent long enough for every
+ * line to drain below REVERB_SILENCE, the network is cleared and skipped
+ * until sound comes in again.
+ *
+ * Called from the JNI thread only, like the rest of the engine.
+ */
+
+#ifndef REVERB_H
+#define REVERB_H
+
+#define REVERB_LINES 8
+
+// Line taps below this (about -100 dBFS) count as silence
+#define REVERB_SILENCE 1e-5f
+
+void reverb_set_sample_rate(int rate);
+
+// Turning the reverb off stops feeding it; the tail still rings out.
+void reverb_set_enabled(bool enabled);
+bool reverb_enabled();
+
+// True while enabled or while a tail is still decaying.
+bool reverb_active();
+
+// Add the wet signal to an interleaved stereo float block in place.
+void reverb_process(float *interleaved, int frames);
+
+// Drop the tail immediately.
+void reverb_reset();
+
+#endif // REVERB_H
@@ -0,0 +1,201 @@
+/*
+ * rom_cache.cpp
+ *
+ * Images are shared_ptrs: the cache holds one reference and every loader
+ * handed out another, so an image stays mapped while libvgm reads it even
+ * if the cache is cleared meanwhile.
+ */
+
+#include "rom_cache.h"
+
+#include "mapped_file.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <android/log.h>
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, "VgmJNI", __VA_ARGS__)
+
+// Four-character code of the loader, "ROMC"
+#define ROM_LOADER_TYPE 0x524F4D43
+
+struct RomImage {
+  MappedFile file;
+  RomImage() { memset(&file, 0, sizeof(file)); }
+  ~RomImage() { mapped_file_close(&file); }
+};
+
+static std::mutex gLock;
+static std::string gDir;
+// Null for a name found nowhere
+static std::unordered_map<std::string, std::shared_ptr<RomImage>> gImages;
+
+// Map `name` by the request callback's search order, or null.
+static std::shared_ptr<RomImage> find(const std::string &name,
+                                      const std::string &dir) {
+  std::shared_ptr<RomImage> image = std::make_shared<RomImage>();
+  // Loaded into libvgm's buffer from start to end
+  if (mapped_file_open(&image->file, name.c_str(), MAPPED_FILE_SEQUENTIAL))
+    return image;
+  if (!dir.empty()) {
+    std::string path = dir;
+    if (path.back() != '/')
+      path += "/";
+    path += name;
+    if (mapped_file_open(&image->file, path.c_str(), MAPPED_FILE_SEQUENTIAL))
+      return image;
+  }
+  std::string asset = std::string(MAPPED_FILE_ASSET_PREFIX) + name;
+  if (mapped_file_open(&image->file, asset.c_str(), MAPPED_FILE_SEQUENTIAL))
+    return image;
+  return nullptr;
+}
+
+static bool hasRomExtension(const char *name) {
+  static const char *const kExtensions[] = ROM_CACHE_EXTENSIONS;
+  const char *ext = strrchr(name, '.');
+  if (!ext)
+    return false;
+  for (const char *e : kExtensions)
+    if (strcasecmp(ext, e) == 0)
+      return true;
+  return false;
+}
+
+void rom_cache_set_dir(const char *dir) {
+  std::lock_guard<std::mutex> lock(gLock);
+  gDir = dir;
+  for (auto it = gImages.begin(); it != gImages.end();) {
+    if (it->second)
+      ++it;
+    else
+      it = gImages.erase(it);
+  }
+
+  static const char *const kBundled[] = ROM_CACHE_BUNDLED;
+  std::vector<std::string> names(std::begin(kBundled), std::end(kBundled));
+  if (DIR *d = opendir(dir)) {
+    while (struct dirent *e = readdir(d))
+      if (e->d_type != DT_DIR && hasRomExtension(e->d_name))
+        names.push_back(e->d_name);
+    closedir(d);
+  }
+  for (const std::string &name : names) {
+    if (gImages.count(name))
+      continue;
+    std::shared_ptr<RomImage> image = find(name, gDir);
+    if (image) {
+      gImages[name] = image;
+      LOGD("ROM cache: preloaded %s (%zu bytes)", name.c_str(),
+           image->file.size);
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+// libvgm DATA_LOADER over a cached image
+// ---------------------------------------------------------------------------
+
+struct RomLoader {
+  std::shared_ptr<RomImage> image;
+  UINT32 pos;
+};
+
+static UINT32 imageLength(const RomLoader *l) {
+  size_t size = l->image->file.size;
+  return size > 0xFFFFFFFFu ? 0xFFFFFFFFu : (UINT32)size;
+}
+
+static UINT8 loaderOpen(void *context) {
+  ((RomLoader *)context)->pos = 0;
+  return 0x00;
+}
+
+static UINT32 loaderRead(void *context, UINT8 *buffer, UINT32 numBytes) {
+  RomLoader *l = (RomLoader *)context;
+  UINT32 left = imageLength(l) - l->pos;
+  if (numBytes > left)
+    numBytes = left;
+  memcpy(buffer, l->image->file.data + l->pos, numBytes);
+  l->pos += numBytes;
+  return numBytes;
+}
+
+static UINT8 loaderSeek(void *context, UINT32 offset, UINT8 whence) {
+  RomLoader *l = (RomLoader *)context;
+  int64_t target = offset;
+  if (whence == SEEK_CUR)
+    target += l->pos;
+  else if (whence == SEEK_END)
+    target += imageLength(l);
+  if (target < 0 || target > imageLength(l))
+    return 0xFF;
+  l->pos = (UINT32)target;
+  return 0x00;
+}
+
+static UINT8 loaderClose(void *) { return 0x00; }
+
+static INT32 loaderTell(void *context) {
+  return (INT32)((RomLoader *)context)->pos;
+}
+
+static UINT32 loaderLength(void *context) {
+  return imageLength((RomLoader *)context);
+}
+
+static UINT8 loaderEof(void *context) {
+  RomLoader *l = (RomLoader *)context;
+  return l->pos >= imageLength(l);
+}
+
+static UINT8 loaderDeinit(void *context) {
+  delete (RomLoader *)context;
+  return 0x00;
+}
+
+static const DATA_LOADER_CALLBACKS kRomLoaderCallbacks = {
+    ROM_LOADER_TYPE, "ROM Cache Loader",
+    loaderOpen,      loaderRead,
+    loaderSeek,      loaderClose,
+    loaderTell,      loaderLength,
+    loaderEof,       loaderDeinit,
+};
+
+DATA_LOADER *rom_cache_loader(const char *fileName) {
+  std::shared_ptr<RomImage> image;
+  {
+    std::lock_guard<std::mutex> lock(gLock);
+    auto it = gImages.find(fileName);
+    if (it != gImages.end()) {
+      image = it->second;
+    } else {
+      image = find(fileName, gDir);
+      gImages[fileName] = image;
+      LOGD("ROM cache: %s %s", fileName, image ? "loaded" : "not found");
+    }
+  }
+  if (!image)
+    return nullptr;
+
+  RomLoader *l = new (std::nothrow) RomLoader();
+  if (!l)
+    return nullptr;
+  l->image = image;
+  DATA_LOADER *loader = (DATA_LOADER *)calloc(1, sizeof(DATA_LOADER));
+  if (!loader) {
+    delete l;
+    return nullptr;
+  }
+  DataLoader_Setup(loader, &kRomLoaderCallbacks, l);
+  return loader;
+}
@@ -0,0 +1,36 @@
+/*
+ * rom_cache.h
+ *
+ * Process-wide cache of the ROM images libvgm asks for while loading a VGM
+ * (YMF278B's yrw801.rom and other external sample ROMs). The file request
+ * callback used to map and read the ROM anew on every track open, trying
+ * the bare name, then the ROM directory, then the APK.
+ *
+ * A name is looked up in that order once; the image found is kept, mapped,
+ * for the life of the process, and a name found nowhere is remembered as
+ * missing until the ROM directory changes. Setting the directory preloads
+ * every ROM in it (ROM_CACHE_EXTENSIONS) and the ROMs bundled in the APK
+ * (ROM_CACHE_BUNDLED), so opening a track that needs one makes no file
+ * system calls, and its pages are already being read in.
+ *
+ * libvgm takes ownership of the loader it is handed and reads it into its
+ * own buffer; the loader reads from the cached image and keeps it alive
+ * until freed. Safe to call from any thread.
+ */
+
+#ifndef ROM_CACHE_H
+#define ROM_CACHE_H
+
+#include "libvgm/utils/DataLoader.h"
+
+#define ROM_CACHE_EXTENSIONS {".rom", ".bin"}
+#define ROM_CACHE_BUNDLED {"yrw801.rom"}
+
+// Search `dir` after the bare name, forget missing names, and preload.
+void rom_cache_set_dir(const char *dir);
+
+// A loader over the image of `fileName`, not yet loaded; null if there is
+// no such ROM. Freed by DataLoader_Deinit.
+DATA_LOADER *rom_cache_loader(const char *fileName);
+
+#endif // ROM_CACHE_H
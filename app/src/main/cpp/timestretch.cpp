@@ -0,0 +1,351 @@
+/*
+ * timestretch.cpp
+ *
+ * Frame positions are counted from the first input frame after a reset.
+ * gIn holds input from gInBase on; gMono holds its half-rate mono mix, one
+ * value per two frames, so gInBase is kept even.
+ */
+
+#include "timestretch.h"
+
+#include "resampler.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+typedef float v4f __attribute__((vector_size(16)));
+
+// Input kept before it is worth compacting the buffers
+#define TIMESTRETCH_COMPACT_FRAMES 4096
+// Stereo refinement around the best coarse candidate, in frames
+#define TIMESTRETCH_REFINE 3
+// Stretched frames moved to the resampler at a time
+#define TIMESTRETCH_RS_CHUNK 256
+
+static int gRate = 44100;
+static float gSpeed = 1.0f;
+static float gPitch = 1.0f;
+
+static int gWindow = 0; // grain length, frames (even)
+static int gHop = 0;    // output hop, half a grain
+static int gSeek = 0;   // search range either side, frames
+static std::vector<float> gWin; // Hann, sums to 1 at 50% overlap
+
+static std::vector<float> gIn;   // interleaved stereo input
+static std::vector<float> gMono; // half-rate mono mix of gIn
+static int64_t gInBase = 0;
+
+static bool gStarted = false;
+static double gPos = 0.0;    // nominal start of the next grain
+static int64_t gPrev = 0;    // actual start of the previous grain
+static std::vector<float> gTail; // windowed second half of the previous grain
+
+static std::vector<float> gOut; // stretched frames not yet pulled
+static size_t gOutPos = 0;      // frames of gOut already pulled
+
+static Resampler gResampler; // pitch, after the grains
+static bool gResamplerInit = false;
+static ResamplerQuality gQuality = RESAMPLER_MEDIUM;
+static bool gResampling = false; // gResampler holds stretched audio
+
+static void configure() {
+  gWindow = ((int)(TIMESTRETCH_WINDOW_MS * gRate / 1000.0f) + 3) & ~3;
+  gHop = gWindow / 2;
+  gSeek = (int)(TIMESTRETCH_SEEK_MS * gRate / 1000.0f);
+  gWin.resize(gWindow);
+  for (int i = 0; i < gWindow; i++) {
+    float s = std::sin((float)M_PI * (i + 0.5f) / gWindow);
+    gWin[i] = s * s;
+  }
+  gTail.assign((size_t)gHop * 2, 0.0f);
+  if (!gResamplerInit) {
+    resampler_init(&gResampler, gQuality);
+    gResamplerInit = true;
+  }
+}
+
+void timestretch_set_sample_rate(int rate) {
+  if (rate <= 0 || rate == gRate)
+    return;
+  gRate = rate;
+  timestretch_reset();
+  configure();
+}
+
+void timestretch_set_speed(float speed) {
+  if (speed < TIMESTRETCH_MIN_SPEED)
+    speed = TIMESTRETCH_MIN_SPEED;
+  if (speed > TIMESTRETCH_MAX_SPEED)
+    speed = TIMESTRETCH_MAX_SPEED;
+  gSpeed = speed;
+}
+
+float timestretch_speed() { return gSpeed; }
+
+void timestretch_set_pitch(float ratio) {
+  if (ratio < TIMESTRETCH_MIN_PITCH)
+    ratio = TIMESTRETCH_MIN_PITCH;
+  if (ratio > TIMESTRETCH_MAX_PITCH)
+    ratio = TIMESTRETCH_MAX_PITCH;
+  gPitch = ratio;
+}
+
+float timestretch_pitch() { return gPitch; }
+
+bool timestretch_active() {
+  return gSpeed != 1.0f || gPitch != 1.0f || gStarted ||
+         gOutPos < gOut.size() / 2 || gResampling;
+}
+
+// Input advance per output frame of the grains; the resampler makes up the
+// difference to `gSpeed`
+static float stretchFactor() { return gSpeed / gPitch; }
+
+void timestretch_reset() {
+  gIn.clear();
+  gMono.clear();
+  gInBase = 0;
+  gStarted = false;
+  gPos = 0.0;
+  gPrev = 0;
+  gOut.clear();
+  gOutPos = 0;
+  if (gResamplerInit)
+    resampler_reset(&gResampler);
+  gResampling = false;
+}
+
+void timestretch_set_resampler_quality(ResamplerQuality quality) {
+  gQuality = quality;
+  if (gResamplerInit)
+    resampler_set_quality(&gResampler, quality);
+  gResampling = false;
+}
+
+static int64_t inputEnd() { return gInBase + (int64_t)(gIn.size() / 2); }
+
+static const float *inputAt(int64_t frame) {
+  return gIn.data() + (size_t)(frame - gInBase) * 2;
+}
+
+// Dot product of a and b and the energy of a, n floats.
+static void dotEnergy(const float *a, const float *b, int n, float *dot,
+                      float *energy) {
+  v4f d = {0, 0, 0, 0};
+  v4f e = {0, 0, 0, 0};
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    v4f va, vb;
+    memcpy(&va, a + i, sizeof(va));
+    memcpy(&vb, b + i, sizeof(vb));
+    d += va * vb;
+    e += va * va;
+  }
+  float sd = d[0] + d[1] + d[2] + d[3];
+  float se = e[0] + e[1] + e[2] + e[3];
+  for (; i < n; i++) {
+    sd += a[i] * b[i];
+    se += a[i] * a[i];
+  }
+  *dot = sd;
+  *energy = se;
+}
+
+// Normalised match of a candidate against the template (same length)
+static float score(float dot, float energy) {
+  return dot / std::sqrt(energy + 1e-9f);
+}
+
+// Start in [lo, hi] whose first half grain best continues the previous one.
+static int64_t bestStart(int64_t lo, int64_t hi) {
+  int64_t natural = gPrev + gHop;
+
+  // Coarse: even starts only, every other one, on the mono mix
+  int monoLen = gHop / 2;
+  const float *tmplMono = gMono.data() + (natural - gInBase) / 2;
+  int64_t best = lo;
+  float bestScore = -INFINITY;
+  for (int64_t s = (lo + 1) & ~(int64_t)1; s <= hi; s += 4) {
+    float d, e;
+    dotEnergy(gMono.data() + (s - gInBase) / 2, tmplMono, monoLen, &d, &e);
+    float sc = score(d, e);
+    if (sc > bestScore) {
+      bestScore = sc;
+      best = s;
+    }
+  }
+
+  // Fine: every start near the coarse winner, both channels
+  int64_t from = best - TIMESTRETCH_REFINE;
+  int64_t to = best + TIMESTRETCH_REFINE;
+  if (from < lo)
+    from = lo;
+  if (to > hi)
+    to = hi;
+  const float *tmpl = inputAt(natural);
+  bestScore = -INFINITY;
+  for (int64_t s = from; s <= to; s++) {
+    float d, e;
+    dotEnergy(inputAt(s), tmpl, gHop * 2, &d, &e);
+    float sc = score(d, e);
+    if (sc > bestScore) {
+      bestScore = sc;
+      best = s;
+    }
+  }
+  return best;
+}
+
+static void emit(const float *frames, int n) {
+  gOut.insert(gOut.end(), frames, frames + (size_t)n * 2);
+}
+
+// Play what is buffered unchanged. Continuing the input from where the
+// previous grain's tail would have been completed keeps the output seamless.
+static void drainRaw() {
+  int64_t from = gStarted ? gPrev + gHop : (int64_t)gPos;
+  if (inputEnd() > from)
+    emit(inputAt(from), (int)(inputEnd() - from));
+  gIn.clear();
+  gMono.clear();
+  gInBase = 0;
+  gStarted = false;
+  gPos = 0.0;
+  gPrev = 0;
+}
+
+static void compact() {
+  int64_t keep = (int64_t)gPos - gSeek - TIMESTRETCH_REFINE - 4;
+  if (gPrev + gHop < keep)
+    keep = gPrev + gHop;
+  keep &= ~(int64_t)1;
+  if (keep - gInBase < TIMESTRETCH_COMPACT_FRAMES)
+    return;
+  int64_t drop = keep - gInBase;
+  gIn.erase(gIn.begin(), gIn.begin() + (size_t)drop * 2);
+  gMono.erase(gMono.begin(), gMono.begin() + (size_t)drop / 2);
+  gInBase = keep;
+}
+
+int timestretch_input_wanted() {
+  if (gWindow == 0)
+    configure();
+  int64_t need = (int64_t)gPos + gWindow;
+  if (gStarted)
+    need += gSeek + TIMESTRETCH_REFINE + 4;
+  int64_t missing = need - inputEnd();
+  return missing > 0 ? (int)missing : 0;
+}
+
+// Make grains while the input allows.
+static void run() {
+  if (stretchFactor() == 1.0f) {
+    drainRaw();
+    return;
+  }
+  while (timestretch_input_wanted() == 0) {
+    int64_t start;
+    if (!gStarted) {
+      // First grain: its first half plays unwindowed, as if continuing
+      start = (int64_t)gPos;
+      emit(inputAt(start), gHop);
+      gStarted = true;
+    } else {
+      int64_t nominal = (int64_t)gPos;
+      int64_t lo = nominal - gSeek;
+      if (lo < gInBase)
+        lo = gInBase;
+      start = bestStart(lo, nominal + gSeek);
+
+      const float *x = inputAt(start);
+      size_t at = gOut.size();
+      gOut.resize(at + (size_t)gHop * 2);
+      float *o = gOut.data() + at;
+      for (int i = 0; i < gHop; i++) {
+        o[i * 2] = gTail[i * 2] + x[i * 2] * gWin[i];
+        o[i * 2 + 1] = gTail[i * 2 + 1] + x[i * 2 + 1] * gWin[i];
+      }
+    }
+
+    const float *x = inputAt(start + gHop);
+    for (int i = 0; i < gHop; i++) {
+      gTail[i * 2] = x[i * 2] * gWin[gHop + i];
+      gTail[i * 2 + 1] = x[i * 2 + 1] * gWin[gHop + i];
+    }
+    gPrev = start;
+    gPos += gHop * stretchFactor();
+    compact();
+  }
+}
+
+void timestretch_push(const float *interleaved, int frames) {
+  if (gWindow == 0)
+    configure();
+  gIn.insert(gIn.end(), interleaved, interleaved + (size_t)frames * 2);
+  // Mono pairs need both frames; an odd trailing frame waits
+  size_t pairs = gIn.size() / 4;
+  for (size_t m = gMono.size(); m < pairs; m++) {
+    const float *f = gIn.data() + m * 4;
+    gMono.push_back((f[0] + f[1] + f[2] + f[3]) * 0.25f);
+  }
+  run();
+}
+
+static int pullStretched(float *interleaved, int frames) {
+  size_t queued = gOut.size() / 2 - gOutPos;
+  if (queued == 0) {
+    run();
+    queued = gOut.size() / 2 - gOutPos;
+  }
+  int n = queued < (size_t)frames ? (int)queued : frames;
+  memcpy(interleaved, gOut.data() + gOutPos * 2, (size_t)n * 2 * sizeof(float));
+  gOutPos += n;
+  if (gOutPos == gOut.size() / 2) {
+    gOut.clear();
+    gOutPos = 0;
+  }
+  return n;
+}
+
+// Read the stretched frames `gPitch` times faster than real time.
+static int pullResampled(float *interleaved, int frames) {
+  if (gPitch == 1.0f) {
+    // Back at the original pitch: play out the rest unfiltered, then bypass
+    int n = resampler_take_raw(&gResampler, interleaved, frames);
+    if (resampler_buffered(&gResampler) == 0) {
+      resampler_reset(&gResampler);
+      gResampling = false;
+    }
+    return n;
+  }
+
+  gResampling = true;
+  resampler_set_ratio(&gResampler, gPitch);
+  float buf[TIMESTRETCH_RS_CHUNK * 2];
+  int n = 0;
+  while (n < frames) {
+    n += resampler_pull(&gResampler, interleaved + n * 2, frames - n);
+    if (n == frames)
+      break;
+    int want = resampler_input_wanted(&gResampler, frames - n);
+    if (want > TIMESTRETCH_RS_CHUNK)
+      want = TIMESTRETCH_RS_CHUNK;
+    int got = pullStretched(buf, want);
+    if (got == 0)
+      break;
+    resampler_push(&gResampler, buf, got);
+  }
+  return n;
+}
+
+int timestretch_pull(float *interleaved, int frames) {
+  if (gWindow == 0)
+    configure();
+  if (gPitch == 1.0f && !gResampling)
+    return pullStretched(interleaved, frames);
+  return pullResampled(interleaved, frames);
+}
+
+void timestretch_finish() { drainRaw(); }
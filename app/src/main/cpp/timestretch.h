@@ -0,0 +1,79 @@
+/*
+ * timestretch.h
+ *
+ * Pitch-preserving time stretch (WSOLA) for practice slowdown. It sits
+ * between the engine's effects and its limiter, so it works the same for
+ * every backend and its overshoots are limited like the rest. The rest of
+ * the engine keeps running in track time: positions, fades, loop cache and
+ * crossfades don't notice the speed.
+ *
+ * Output is built from Hann-windowed grains of TIMESTRETCH_WINDOW_MS with
+ * 50% overlap. Each grain is read from roughly `speed` times the output hop
+ * further into the input. Its exact start, within TIMESTRETCH_SEEK_MS, is
+ * where the input best matches the natural continuation of the previous
+ * grain, so the overlap adds up in phase. The search is coarse on a
+ * half-rate mono copy, then refined on the stereo signal. Both are
+ * four-lane vector dot products.
+ *
+ * The same stage shifts pitch for backends that can't transpose themselves
+ * (see transpose.h) and for varispeed: the grains are laid out for
+ * speed / pitch, and a polyphase resampler (see resampler.h) then reads them
+ * `pitch` times faster, restoring the duration. With pitch equal to speed
+ * the grains are skipped and only the resampler runs.
+ *
+ * Added latency is about one window plus the seek range (~40 ms). Back at
+ * speed and pitch 1.0 the buffered audio is played out unchanged and the
+ * stage goes idle.
+ *
+ * Called from the JNI thread only, like the rest of the engine.
+ */
+
+#ifndef TIMESTRETCH_H
+#define TIMESTRETCH_H
+
+#include "resampler.h"
+
+#define TIMESTRETCH_MIN_SPEED 0.25f
+#define TIMESTRETCH_MAX_SPEED 1.0f
+
+#define TIMESTRETCH_MIN_PITCH 0.125f
+#define TIMESTRETCH_MAX_PITCH 2.0f
+
+#define TIMESTRETCH_WINDOW_MS 30.0f
+#define TIMESTRETCH_SEEK_MS 8.0f
+
+void timestretch_set_sample_rate(int rate);
+
+// Clamped to TIMESTRETCH_MIN_SPEED..TIMESTRETCH_MAX_SPEED; 1.0 is bypass.
+void timestretch_set_speed(float speed);
+float timestretch_speed();
+
+// Frequency ratio, clamped to TIMESTRETCH_MIN_PITCH..TIMESTRETCH_MAX_PITCH;
+// 1.0 is bypass.
+void timestretch_set_pitch(float ratio);
+float timestretch_pitch();
+
+// Filter length of the pitch resampler; drops audio it holds.
+void timestretch_set_resampler_quality(ResamplerQuality quality);
+
+// True while slowed down or pitched, or while processed audio is still
+// queued.
+bool timestretch_active();
+
+// Input frames still missing before the next grain can be made; 0 when
+// output can be pulled.
+int timestretch_input_wanted();
+
+// Append interleaved stereo input (track time).
+void timestretch_push(const float *interleaved, int frames);
+
+// Take up to `frames` processed frames. Returns the frames written.
+int timestretch_pull(float *interleaved, int frames);
+
+// The input has ended: queue what is buffered unchanged and start over.
+void timestretch_finish();
+
+// Drop everything buffered (seek, new track).
+void timestretch_reset();
+
+#endif // TIMESTRETCH_H
@@ -0,0 +1,226 @@
+/*
+ * transpose.cpp
+ *
+ * VGM header offsets follow the VGM 1.71 specification. Clock fields keep
+ * their top two bits, which flag a second chip or a chip variant.
+ */
+
+#include "transpose.h"
+
+#include <cmath>
+#include <cstring>
+
+// Clock fields of the tone-generating chips
+static const uint16_t kVgmClockOffsets[] = {
+    0x0C, // SN76489
+    0x10, // YM2413
+    0x2C, // YM2612
+    0x30, // YM2151
+    0x38, // SegaPCM
+    0x40, // RF5C68
+    0x44, // YM2203
+    0x48, // YM2608
+    0x4C, // YM2610
+    0x50, // YM3812
+    0x54, // YM3526
+    0x58, // Y8950
+    0x5C, // YMF262
+    0x60, // YMF278B
+    0x64, // YMF271
+    0x68, // YMZ280B
+    0x6C, // RF5C164
+    0x74, // AY8910
+    0x80, // Game Boy DMG
+    0x84, // NES APU
+    0x88, // MultiPCM
+    0x98, // OKIM6295
+    0x9C, // K051649
+    0xA0, // K054539
+    0xA4, // HuC6280
+    0xA8, // C140
+    0xAC, // K053260
+    0xB0, // Pokey
+    0xB4, // QSound
+    0xB8, // SCSP
+    0xC0, // WonderSwan
+    0xC4, // Virtual Boy VSU
+    0xC8, // SAA1099
+    0xCC, // ES5503
+    0xD0, // ES5506
+    0xD8, // X1-010
+    0xDC, // C352
+    0xE0, // GA20
+};
+
+#define CLOCK_FLAGS 0xC0000000u
+
+double transpose_ratio(int semitones) {
+  return std::pow(2.0, semitones / 12.0);
+}
+
+static uint32_t readLE32(const uint8_t *p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+         (uint32_t)p[3] << 24;
+}
+
+static void writeLE32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+bool transpose_vgm_clocks(uint8_t *data, size_t size, const uint8_t *header,
+                          size_t headerSize, int semitones) {
+  if (size < 0x40 || headerSize < 0x40 || memcmp(header, "Vgm ", 4) != 0)
+    return false;
+
+  // Only fields before the command data are header; older versions end the
+  // clock list earlier
+  uint32_t version = readLE32(header + 0x08);
+  size_t end = 0x40;
+  if (version >= 0x150 && readLE32(header + 0x34) != 0)
+    end = 0x34 + (size_t)readLE32(header + 0x34);
+  if (version < 0x151 && end > 0x38)
+    end = 0x38;
+  if (end > size)
+    end = size;
+  if (end > headerSize)
+    end = headerSize;
+
+  double ratio = transpose_ratio(semitones);
+  for (uint16_t ofs : kVgmClockOffsets) {
+    if (ofs + 4u > end)
+      continue;
+    uint32_t field = readLE32(header + ofs);
+    uint32_t clock = field & ~CLOCK_FLAGS;
+    if (clock == 0)
+      continue;
+    double scaled = std::floor(clock * ratio + 0.5);
+    if (scaled > (double)~CLOCK_FLAGS)
+      scaled = (double)~CLOCK_FLAGS;
+    writeLE32(data + ofs, (field & CLOCK_FLAGS) | (uint32_t)scaled);
+  }
+  return true;
+}
+
+static uint32_t readBE32(const uint8_t *p) {
+  return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 |
+         (uint32_t)p[3];
+}
+
+// Variable-length quantity at `*p`, at most four bytes. False past `end`.
+static bool readVarLen(const uint8_t *d, size_t *p, size_t end,
+                       uint32_t *value) {
+  uint32_t v = 0;
+  for (int i = 0; i < 4; i++) {
+    if (*p >= end)
+      return false;
+    uint8_t b = d[(*p)++];
+    v = (v << 7) | (b & 0x7F);
+    if (!(b & 0x80)) {
+      *value = v;
+      return true;
+    }
+  }
+  return false;
+}
+
+static uint8_t shiftNote(uint8_t note, int semitones) {
+  int n = note + semitones;
+  while (n > 127)
+    n -= 12;
+  while (n < 0)
+    n += 12;
+  return (uint8_t)n;
+}
+
+// Shift the notes of one MTrk chunk body, d[p..end), in place.
+static bool transposeTrack(uint8_t *d, size_t p, size_t end, int semitones) {
+  uint8_t running = 0;
+  while (p < end) {
+    uint32_t delta, len;
+    if (!readVarLen(d, &p, end, &delta) || p >= end)
+      return false;
+    uint8_t status = d[p];
+    if (status == 0xFF) {
+      // Meta event: type, length, data
+      p += 2;
+      if (p > end || !readVarLen(d, &p, end, &len) || len > end - p)
+        return false;
+      p += len;
+      running = 0;
+      continue;
+    }
+    if (status == 0xF0 || status == 0xF7) {
+      p++;
+      if (!readVarLen(d, &p, end, &len) || len > end - p)
+        return false;
+      p += len;
+      running = 0;
+      continue;
+    }
+    if (status & 0x80) {
+      running = status;
+      p++;
+    } else if (!running) {
+      return false;
+    }
+
+    uint8_t type = running & 0xF0;
+    size_t bytes = (type == 0xC0 || type == 0xD0) ? 1 : 2;
+    if (bytes > end - p)
+      return false;
+    // Note off, note on, key pressure; channel 10 is percussion
+    if ((type == 0x80 || type == 0x90 || type == 0xA0) &&
+        (running & 0x0F) != 9)
+      d[p] = shiftNote(d[p] & 0x7F, semitones);
+    p += bytes;
+  }
+  return true;
+}
+
+bool transpose_midi(const uint8_t *smf, size_t size, int semitones,
+                    std::vector<uint8_t> *out) {
+  // RMID wraps the SMF in a RIFF "data" chunk
+  size_t start = 0;
+  size_t limit = size;
+  if (size >= 20 && memcmp(smf, "RIFF", 4) == 0 &&
+      memcmp(smf + 8, "RMID", 4) == 0) {
+    size_t p = 12;
+    bool found = false;
+    while (p + 8 <= size) {
+      uint32_t len = readLE32(smf + p + 4);
+      if (memcmp(smf + p, "data", 4) == 0) {
+        start = p + 8;
+        if (len < size - start)
+          limit = start + len;
+        found = true;
+        break;
+      }
+      p += 8 + (size_t)len + (len & 1);
+    }
+    if (!found)
+      return false;
+  }
+  if (limit - start < 14 || memcmp(smf + start, "MThd", 4) != 0)
+    return false;
+
+  out->assign(smf, smf + size);
+  uint8_t *d = out->data();
+  size_t p = start + 8 + (size_t)readBE32(d + start + 4);
+  int tracks = 0;
+  while (p + 8 <= limit) {
+    uint32_t len = readBE32(d + p + 4);
+    size_t body = p + 8;
+    if (len > limit - body)
+      return false;
+    if (memcmp(d + p, "MTrk", 4) == 0) {
+      if (!transposeTrack(d, body, body + len, semitones))
+        return false;
+      tracks++;
+    }
+    p = body + len;
+  }
+  return tracks > 0;
+}
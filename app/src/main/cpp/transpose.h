@@ -0,0 +1,52 @@
+/*
+ * transpose.h
+ *
+ * Key change without time-stretch artefacts. Where a backend can be told to
+ * play in another key, the engine does that, at no DSP cost:
+ *
+ *  - libvgm: the chip clocks in the VGM header are scaled before the file is
+ *    loaded. Every tone generator derives its pitch from its clock, and the
+ *    song's timing comes from the wait commands, so only the key changes.
+ *    Chips that only play sample streams clocked by the file (PWM, uPD7759,
+ *    OKIM6258) are left alone, like DAC drums on the other chips.
+ *  - libopenmpt: the "play.pitch_factor" control.
+ *  - libADLMIDI: the note numbers of a Standard MIDI File are shifted before
+ *    it is opened. The percussion channel (10) keeps its notes, since those
+ *    pick drums, not pitches.
+ *
+ * Other backends, and MIDI data this can't parse, are pitched by the time
+ * stretch stage instead (see timestretch.h).
+ *
+ * Called from the JNI thread only, like the rest of the engine.
+ */
+
+#ifndef TRANSPOSE_H
+#define TRANSPOSE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define TRANSPOSE_MAX_SEMITONES 12
+
+// Frequency ratio of a shift by `semitones`.
+double transpose_ratio(int semitones);
+
+// Bytes of a VGM file that hold its header (the most that
+// transpose_vgm_clocks reads from `header`).
+#define TRANSPOSE_VGM_HEADER_SIZE 0x100
+
+// Set the chip clocks of the VGM file in `data` to those of `header` (a copy
+// of the untouched file's first bytes) shifted by `semitones`. Returns false
+// if `data` is not a VGM file.
+bool transpose_vgm_clocks(uint8_t *data, size_t size, const uint8_t *header,
+                          size_t headerSize, int semitones);
+
+// Copy the MIDI file `smf` (plain or RIFF RMID) to `out` with every note
+// outside the percussion channel shifted by `semitones`; notes that would
+// leave the MIDI range move by whole octaves less. Returns false, leaving
+// `out` undefined, if the data isn't a well-formed Standard MIDI File.
+bool transpose_midi(const uint8_t *smf, size_t size, int semitones,
+                    std::vector<uint8_t> *out);
+
+#endif // TRANSPOSE_H
@@ -8,7 +8,9 @@
  */
 
 #include <algorithm>
+#include <android/asset_manager_jni.h>
 #include <android/log.h>
+#include <chrono>
 #include <cmath>
 #include <complex>
 #include <cstdio>
@@ -24,7 +26,6 @@
 #include "libvgm/player/playerbase.hpp"
 #include "libvgm/player/vgmplayer.hpp"
 #include "libvgm/utils/DataLoader.h"
-#include "libvgm/utils/FileLoader.h"
 
 // libgme for NSF and other formats
 #include "gme.h"
@@ -45,6 +46,22 @@
 #include "memio.h"
 #include "mus2mid.h"
 
+#include "channel_meters.h"
+#include "engine_status.h"
+#include "equalizer.h"
+#include "limiter.h"
+#include "loudness.h"
+#include "mapped_file.h"
+#include "output_meter.h"
+#include "prefetch.h"
+#include "timestretch.h"
+#include "transpose.h"
+#include "resampler.h"
+#include "reverb.h"
+#include "rom_cache.h"
+#include "vgz_cache.h"
+#include "loop_cache.h"
+
 #define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, "VgmJNI", __VA_ARGS__)
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, "VgmJNI", __VA_ARGS__)
 
@@ -69,15 +86,14 @@ static KSSPLAY *gKssPlay = nullptr;
 static ADL_MIDIPlayer *gAdlPlayer = nullptr;
 static musdoom_emulator_t *gMusDoomPlayer = nullptr;
 static PSFINFO *gPsfInfo = nullptr;
-static std::vector<uint8_t>
-    gMusDoomData; // MUS data must remain valid during playback
 static std::vector<uint8_t>
     gMusDoomMidiData; // Converted MIDI data for MUS playback
 static DATA_LOADER *gLoader = nullptr;
 static char *gTitleBuf = nullptr;
 static char *gChipBuf = nullptr;
 static UINT32 gSampleRate = 44100;
-static std::string gRomPath = "";
+// The APK's AssetManager; the native manager lives as long as this reference
+static jobject gAssetManager = nullptr;
 
 // PSF playback state - asynchronous generation and streaming with improved
 // thread safety
@@ -99,6 +115,12 @@ static std::atomic<int> gPsfCurrentGeneration{0};
 static std::atomic<bool> gPsfGenerationComplete{false};
 static std::thread gPsfGenerationThread; // thread handle for PSF generation
 
+// sexypsf always generates 44.1 kHz; other output rates go through
+// gPsfResampler (JNI thread only, like the playback position it follows)
+#define PSF_SAMPLE_RATE 44100
+static Resampler gPsfResampler;
+static bool gPsfResamplerInit = false;
+
 // Current track index for libgme (NSF can have multiple tracks)
 static int gGmeTrackIndex = 0;
 static int gGmeTrackCount = 0;
@@ -107,6 +129,8 @@ static std::vector<bool> gGmeMutedChannels;
 // Current track index for libkss (KSS can have multiple tracks)
 static int gKssTrackIndex = 0;
 static int gKssTrackCount = 0;
+// libkss has no position getter, so count rendered frames ourselves
+static int64_t gKssRenderedFrames = 0;
 
 // Endless loop mode - disable track end detection for seamless SPC looping
 static bool gEndlessLoopMode = false;
@@ -116,14 +140,99 @@ static bool gEndlessLoopMode = false;
 static float gFftRingBuffer[FFT_SIZE];
 static int gFftWriteIdx = 0;
 
-// Bass and Reverb State
+// The visualizer spectra, recomputed at most every SPECTRUM_INTERVAL_S rather
+// than after every buffer, and outside the seqlock write window: publishing
+// only copies them into the status block.
+#define SPECTRUM_INTERVAL_S (1.0 / 30)
+static float gSpectrum[STATUS_SPECTRUM_BINS];
+static float gChannelSpectrum[STATUS_MAX_CHANNEL_SPECTRUM];
+static int gChannelSpectrumLen = 0;
+static double gSpectrumTime = -1.0; // < 0: recompute at the next publish
+
+// Bass preset state (the reverb keeps its own, see reverb.h)
 static bool gBassEnabled = false;
-static bool gReverbEnabled = false;
 
-// Simple reverb state
-#define REVERB_DELAY_SAMPLES 4410                     // ~100ms at 44100Hz
-static float gReverbBuffer[REVERB_DELAY_SAMPLES * 2]; // stereo
-static int gReverbWritePos = 0;
+// libvgm sums several chips into 32-bit samples with 8 fraction bits. It
+// goes onto the int16 bus one bit lower, so up to +6 dBFS survives to the
+// limiter; the effects stage applies the makeup gain.
+#define LIBVGM_BUS_SHIFT 9
+
+// Gain that brings the active decoder's bus samples back to full scale.
+static inline float busMakeup() {
+  return gPlayerType == PlayerType::LIBVGM ? 2.0f : 1.0f;
+}
+
+// Loudness normalisation of the active track (from the offline analysis,
+// set after open). Applied with the makeup gain in the effects stage.
+static float gTrackGain = 1.0f;
+
+// Key change in semitones, kept across tracks like the playback speed.
+// gTrackTranspose is the part the active decoder applies itself (see
+// transpose.h); the time stretch stage pitches the rest.
+static int gTranspose = 0;
+static int gTrackTranspose = 0;
+// Tape-style slowdown: the pitch drops with the speed
+static bool gVarispeed = false;
+// Filter length of every resampler (see resampler.h)
+static ResamplerQuality gResamplerQuality = RESAMPLER_MEDIUM;
+// Untouched input a decoder is re-keyed from: the first bytes of a VGM file
+// (its loaded copy has rewritten clocks) and MIDI files
+static std::vector<uint8_t> gVgmHeader;
+static MappedFile gMidiFile;
+
+// Bus sample to full-scale output of the active decoder.
+static inline float outputGain() { return busMakeup() * gTrackGain; }
+
+// Status block counters (published by publishStatus)
+static uint32_t gStatusUnderruns = 0;
+static uint32_t gStatusFillCount = 0;
+
+// Engine event state: each of these is reported once per track/seek
+static bool gEndEventSent = false;
+static bool gPsfReadySent = false;
+static int64_t gVgmEndSample = -1; // set by the libvgm END callback
+
+// Loop-count driven ending. planTrackEnd() turns the backend's loop points
+// into a fade window in output samples; nFillBuffer applies the fade per
+// sample and stops output exactly at gFadeEndSample.
+static int gLoopCount = 2;
+static int gFadeMs = 2000;
+static int64_t gOutputSample = 0; // frames output since open/seek/track
+static int64_t gFadeStartSample = -1;
+static int64_t gFadeEndSample = -1;
+static int gKssLastLoopCount = 0;
+// Loop points of backends that don't report passing them (gme, openmpt,
+// ADLMIDI), in output samples: the first pass ends at gLoopPassEnd and every
+// gLoopPassLength after it; -1 without loop information
+static int64_t gLoopPassEnd = -1;
+static int64_t gLoopPassLength = -1;
+static bool gStreamExhausted = false; // backend returned a short buffer
+// Frames of the limiter's delay line still to play out after the track
+// ended by itself; -1 until it ends
+static int gLimiterTail = -1;
+
+// Endless mode: the current buffer came from the loop cache, so per-chip
+// taps (KSS ch_wave) are stale and must not feed the meters
+static bool gServingLoopCache = false;
+
+// Audio rendered while this track was parked as the next one (see
+// DecoderSlot); played before the backend resumes
+static std::vector<jshort> gPreroll;
+static size_t gPrerollPos = 0; // frames of gPreroll already played
+// The globals hold the parked next track, not the playing one: nOpen called
+// by nPrepareNext, or discardNextDecoder freeing it. The output state (FFT
+// ring, meters, status block) is left to the playing track.
+static bool gOpeningNext = false;
+
+// Crossfade into the prepared next track (0 = plain gapless handover). The
+// window is the last gCrossfadeMs before the current track's planned end;
+// gXfadeStart/gXfadeEnd are set when the next track is armed, which the
+// service does a whole window before it opens: the incoming side is
+// pre-rendered in real time until then.
+#define CROSSFADE_MAX_MS 10000 // SettingsManager.MAX_CROSSFADE_SECONDS
+static int gCrossfadeMs = 0;
+static int64_t gXfadeStart = -1;
+static int64_t gXfadeEnd = -1;
 
 typedef std::complex<float> Complex;
 static void fft_process(std::vector<Complex> &a) {
@@ -166,7 +275,7 @@ void sexyd_update(unsigned char *pSound, long lBytes) {
   // This means insert() will NEVER reallocate, keeping the raw buffer pointer
   // stable so fillBuffer can read without the lock.
   if (gPsfAudioCachePtr->capacity() == 0)
-    gPsfAudioCachePtr->reserve(44100 * 4 * 1200); // ~20 min
+    gPsfAudioCachePtr->reserve(PSF_SAMPLE_RATE * 4 * 1200); // ~20 min
 
   gPsfAudioCachePtr->insert(gPsfAudioCachePtr->end(), pSound, pSound + lBytes);
 
@@ -175,33 +284,31 @@ void sexyd_update(unsigned char *pSound, long lBytes) {
   gPsfCommittedBytes.store(gPsfAudioCachePtr->size(),
                            std::memory_order_release);
 
-  if (!gPsfCacheReady.load() && gPsfAudioCachePtr->size() >= 44100 * 4 * 6) {
+  if (!gPsfCacheReady.load() &&
+      gPsfAudioCachePtr->size() >= PSF_SAMPLE_RATE * 4 * 6) {
     gPsfCacheReady.store(true, std::memory_order_release);
     LOGD("PSF cache ready with %zu bytes", gPsfAudioCachePtr->size());
   }
 }
 
+// Start PSF resampling afresh at the current output rate.
+static void resetPsfResampler() {
+  if (!gPsfResamplerInit) {
+    resampler_init(&gPsfResampler, gResamplerQuality);
+    gPsfResamplerInit = true;
+  }
+  resampler_set_ratio(&gPsfResampler, (double)PSF_SAMPLE_RATE / gSampleRate);
+  resampler_reset(&gPsfResampler);
+}
+
+// ROMs a VGM asks for come from the process-wide cache, see rom_cache.h
 static DATA_LOADER *RequestFileCallback(void *userParam, PlayerBase *player,
                                         const char *fileName) {
-  DATA_LOADER *dLoad = FileLoader_Init(fileName);
-  UINT8 retVal = DataLoader_Load(dLoad);
-  if (!retVal)
+  DATA_LOADER *dLoad = rom_cache_loader(fileName);
+  if (dLoad && !DataLoader_Load(dLoad))
     return dLoad;
-  DataLoader_Deinit(dLoad);
-
-  // If not found and we have a ROM path, try there
-  if (!gRomPath.empty()) {
-    std::string fullPath = gRomPath;
-    if (fullPath.back() != '/')
-      fullPath += "/";
-    fullPath += fileName;
-    dLoad = FileLoader_Init(fullPath.c_str());
-    retVal = DataLoader_Load(dLoad);
-    if (!retVal)
-      return dLoad;
+  if (dLoad)
     DataLoader_Deinit(dLoad);
-  }
-
   return nullptr;
 }
 
@@ -260,6 +367,44 @@ static bool isKssFormat(const char *path) {
           strcmp(lowerExt, "mpk") == 0 || strcmp(lowerExt, "mbm") == 0);
 }
 
+// Parse the KSS-family file at `path`. KSS_bin2kss copies what it keeps, so
+// the file is only mapped for the call.
+static KSS *loadKss(const char *path) {
+  MappedFile file;
+  if (!mapped_file_open(&file, path, MAPPED_FILE_SEQUENTIAL))
+    return nullptr;
+  // KSS_bin2kss uses the file name for MBM detection
+  const char *filename = strrchr(path, '/');
+  filename = filename ? filename + 1 : path;
+  KSS *kss = KSS_bin2kss(file.data, (uint32_t)file.size, filename);
+  mapped_file_close(&file);
+  return kss;
+}
+
+// gme_open_file through the mapped file layer, so assets play too. The type
+// comes from the header, else the extension, as in gme_open_file; gme copies
+// the data.
+static gme_err_t openGme(const char *path, Music_Emu **out, int rate) {
+  *out = nullptr;
+  MappedFile file;
+  if (!mapped_file_open(&file, path, MAPPED_FILE_SEQUENTIAL))
+    return "Couldn't open file";
+  const char *ext = file.size >= 4 ? gme_identify_header(file.data) : "";
+  gme_type_t type = gme_identify_extension(*ext ? ext : path);
+  gme_err_t err = gme_wrong_file_type;
+  if (type) {
+    Music_Emu *emu = gme_new_emu(type, rate);
+    err = emu ? gme_load_data(emu, file.data, (long)file.size)
+              : "Out of memory";
+    if (err)
+      gme_delete(emu);
+    else
+      *out = emu;
+  }
+  mapped_file_close(&file);
+  return err;
+}
+
 // Check if file extension is a tracker format supported by libopenmpt
 static bool isOpenmptFormat(const char *path) {
   const char *ext = strrchr(path, '.');
@@ -395,19 +540,40 @@ static void cleanup() {
     musdoom_destroy(gMusDoomPlayer);
     gMusDoomPlayer = nullptr;
   }
-  gMusDoomData.clear();
-  gMusDoomData.shrink_to_fit();
   gMusDoomMidiData.clear();
   gMusDoomMidiData.shrink_to_fit();
+  mapped_file_close(&gMidiFile);
+  gVgmHeader.clear();
+  gTrackTranspose = 0;
 
   gPlayerType = PlayerType::NONE;
   gGmeTrackIndex = 0;
   gGmeTrackCount = 0;
   gKssTrackIndex = 0;
   gKssTrackCount = 0;
+  gKssRenderedFrames = 0;
+  gStatusUnderruns = 0;
+  gStatusFillCount = 0;
+  gEndEventSent = false;
+  gVgmEndSample = -1;
+  gOutputSample = 0;
+  gFadeStartSample = -1;
+  gFadeEndSample = -1;
+  gKssLastLoopCount = 0;
+  gLoopPassEnd = -1;
+  gLoopPassLength = -1;
+  gStreamExhausted = false;
+  gServingLoopCache = false;
+  loop_cache_reset();
+  gPreroll.clear();
+  gPreroll.shrink_to_fit();
+  gPrerollPos = 0;
+  gXfadeStart = -1;
+  gXfadeEnd = -1;
+  gTrackGain = 1.0f;
 
   if (gLoader) {
-    DataLoader_Deinit(gLoader);
+    mapped_file_loader_free(gLoader);
     gLoader = nullptr;
   }
   if (gTitleBuf) {
@@ -418,8 +584,662 @@ static void cleanup() {
     free(gChipBuf);
     gChipBuf = nullptr;
   }
-  std::memset(gFftRingBuffer, 0, sizeof(gFftRingBuffer));
-  gFftWriteIdx = 0;
+  // The visualisation and meters follow the playing track, not a parked one
+  if (!gOpeningNext) {
+    gPsfReadySent = false;
+    gLimiterTail = -1;
+    std::memset(gFftRingBuffer, 0, sizeof(gFftRingBuffer));
+    gFftWriteIdx = 0;
+    gSpectrumTime = -1.0;
+    channel_meters_clear();
+  }
+}
+
+// libvgm tracks get one meter per chip while this is set
+static bool gDeviceMeters = false;
+
+// Label one meter per chip of the libvgm track, fed by the level tap of
+// patches/libvgm-tap-device-levels.patch. False, with the tap off, if libvgm
+// was built without it.
+static bool configureDeviceMeters(std::vector<std::string> *labels) {
+#ifdef VGMP_DEVICE_LEVELS
+  std::vector<VGMPlayer::DEV_LEVEL> devs;
+  gVgmPlayer->GetDeviceLevels(devs, true);
+  for (size_t i = 0; i < devs.size() && i < METER_MAX_CHANNELS; i++) {
+    char buf[32];
+    if (devs[i].instance > 0)
+      snprintf(buf, sizeof(buf), "%s #%d", devs[i].name, devs[i].instance + 1);
+    else
+      snprintf(buf, sizeof(buf), "%s", devs[i].name);
+    labels->push_back(buf);
+  }
+  gVgmPlayer->SetDeviceLevelTap(!labels->empty());
+  return !labels->empty();
+#else
+  (void)labels;
+  return false;
+#endif
+}
+
+// Levels of each chip since the last call, in libvgm's bus units.
+static void updateDeviceMeters() {
+#ifdef VGMP_DEVICE_LEVELS
+  static std::vector<VGMPlayer::DEV_LEVEL> devs;
+  const double fullScale = 32768.0 * (1 << LIBVGM_BUS_SHIFT);
+  gVgmPlayer->GetDeviceLevels(devs, true);
+  for (size_t i = 0; i < devs.size(); i++)
+    channel_meters_accumulate_sums(
+        (int)i, (float)(devs[i].peak / fullScale),
+        devs[i].sumSq / (fullScale * fullScale), devs[i].smplCnt);
+#endif
+}
+
+// Set up meter channels for the active backend. Backends that measure their
+// channels' output get one meter per channel; the rest meter the stereo
+// master mix, labelled as such.
+static void configureChannelMeters() {
+  if (gOpeningNext)
+    return;
+  std::vector<std::string> labels;
+  char buf[32];
+  gDeviceMeters = false;
+
+  if (gPlayerType == PlayerType::LIBKSS && gKssPlay && gKss) {
+    // Same channel order as nGetChannelSpectrums / nGetChannelName
+    if (!gKssPlay->device_mute[KSS_DEVICE_PSG]) {
+      int count = gKss->sn76489 ? 4 : 3;
+      for (int i = 0; i < count; i++) {
+        snprintf(buf, sizeof(buf), "%s #%d", gKss->sn76489 ? "SNG" : "PSG",
+                 i + 1);
+        labels.push_back(buf);
+      }
+    }
+    if (!gKssPlay->device_mute[KSS_DEVICE_SCC]) {
+      for (int i = 0; i < 5; i++) {
+        snprintf(buf, sizeof(buf), "SCC #%d", i + 1);
+        labels.push_back(buf);
+      }
+    }
+    if (gKss->fmpac && !gKssPlay->device_mute[KSS_DEVICE_OPLL]) {
+      for (int i = 0; i < 15; i++) {
+        snprintf(buf, sizeof(buf), "OPLL #%d", i + 1);
+        labels.push_back(buf);
+      }
+    }
+    if (gKss->msx_audio && !gKssPlay->device_mute[KSS_DEVICE_OPL]) {
+      for (int i = 0; i < 15; i++) {
+        snprintf(buf, sizeof(buf), "OPL #%d", i + 1);
+        labels.push_back(buf);
+      }
+    }
+  } else if (gPlayerType == PlayerType::LIBOPENMPT && gOpenmptModule) {
+    int count = openmpt_module_get_num_channels(gOpenmptModule);
+    for (int i = 0; i < count && i < METER_MAX_CHANNELS; i++) {
+      snprintf(buf, sizeof(buf), "Ch %d", i + 1);
+      labels.push_back(buf);
+    }
+  } else if (gPlayerType == PlayerType::LIBVGM && gVgmPlayer &&
+             configureDeviceMeters(&labels)) {
+    gDeviceMeters = true;
+  } else if (gPlayerType != PlayerType::NONE) {
+    // gme voices and libADLMIDI's OPL channels are mixed inside the
+    // emulator core with no per-channel tap, so meter their stereo mix
+    // instead.
+    labels.push_back("Master L");
+    labels.push_back("Master R");
+  }
+
+  channel_meters_configure(labels);
+}
+
+// Feed the meters from the buffer that was just rendered, before effects.
+static void updateChannelMeters(const jshort *dst, jint written) {
+  if (written <= 0 || channel_meters_count() == 0)
+    return;
+
+  if (gPlayerType == PlayerType::LIBKSS && gKssPlay && gKss) {
+    if (gServingLoopCache)
+      return; // meters hold their last values while the chips are idle
+    auto &wave = gKssPlay->ch_wave;
+    int w_idx = wave.wave_idx;
+    int ch = 0;
+    if (!gKssPlay->device_mute[KSS_DEVICE_PSG]) {
+      if (gKss->sn76489) {
+        for (int i = 0; i < 4; i++)
+          channel_meters_accumulate_ring(ch++, wave.sng[i], 512, w_idx,
+                                         written);
+      } else {
+        for (int i = 0; i < 3; i++)
+          channel_meters_accumulate_ring(ch++, wave.psg[i], 512, w_idx,
+                                         written);
+      }
+    }
+    if (!gKssPlay->device_mute[KSS_DEVICE_SCC]) {
+      for (int i = 0; i < 5; i++)
+        channel_meters_accumulate_ring(ch++, wave.scc[i], 512, w_idx, written);
+    }
+    if (gKss->fmpac && !gKssPlay->device_mute[KSS_DEVICE_OPLL]) {
+      for (int i = 0; i < 15; i++)
+        channel_meters_accumulate_ring(ch++, wave.opll[i], 512, w_idx,
+                                       written);
+    }
+    if (gKss->msx_audio && !gKssPlay->device_mute[KSS_DEVICE_OPL]) {
+      for (int i = 0; i < 15; i++)
+        channel_meters_accumulate_ring(ch++, wave.opl[i], 512, w_idx, written);
+    }
+    return;
+  }
+
+  if (gPlayerType == PlayerType::LIBOPENMPT && gOpenmptModule) {
+    int count = channel_meters_count();
+    for (int ch = 0; ch < count; ch++) {
+      float l = openmpt_module_get_current_channel_vu_left(gOpenmptModule, ch);
+      float r =
+          openmpt_module_get_current_channel_vu_right(gOpenmptModule, ch);
+      // The VU is libopenmpt's own level of the channel's mixed output;
+      // it has no RMS, so both values are that level
+      float level = l > r ? l : r;
+      channel_meters_set_level(ch, level, level);
+    }
+    return;
+  }
+
+  if (gDeviceMeters && gPlayerType == PlayerType::LIBVGM && gVgmPlayer) {
+    if (!gServingLoopCache)
+      updateDeviceMeters();
+    return;
+  }
+
+  // Master L/R
+  channel_meters_accumulate(0, dst, written, 2);
+  channel_meters_accumulate(1, dst + 1, written, 2);
+}
+
+static void pushEngineEvent(int32_t type, int32_t arg, int64_t sample) {
+  EngineStatusBlock *blk = engine_status_block();
+  if (blk)
+    engine_status_push_event(blk, type, arg, sample);
+}
+
+// Forget a previously reported end of stream (seek or track change).
+static void resetEndState() {
+  gEndEventSent = false;
+  gVgmEndSample = -1;
+  gStreamExhausted = false;
+  gLimiterTail = -1;
+}
+
+// Track sample that is being rendered when the audio rendered at `sample` is
+// heard: the limiter delays everything by its lookahead, which is counted in
+// output frames, each worth `speed` track samples under the time stretch.
+static int64_t heardSample(int64_t sample) {
+  return sample + (int64_t)llround(limiter_latency() * timestretch_speed());
+}
+
+static int64_t msToSamples(int64_t ms) { return ms * gSampleRate / 1000; }
+
+// Everything that belongs to one open track. swapDecoder() exchanges it with
+// the live globals, so a second track can be opened, pre-rolled and parked
+// while the current one keeps playing, then made live without touching the
+// output stream. PSF is never parked: sexypsf is a single global emulator
+// with its own generation thread.
+struct DecoderSlot {
+  PlayerType playerType = PlayerType::NONE;
+  VGMPlayer *vgmPlayer = nullptr;
+  Music_Emu *gmePlayer = nullptr;
+  openmpt_module *openmptModule = nullptr;
+  KSS *kss = nullptr;
+  KSSPLAY *kssPlay = nullptr;
+  ADL_MIDIPlayer *adlPlayer = nullptr;
+  musdoom_emulator_t *musDoomPlayer = nullptr;
+  std::vector<uint8_t> musDoomMidiData;
+  MappedFile midiFile = {};
+  std::vector<uint8_t> vgmHeader;
+  DATA_LOADER *loader = nullptr;
+  char *titleBuf = nullptr;
+  char *chipBuf = nullptr;
+  int gmeTrackIndex = 0;
+  int gmeTrackCount = 0;
+  std::vector<bool> gmeMutedChannels;
+  int kssTrackIndex = 0;
+  int kssTrackCount = 0;
+  int64_t kssRenderedFrames = 0;
+  uint32_t statusUnderruns = 0;
+  uint32_t statusFillCount = 0;
+  bool endEventSent = false;
+  int64_t vgmEndSample = -1;
+  int64_t outputSample = 0;
+  int64_t fadeStartSample = -1;
+  int64_t fadeEndSample = -1;
+  int64_t loopPassEnd = -1;
+  int64_t loopPassLength = -1;
+  int kssLastLoopCount = 0;
+  bool streamExhausted = false;
+  std::vector<jshort> preroll;
+  size_t prerollPos = 0;
+  int64_t xfadeStart = -1;
+  int64_t xfadeEnd = -1;
+  float trackGain = 1.0f;
+  int trackTranspose = 0;
+};
+
+// Next track, opened and pre-rolled ahead of the current track's end
+static DecoderSlot gNextSlot;
+static bool gNextArmed = false;
+#define NEXT_PREROLL_FRAMES 4096
+
+static void swapDecoder(DecoderSlot &s) {
+  std::swap(gPlayerType, s.playerType);
+  std::swap(gVgmPlayer, s.vgmPlayer);
+  std::swap(gGmePlayer, s.gmePlayer);
+  std::swap(gOpenmptModule, s.openmptModule);
+  std::swap(gKss, s.kss);
+  std::swap(gKssPlay, s.kssPlay);
+  std::swap(gAdlPlayer, s.adlPlayer);
+  std::swap(gMusDoomPlayer, s.musDoomPlayer);
+  gMusDoomMidiData.swap(s.musDoomMidiData);
+  std::swap(gMidiFile, s.midiFile);
+  gVgmHeader.swap(s.vgmHeader);
+  std::swap(gLoader, s.loader);
+  std::swap(gTitleBuf, s.titleBuf);
+  std::swap(gChipBuf, s.chipBuf);
+  std::swap(gGmeTrackIndex, s.gmeTrackIndex);
+  std::swap(gGmeTrackCount, s.gmeTrackCount);
+  gGmeMutedChannels.swap(s.gmeMutedChannels);
+  std::swap(gKssTrackIndex, s.kssTrackIndex);
+  std::swap(gKssTrackCount, s.kssTrackCount);
+  std::swap(gKssRenderedFrames, s.kssRenderedFrames);
+  std::swap(gStatusUnderruns, s.statusUnderruns);
+  std::swap(gStatusFillCount, s.statusFillCount);
+  std::swap(gEndEventSent, s.endEventSent);
+  std::swap(gVgmEndSample, s.vgmEndSample);
+  std::swap(gOutputSample, s.outputSample);
+  std::swap(gFadeStartSample, s.fadeStartSample);
+  std::swap(gFadeEndSample, s.fadeEndSample);
+  std::swap(gLoopPassEnd, s.loopPassEnd);
+  std::swap(gLoopPassLength, s.loopPassLength);
+  std::swap(gKssLastLoopCount, s.kssLastLoopCount);
+  std::swap(gStreamExhausted, s.streamExhausted);
+  gPreroll.swap(s.preroll);
+  std::swap(gPrerollPos, s.prerollPos);
+  std::swap(gXfadeStart, s.xfadeStart);
+  std::swap(gXfadeEnd, s.xfadeEnd);
+  std::swap(gTrackGain, s.trackGain);
+  std::swap(gTrackTranspose, s.trackTranspose);
+}
+
+// Crossfade transition bookkeeping, reset whenever a next track is armed
+static float gXfadeLoad = 0.0f; // smoothed render time / buffer duration
+static int gXfadeLoadFills = 0;
+static bool gXfadeOverloadSent = false;
+#define XFADE_MAX_LOAD 0.85f
+#define XFADE_MIN_FILLS 8
+
+// Place the crossfade window at the end of the current track's planned
+// ending. Tracks that only end on their own (no planned end) are handed over
+// gaplessly instead.
+static void planCrossfade() {
+  gXfadeStart = -1;
+  gXfadeEnd = -1;
+  gXfadeLoad = 0.0f;
+  gXfadeLoadFills = 0;
+  gXfadeOverloadSent = false;
+  if (!gNextArmed || gCrossfadeMs <= 0 || gFadeEndSample <= gOutputSample)
+    return;
+  int64_t window = std::min<int64_t>(msToSamples(gCrossfadeMs),
+                                     gFadeEndSample - gOutputSample);
+  gXfadeEnd = gFadeEndSample;
+  gXfadeStart = gFadeEndSample - window;
+}
+
+// Free a parked next track (new track opened, manual skip, endless mode).
+static void discardNextDecoder() {
+  if (!gNextArmed)
+    return;
+  DecoderSlot current;
+  swapDecoder(current);
+  swapDecoder(gNextSlot);
+  gOpeningNext = true;
+  cleanup();
+  gOpeningNext = false;
+  swapDecoder(current);
+  gNextArmed = false;
+  gXfadeStart = -1; // nothing to fade into any more
+  gXfadeEnd = -1;
+}
+
+// The current track has ended: free it and make the parked one live. Its
+// pre-rolled audio plays first (what is left of it after a crossfade), so
+// output continues at the next sample.
+static void spliceNextDecoder() {
+  cleanup();
+  swapDecoder(gNextSlot);
+  gNextArmed = false;
+  configureChannelMeters();
+  pushEngineEvent(ENGINE_EVENT_TRACK_CHANGED, 0, gOutputSample);
+  LOGD("gapless handover to the prepared track, playerType=%d",
+       (int)gPlayerType);
+}
+
+// Endless mode: start capturing the loop body so later passes can be served
+// from memory (see loop_cache.h). Does nothing once a capture for the current
+// track is under way or settled; cleanup()/nSetTrack reset it.
+static void planLoopCache() {
+  if (!gEndlessLoopMode || loop_cache_capturing() || loop_cache_ready() ||
+      loop_cache_failed())
+    return;
+
+  if (gPlayerType == PlayerType::LIBVGM && gVgmPlayer) {
+    // Sample-exact loop points; only allow for tick/sample rounding
+    UINT32 loopTicks = gVgmPlayer->GetLoopTicks();
+    if (loopTicks > 0) {
+      UINT32 total = gVgmPlayer->GetTotalTicks();
+      loop_cache_begin(gVgmPlayer->Tick2Sample(total - loopTicks),
+                       gVgmPlayer->Tick2Sample(loopTicks), 16, gSampleRate);
+    }
+  } else if (gPlayerType == PlayerType::LIBGME && gGmePlayer) {
+    // Loop points are in ms, search a few ms either side for the seam
+    gme_info_t *info;
+    if (gme_track_info(gGmePlayer, &info, gGmeTrackIndex) == 0) {
+      if (info->loop_length > 0)
+        loop_cache_begin(msToSamples(info->intro_length > 0
+                                         ? info->intro_length
+                                         : 0),
+                         msToSamples(info->loop_length), msToSamples(4),
+                         gSampleRate);
+      gme_free_info(info);
+    }
+  } else if (gPlayerType == PlayerType::LIBADLMIDI && gAdlPlayer) {
+    double loopStart = adl_loopStartTime(gAdlPlayer);
+    double loopEnd = adl_loopEndTime(gAdlPlayer);
+    if (loopStart >= 0 && loopEnd > loopStart)
+      loop_cache_begin((int64_t)(loopStart * gSampleRate),
+                       (int64_t)((loopEnd - loopStart) * gSampleRate),
+                       msToSamples(4), gSampleRate);
+  }
+  // KSS: started from nFillBuffer when libkss reports the first loops.
+  // openmpt/MUS/PSF: cheap enough (or already cached) to keep rendering.
+}
+
+// Where the current track passes its loop point, for the backends that
+// don't report it themselves (gme, openmpt, ADLMIDI; see reportLoopPasses).
+static void planLoopPasses() {
+  gLoopPassEnd = -1;
+  gLoopPassLength = -1;
+  int64_t intro = 0;
+  int64_t length = 0;
+  if (gPlayerType == PlayerType::LIBGME && gGmePlayer) {
+    gme_info_t *info;
+    if (gme_track_info(gGmePlayer, &info, gGmeTrackIndex) == 0) {
+      if (info->loop_length > 0) {
+        intro = msToSamples(info->intro_length > 0 ? info->intro_length : 0);
+        length = msToSamples(info->loop_length);
+      }
+      gme_free_info(info);
+    }
+  } else if (gPlayerType == PlayerType::LIBOPENMPT && gOpenmptModule) {
+    // Modules repeat as a whole
+    double seconds = openmpt_module_get_duration_seconds(gOpenmptModule);
+    if (seconds > 0)
+      length = (int64_t)(seconds * gSampleRate);
+  } else if (gPlayerType == PlayerType::LIBADLMIDI && gAdlPlayer) {
+    double loopStart = adl_loopStartTime(gAdlPlayer);
+    double loopEnd = adl_loopEndTime(gAdlPlayer);
+    if (loopStart >= 0 && loopEnd > loopStart) {
+      intro = (int64_t)(loopStart * gSampleRate);
+      length = (int64_t)((loopEnd - loopStart) * gSampleRate);
+    } else if (gEndlessLoopMode) {
+      // No markers: endless mode loops the whole song
+      length = (int64_t)(adl_totalTimeLength(gAdlPlayer) * gSampleRate);
+    }
+  }
+  if (length > 0) {
+    gLoopPassEnd = intro + length;
+    gLoopPassLength = length;
+  }
+}
+
+// Loop points of planLoopPasses() before output sample `pos`
+static int64_t loopPassesBefore(int64_t pos) {
+  if (pos <= gLoopPassEnd)
+    return 0;
+  return (pos - gLoopPassEnd - 1) / gLoopPassLength + 1;
+}
+
+// Push LOOP for the loop points of planLoopPasses() within the `frames`
+// frames rendered from output sample `start` on.
+static void reportLoopPasses(int64_t start, jint frames) {
+  if (gLoopPassLength <= 0 || start + frames <= gLoopPassEnd)
+    return;
+  int64_t last = loopPassesBefore(start + frames);
+  for (int64_t k = loopPassesBefore(start) + 1; k <= last; k++)
+    pushEngineEvent(ENGINE_EVENT_LOOP, (int32_t)k,
+                    heardSample(gLoopPassEnd + (k - 1) * gLoopPassLength));
+}
+
+// Work out where the current track should start fading, from the backend's
+// real loop information and gLoopCount. Tracks without loop information end
+// naturally (END from the backend) and get no fade window.
+static void planTrackEnd() {
+  gFadeStartSample = -1;
+  gFadeEndSample = -1;
+  planLoopPasses();
+  if (gPlayerType == PlayerType::NONE)
+    return;
+  if (gEndlessLoopMode) {
+    // Backends that stop after a set number of repeats repeat forever;
+    // MIDI without loop markers loops the whole song
+    if (gPlayerType == PlayerType::LIBOPENMPT && gOpenmptModule)
+      openmpt_module_set_repeat_count(gOpenmptModule, -1);
+    else if (gPlayerType == PlayerType::LIBADLMIDI && gAdlPlayer)
+      adl_setLoopEnabled(gAdlPlayer, 1);
+    planLoopCache();
+    return;
+  }
+
+  int loops = gLoopCount < 1 ? 1 : gLoopCount;
+  int64_t contentEnd = -1;
+
+  if (gPlayerType == PlayerType::LIBVGM && gVgmPlayer) {
+    // Total ticks cover intro + one pass of the loop
+    UINT32 loopTicks = gVgmPlayer->GetLoopTicks();
+    if (loopTicks > 0) {
+      contentEnd = (int64_t)gVgmPlayer->Tick2Sample(gVgmPlayer->GetTotalTicks()) +
+                   (int64_t)(loops - 1) * gVgmPlayer->Tick2Sample(loopTicks);
+    }
+  } else if (gPlayerType == PlayerType::LIBGME && gGmePlayer) {
+    gme_info_t *info;
+    if (gme_track_info(gGmePlayer, &info, gGmeTrackIndex) == 0) {
+      if (info->loop_length > 0)
+        contentEnd = msToSamples((int64_t)(info->intro_length > 0
+                                               ? info->intro_length
+                                               : 0) +
+                                 (int64_t)loops * info->loop_length);
+      else if (info->length > 0)
+        contentEnd = msToSamples(info->length);
+      else
+        contentEnd = msToSamples(info->play_length);
+      gme_free_info(info);
+    }
+    if (contentEnd >= 0) {
+      // Our fade replaces gme's own; silence detection still ends early
+      gme_set_fade_msecs(gGmePlayer, -1, 0);
+      gme_set_autoload_playback_limit(gGmePlayer, 0);
+    }
+  } else if (gPlayerType == PlayerType::LIBKSS && gKss) {
+    if (gKss->info && gKss->info_num > 0) {
+      for (uint16_t i = 0; i < gKss->info_num; i++) {
+        if (gKss->info[i].song == gKssTrackIndex &&
+            gKss->info[i].time_in_ms > 0) {
+          contentEnd = msToSamples(gKss->info[i].time_in_ms);
+          break;
+        }
+      }
+    }
+    // Otherwise nFillBuffer starts the fade once libkss reports `loops` loops
+  } else if (gPlayerType == PlayerType::LIBOPENMPT && gOpenmptModule) {
+    // Modules repeat as a whole: play `loops` times, fade over one more repeat
+    double seconds = openmpt_module_get_duration_seconds(gOpenmptModule);
+    openmpt_module_set_repeat_count(gOpenmptModule, loops);
+    if (seconds > 0)
+      contentEnd = (int64_t)(seconds * gSampleRate) * loops;
+  } else if (gPlayerType == PlayerType::LIBADLMIDI && gAdlPlayer) {
+    double loopStart = adl_loopStartTime(gAdlPlayer);
+    double loopEnd = adl_loopEndTime(gAdlPlayer);
+    bool hasLoop = loopStart >= 0 && loopEnd > loopStart;
+    adl_setLoopEnabled(gAdlPlayer, hasLoop ? 1 : 0);
+    if (hasLoop)
+      contentEnd = (int64_t)((loopEnd + (loops - 1) * (loopEnd - loopStart)) *
+                             gSampleRate);
+  } else if (gPlayerType == PlayerType::LIBMUSDOOM && gMusDoomPlayer) {
+    // MUS has no loop markers; the player repeats the song, so fade past one
+    // pass
+    uint32_t lengthMs = musdoom_get_length_ms(gMusDoomPlayer);
+    if (lengthMs > 0)
+      contentEnd = msToSamples(lengthMs);
+  }
+  // PSF: sexypsf renders length + fade itself, nothing to plan
+
+  if (contentEnd > 0) {
+    gFadeStartSample = contentEnd;
+    gFadeEndSample = contentEnd + msToSamples(gFadeMs);
+  }
+}
+
+// Frames of the `frames` from output sample `start` on that play before the
+// loop-count / manual fade ends.
+static jint trackFadeLength(jint frames, int64_t start) {
+  if (gFadeEndSample < 0)
+    return frames;
+  int64_t keep = gFadeEndSample - start;
+  return keep < frames ? (jint)(keep > 0 ? keep : 0) : frames;
+}
+
+// Gain of that fade at output sample `pos`. A crossfade shapes the ending
+// itself, so then only the end of its window counts.
+static float trackFadeGain(int64_t pos) {
+  if (gFadeEndSample < 0 || gXfadeStart >= 0 || pos < gFadeStartSample)
+    return 1.0f;
+  float span = (float)(gFadeEndSample - gFadeStartSample);
+  return span > 0 ? (float)(gFadeEndSample - pos) / span : 0.0f;
+}
+
+// Apply the planned fade to `frames` frames that start at output sample
+// `start`. Returns the number of frames to keep (output stops at the end of
+// the fade window).
+static jint applyTrackFade(jshort *dst, jint frames, int64_t start) {
+  if (gFadeEndSample < 0 || start + frames <= gFadeStartSample)
+    return frames;
+  frames = trackFadeLength(frames, start);
+  for (jint i = 0; i < frames; i++) {
+    float gain = trackFadeGain(start + i);
+    dst[i * 2] = (jshort)(dst[i * 2] * gain);
+    dst[i * 2 + 1] = (jshort)(dst[i * 2 + 1] * gain);
+  }
+  return frames;
+}
+
+static jint applyTrackFade(float *dst, jint frames, int64_t start) {
+  if (gFadeEndSample < 0 || start + frames <= gFadeStartSample)
+    return frames;
+  frames = trackFadeLength(frames, start);
+  for (jint i = 0; i < frames; i++) {
+    float gain = trackFadeGain(start + i);
+    dst[i * 2] *= gain;
+    dst[i * 2 + 1] *= gain;
+  }
+  return frames;
+}
+
+// libvgm playback events, raised from inside Render()
+static UINT8 vgmEventCallback(PlayerBase *player, void *userParam,
+                              UINT8 evtType, void *evtParam) {
+  if (evtType == PLREVT_LOOP) {
+    UINT32 loops = evtParam ? *(UINT32 *)evtParam : player->GetCurLoop();
+    pushEngineEvent(ENGINE_EVENT_LOOP, (int32_t)loops,
+                    heardSample(player->GetCurPos(PLAYPOS_SAMPLE)));
+  } else if (evtType == PLREVT_END) {
+    gVgmEndSample = player->GetCurPos(PLAYPOS_SAMPLE);
+  }
+  return 0x00;
+}
+
+// Set the clocks of the loaded VGM file for gTranspose, from gVgmHeader.
+// libvgm reads them on LoadFile.
+static void transposeVgmData() {
+  gTrackTranspose = 0;
+  if (transpose_vgm_clocks(DataLoader_GetData(gLoader),
+                           DataLoader_GetSize(gLoader), gVgmHeader.data(),
+                           gVgmHeader.size(), gTranspose))
+    gTrackTranspose = gTranspose;
+}
+
+// Open the MIDI file `smf` in gAdlPlayer with its notes shifted by
+// gTranspose. Returns adl_openData's result.
+static int openAdlTransposed(const uint8_t *smf, size_t size) {
+  gTrackTranspose = 0;
+  if (gTranspose != 0) {
+    std::vector<uint8_t> shifted;
+    if (transpose_midi(smf, size, gTranspose, &shifted)) {
+      gTrackTranspose = gTranspose;
+      return adl_openData(gAdlPlayer, shifted.data(),
+                          (unsigned long)shifted.size());
+    }
+    LOGD("MIDI data can't be transposed, pitching the output instead");
+  }
+  return adl_openData(gAdlPlayer, smf, (unsigned long)size);
+}
+
+// Convert the Doom MUS file at `path` (mapped, so assets and pack entries
+// work) to a Standard MIDI File in `midi`.
+static bool musToMidi(const char *path, std::vector<uint8_t> *midi) {
+  MappedFile file;
+  if (!mapped_file_open(&file, path, MAPPED_FILE_SEQUENTIAL)) {
+    LOGE("Failed to open MUS file: %s", path);
+    return false;
+  }
+  MEMFILE *musIn = mem_fopen_read(file.data, file.size);
+  MEMFILE *midiOut = mem_fopen_write();
+  bool convertError = mus2mid(musIn, midiOut);
+
+  void *midiBuf = nullptr;
+  size_t midiSize = 0;
+  if (!convertError)
+    mem_get_buf(midiOut, &midiBuf, &midiSize);
+  midi->clear();
+  if (midiBuf && midiSize > 0)
+    midi->assign(static_cast<uint8_t *>(midiBuf),
+                 static_cast<uint8_t *>(midiBuf) + midiSize);
+  mem_fclose(musIn);
+  mem_fclose(midiOut);
+  mapped_file_close(&file);
+  return !convertError && !midi->empty();
+}
+
+// Open the MIDI or MUS file at `path` in `adl` as it is, through a mapping
+// like every other backend. Returns adl_openData's result, -1 if the file
+// can't be read.
+static int openAdlPath(ADL_MIDIPlayer *adl, const char *path) {
+  if (isMusFormat(path)) {
+    std::vector<uint8_t> midi;
+    if (!musToMidi(path, &midi))
+      return -1;
+    return adl_openData(adl, midi.data(), (unsigned long)midi.size());
+  }
+  MappedFile file;
+  if (!mapped_file_open(&file, path, MAPPED_FILE_SEQUENTIAL))
+    return -1;
+  int result = adl_openData(adl, file.data, (unsigned long)file.size);
+  mapped_file_close(&file);
+  return result;
+}
+
+static void transposeOpenmpt() {
+  gTrackTranspose =
+      openmpt_module_ctl_set_floatingpoint(gOpenmptModule, "play.pitch_factor",
+                                           transpose_ratio(gTranspose))
+          ? gTranspose
+          : 0;
 }
 
 #include "libvgm/utils/StrUtils.h"
@@ -445,24 +1265,83 @@ extern "C" {
 
 // org.vlessert.vgmp.engine.VgmEngine native methods
 
+// Defined after the spectrum helpers; refreshes the shared status block.
+static void publishStatus();
+// Defined with nSeek; moves the active backend to an output sample.
+static void seekBackend(int64_t samplePos);
+
 JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSetSampleRate(
     JNIEnv *env, jclass cls, jint rate) {
   gSampleRate = (UINT32)rate;
   if (gVgmPlayer)
     gVgmPlayer->SetSampleRate(gSampleRate);
+  eq_set_sample_rate(rate);
+  reverb_set_sample_rate(rate);
+  limiter_set_sample_rate(rate);
+  output_meter_set_sample_rate(rate);
+  timestretch_set_sample_rate(rate);
+  if (gPsfResamplerInit)
+    resampler_set_ratio(&gPsfResampler, (double)PSF_SAMPLE_RATE / gSampleRate);
 }
 
 JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSetRomPath(
     JNIEnv *env, jclass cls, jstring jpath) {
   const char *path = env->GetStringUTFChars(jpath, nullptr);
-  gRomPath = path;
+  rom_cache_set_dir(path);
+  LOGD("nSetRomPath: %s", path);
   env->ReleaseStringUTFChars(jpath, path);
-  LOGD("nSetRomPath: %s", gRomPath.c_str());
+}
+
+JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSetAssetManager(
+    JNIEnv *env, jclass cls, jobject assets) {
+  if (gAssetManager)
+    return;
+  gAssetManager = env->NewGlobalRef(assets);
+  mapped_file_set_asset_manager(AAssetManager_fromJava(env, gAssetManager));
+}
+
+JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSetScratchDir(
+    JNIEnv *env, jclass cls, jstring jdir) {
+  const char *dir = env->GetStringUTFChars(jdir, nullptr);
+  mapped_file_set_scratch_dir(dir);
+  env->ReleaseStringUTFChars(jdir, dir);
+}
+
+JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSetVgzCache(
+    JNIEnv *env, jclass cls, jstring jdir, jlong maxBytes) {
+  const char *dir = env->GetStringUTFChars(jdir, nullptr);
+  vgz_cache_set_dir(dir, maxBytes > 0 ? (uint64_t)maxBytes : 0);
+  env->ReleaseStringUTFChars(jdir, dir);
+}
+
+JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nPrefetch(
+    JNIEnv *env, jclass cls, jobjectArray jpaths) {
+  std::vector<std::string> paths;
+  jsize count = jpaths ? env->GetArrayLength(jpaths) : 0;
+  for (jsize i = 0; i < count; i++) {
+    jstring jpath = (jstring)env->GetObjectArrayElement(jpaths, i);
+    if (!jpath)
+      continue;
+    const char *path = env->GetStringUTFChars(jpath, nullptr);
+    paths.push_back(path);
+    env->ReleaseStringUTFChars(jpath, path);
+    env->DeleteLocalRef(jpath);
+  }
+  prefetch_files(paths);
 }
 
 JNIEXPORT jboolean JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nOpen(
     JNIEnv *env, jclass cls, jstring jpath) {
+  discardNextDecoder();
   cleanup();
+  // Stretched audio and effect tails of the previous track; a prepared next
+  // track continues the stream instead
+  if (!gOpeningNext) {
+    timestretch_reset();
+    eq_reset();
+    reverb_reset();
+    limiter_reset();
+  }
 
   const char *path = env->GetStringUTFChars(jpath, nullptr);
   LOGD("nOpen: %s", path);
@@ -471,11 +1350,11 @@ JNIEXPORT jboolean JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nOpen(
   if (isGmeFormat(path)) {
     LOGD("Detected libgme format: %s", path);
 
-    gme_err_t err = gme_open_file(path, &gGmePlayer, gSampleRate);
+    gme_err_t err = openGme(path, &gGmePlayer, gSampleRate);
     env->ReleaseStringUTFChars(jpath, path);
 
     if (err) {
-      LOGE("gme_open_file failed: %s", err);
+      LOGE("libgme open failed: %s", err);
       gGmePlayer = nullptr;
       return JNI_FALSE;
     }
@@ -503,6 +1382,9 @@ JNIEXPORT jboolean JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nOpen(
 
     LOGD("nOpen: libgme success, %d tracks, sampleRate=%u", gGmeTrackCount,
          gSampleRate);
+    planTrackEnd();
+    configureChannelMeters();
+    publishStatus();
     return JNI_TRUE;
   }
 
@@ -518,6 +1400,8 @@ JNIEXPORT jboolean JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nOpen(
       return JNI_FALSE;
     }
 
+    resetPsfResampler();
+
     // Start asynchronous generation in background thread to avoid blocking UI
     int gen = gPsfCurrentGeneration.fetch_add(1, std::memory_order_relaxed) + 1;
     {
@@ -546,6 +1430,9 @@ JNIEXPORT jboolean JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nOpen(
     gPsfGenerationThread = std::move(t);
 
     gPlayerType = PlayerType::LIBPSF;
+    planTrackEnd();
+    configureChannelMeters();
+    publishStatus();
     return JNI_TRUE;
   }
 
@@ -553,43 +1440,10 @@ JNIEXPORT jboolean JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nOpen(
   if (isKssFormat(path)) {
     LOGD("Detected KSS format: %s", path);
 
-    // Read the entire file into memory for libkss
-    FILE *f = fopen(path, "rb");
-
-    if (!f) {
-      LOGE("Failed to open KSS file: %s", path);
-      env->ReleaseStringUTFChars(jpath, path);
-      return JNI_FALSE;
-    }
-
-    fseek(f, 0, SEEK_END);
-    long fileSize = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    LOGD("KSS file size: %ld bytes", fileSize);
-
-    std::vector<uint8_t> fileData(fileSize);
-    if (fread(fileData.data(), 1, fileSize, f) != (size_t)fileSize) {
-      LOGE("Failed to read KSS file");
-      fclose(f);
-      env->ReleaseStringUTFChars(jpath, path);
-      return JNI_FALSE;
-    }
-    fclose(f);
-
-    // Get filename for KSS_bin2kss (it uses filename for MBM detection)
-    const char *filename = strrchr(path, '/');
-    filename = filename ? filename + 1 : path;
-
-    env->ReleaseStringUTFChars(jpath, path);
-
-    // Log first 16 bytes for debugging
-    LOGD("KSS header: %02X %02X %02X %02X %02X %02X %02X %02X", fileData[0],
-         fileData[1], fileData[2], fileData[3], fileData[4], fileData[5],
-         fileData[6], fileData[7]);
-
     // Create KSS object using KSS_bin2kss which properly parses the header
     // KSS_bin2kss handles KSCC, KSSX, MGS, BGM, OPX, MPK, MBM formats
-    gKss = KSS_bin2kss(fileData.data(), fileSize, filename);
+    gKss = loadKss(path);
+    env->ReleaseStringUTFChars(jpath, path);
     if (!gKss) {
       LOGE("KSS_bin2kss failed");
       return JNI_FALSE;
@@ -623,6 +1477,9 @@ JNIEXPORT jboolean JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nOpen(
          "fmpac=%d, sn76489=%d",
          gKssTrackCount, gKss->trk_min, gKss->trk_max, gSampleRate, gKss->fmpac,
          gKss->sn76489);
+    planTrackEnd();
+    configureChannelMeters();
+    publishStatus();
     return JNI_TRUE;
   }
 
@@ -630,30 +1487,20 @@ JNIEXPORT jboolean JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nOpen(
   if (isOpenmptFormat(path)) {
     LOGD("Detected tracker format: %s", path);
 
-    // Read the entire file into memory for libopenmpt
-    FILE *f = fopen(path, "rb");
+    // Map the file for libopenmpt, which copies what it needs
+    MappedFile file;
+    bool mapped = mapped_file_open(&file, path, MAPPED_FILE_SEQUENTIAL);
     env->ReleaseStringUTFChars(jpath, path);
 
-    if (!f) {
+    if (!mapped) {
       LOGE("Failed to open tracker file");
       return JNI_FALSE;
     }
 
-    fseek(f, 0, SEEK_END);
-    long fileSize = ftell(f);
-    fseek(f, 0, SEEK_SET);
-
-    std::vector<char> fileData(fileSize);
-    if (fread(fileData.data(), 1, fileSize, f) != (size_t)fileSize) {
-      LOGE("Failed to read tracker file");
-      fclose(f);
-      return JNI_FALSE;
-    }
-    fclose(f);
-
     gOpenmptModule = openmpt_module_create_from_memory2(
-        fileData.data(), fileSize, openmpt_log_func_silent, nullptr,
+        file.data, file.size, openmpt_log_func_silent, nullptr,
         openmpt_error_func_ignore, nullptr, nullptr, nullptr, nullptr);
+    mapped_file_close(&file);
 
     if (!gOpenmptModule) {
       LOGE("openmpt_module_create_from_memory2 failed");
@@ -662,9 +1509,13 @@ JNIEXPORT jboolean JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nOpen(
 
     // Sample rate is set during creation, no need to set it separately
     // libopenmpt uses the sample rate passed to the read functions
+    transposeOpenmpt();
 
     gPlayerType = PlayerType::LIBOPENMPT;
     LOGD("nOpen: libopenmpt success, sampleRate=%u", gSampleRate);
+    planTrackEnd();
+    configureChannelMeters();
+    publishStatus();
     return JNI_TRUE;
   }
 
@@ -685,20 +1536,28 @@ JNIEXPORT jboolean JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nOpen(
     adl_setBank(gAdlPlayer, 14); // Bank 14 = DMX (Bobby Prince v2) - Doom bank!
     adl_setSoftPanEnabled(gAdlPlayer, 1); // Enable stereo panning
 
-    // Open the MIDI file
-    int result = adl_openFile(gAdlPlayer, path);
+    // Open the MIDI file from a mapping kept open, so it can be reopened
+    // transposed
+    bool loaded = mapped_file_open(&gMidiFile, path, MAPPED_FILE_SEQUENTIAL);
     env->ReleaseStringUTFChars(jpath, path);
+    int result = loaded ? openAdlTransposed(gMidiFile.data, gMidiFile.size)
+                        : -1;
 
     if (result != 0) {
-      LOGE("adl_openFile failed: %s", adl_errorInfo(gAdlPlayer));
+      LOGE("adl_openData failed: %s",
+           loaded ? adl_errorInfo(gAdlPlayer) : "file not readable");
       adl_close(gAdlPlayer);
       gAdlPlayer = nullptr;
+      mapped_file_close(&gMidiFile);
       return JNI_FALSE;
     }
 
     gPlayerType = PlayerType::LIBADLMIDI;
     LOGD("nOpen: libADLMIDI success, sampleRate=%u, bank=58 (DMXOP2)",
          gSampleRate);
+    planTrackEnd();
+    configureChannelMeters();
+    publishStatus();
     return JNI_TRUE;
   }
 
@@ -706,57 +1565,13 @@ JNIEXPORT jboolean JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nOpen(
   if (isMusFormat(path)) {
     LOGD("Detected MUS format: %s", path);
 
-    // Save path before releasing - needed for GENMIDI lookup
-    std::string musFilePath = path;
-
-    // Read the entire file into memory for libMusDoom
-    FILE *f = fopen(path, "rb");
+    // Convert MUS -> MIDI in memory (avoids libMusDoom playback hangs);
+    // only the converted MIDI data is kept
+    bool converted = musToMidi(path, &gMusDoomMidiData);
     env->ReleaseStringUTFChars(jpath, path);
-
-    if (!f) {
-      LOGE("Failed to open MUS file: %s", musFilePath.c_str());
-      return JNI_FALSE;
-    }
-
-    fseek(f, 0, SEEK_END);
-    long fileSize = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    LOGD("MUS file size: %ld bytes", fileSize);
-
-    gMusDoomData.resize(fileSize);
-    if (fread(gMusDoomData.data(), 1, fileSize, f) != (size_t)fileSize) {
-      LOGE("Failed to read MUS file");
-      fclose(f);
-      gMusDoomData.clear();
-      return JNI_FALSE;
-    }
-    fclose(f);
-
-    // Log first 16 bytes for debugging (MUS header starts with "MUS\x1a")
-    LOGD("MUS header: %02X %02X %02X %02X %02X %02X %02X %02X", gMusDoomData[0],
-         gMusDoomData[1], gMusDoomData[2], gMusDoomData[3], gMusDoomData[4],
-         gMusDoomData[5], gMusDoomData[6], gMusDoomData[7]);
-
-    // Convert MUS -> MIDI in memory (avoids libMusDoom playback hangs).
-    MEMFILE *musIn = mem_fopen_read(gMusDoomData.data(), gMusDoomData.size());
-    MEMFILE *midiOut = mem_fopen_write();
-    bool convertError = mus2mid(musIn, midiOut);
-
-    void *midiBuf = nullptr;
-    size_t midiSize = 0;
-    if (!convertError) {
-      mem_get_buf(midiOut, &midiBuf, &midiSize);
-    }
-    if (midiBuf && midiSize > 0) {
-      gMusDoomMidiData.assign(static_cast<uint8_t *>(midiBuf),
-                              static_cast<uint8_t *>(midiBuf) + midiSize);
-    }
-    mem_fclose(musIn);
-    mem_fclose(midiOut);
-
-    if (convertError || gMusDoomMidiData.empty()) {
+    if (!converted) {
       LOGE("mus2mid conversion failed");
-      gMusDoomData.clear();
+      gMusDoomMidiData.clear();
       return JNI_FALSE;
     }
 
@@ -771,8 +1586,8 @@ JNIEXPORT jboolean JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nOpen(
     adl_setBank(gAdlPlayer, 14); // DMX bank
     adl_setSoftPanEnabled(gAdlPlayer, 1);
 
-    int result = adl_openData(gAdlPlayer, gMusDoomMidiData.data(),
-                              (unsigned long)gMusDoomMidiData.size());
+    int result =
+        openAdlTransposed(gMusDoomMidiData.data(), gMusDoomMidiData.size());
     if (result != 0) {
       LOGE("adl_openData (MUS->MIDI) failed: %s", adl_errorInfo(gAdlPlayer));
       adl_close(gAdlPlayer);
@@ -783,20 +1598,23 @@ JNIEXPORT jboolean JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nOpen(
 
     gPlayerType = PlayerType::LIBADLMIDI;
     LOGD("nOpen: MUS->MIDI via libADLMIDI success, sampleRate=%u", gSampleRate);
+    planTrackEnd();
+    configureChannelMeters();
+    publishStatus();
     return JNI_TRUE;
   }
 
   // Use libvgm for VGM/VGZ files
-  gLoader = FileLoader_Init(path);
+  gLoader = mapped_file_loader(path);
   if (!gLoader) {
-    LOGE("FileLoader_Init failed for %s", path);
+    LOGE("Failed to map %s", path);
     env->ReleaseStringUTFChars(jpath, path);
     return JNI_FALSE;
   }
-  if (DataLoader_Load(gLoader)) {
-    LOGE("DataLoader_Load failed for %s", path);
+  if (mapped_file_loader_load(gLoader)) {
+    LOGE("Loading failed for %s", path);
     env->ReleaseStringUTFChars(jpath, path);
-    DataLoader_Deinit(gLoader);
+    mapped_file_loader_free(gLoader);
     gLoader = nullptr;
     return JNI_FALSE;
   }
@@ -806,17 +1624,29 @@ JNIEXPORT jboolean JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nOpen(
   gVgmPlayer = new VGMPlayer();
   gVgmPlayer->SetSampleRate(gSampleRate);
   gVgmPlayer->SetFileReqCallback(RequestFileCallback, nullptr);
+  gVgmPlayer->SetEventCallback(vgmEventCallback, nullptr);
 
   VGM_PLAY_OPTIONS opts;
   memset(&opts, 0, sizeof(opts));
   opts.playbackHz = 0;
   gVgmPlayer->SetPlayerOptions(opts);
 
+  // The whole file is loaded (mapped) from here on; keep its header so the
+  // clocks can be rewritten for another key
+  DataLoader_ReadAll(gLoader);
+  {
+    const UINT8 *data = DataLoader_GetData(gLoader);
+    UINT32 size = DataLoader_GetSize(gLoader);
+    gVgmHeader.assign(data, data + std::min<UINT32>(
+                                       size, TRANSPOSE_VGM_HEADER_SIZE));
+  }
+  transposeVgmData();
+
   if (gVgmPlayer->LoadFile(gLoader)) {
     LOGE("LoadFile failed");
     delete gVgmPlayer;
     gVgmPlayer = nullptr;
-    DataLoader_Deinit(gLoader);
+    mapped_file_loader_free(gLoader);
     gLoader = nullptr;
     return JNI_FALSE;
   }
@@ -825,12 +1655,17 @@ JNIEXPORT jboolean JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nOpen(
   gVgmPlayer->SetSampleRate(gSampleRate);
   gVgmPlayer->Start();
   LOGD("nOpen: libvgm success, sampleRate=%u", gSampleRate);
+  planTrackEnd();
+  configureChannelMeters();
+  publishStatus();
   return JNI_TRUE;
 }
 
 JNIEXPORT void JNICALL
 Java_org_vlessert_vgmp_engine_VgmEngine_nClose(JNIEnv *env, jclass cls) {
+  discardNextDecoder();
   cleanup();
+  publishStatus();
 }
 
 JNIEXPORT void JNICALL
@@ -840,6 +1675,7 @@ Java_org_vlessert_vgmp_engine_VgmEngine_nPlay(JNIEnv *env, jclass cls) {
     gVgmPlayer->Start();
   }
   if (gPlayerType == PlayerType::LIBPSF) {
+    resetPsfResampler();
     std::lock_guard<std::mutex> lock(gPsfStateMutex);
     gPsfPlaybackPos = 0;
   }
@@ -860,53 +1696,60 @@ Java_org_vlessert_vgmp_engine_VgmEngine_nStop(JNIEnv *env, jclass cls) {
   // libgme doesn't have a separate stop function
 }
 
-JNIEXPORT jboolean JNICALL
-Java_org_vlessert_vgmp_engine_VgmEngine_nIsEnded(JNIEnv *env, jclass cls) {
+static bool isTrackEnded() {
+  // Planned (loop count) or manual fade has run out
+  if (gFadeEndSample >= 0 && gOutputSample >= gFadeEndSample)
+    return true;
+
   // In endless loop mode, never report track as ended
   if (gEndlessLoopMode) {
-    return JNI_FALSE;
+    return false;
   }
 
   if (gPlayerType == PlayerType::LIBVGM && gVgmPlayer) {
-    return (gVgmPlayer->GetState() & PLAYSTATE_END) ? JNI_TRUE : JNI_FALSE;
+    return (gVgmPlayer->GetState() & PLAYSTATE_END) != 0;
   }
   if (gPlayerType == PlayerType::LIBGME && gGmePlayer) {
-    return gme_track_ended(gGmePlayer) ? JNI_TRUE : JNI_FALSE;
+    return gme_track_ended(gGmePlayer) != 0;
   }
   if (gPlayerType == PlayerType::LIBOPENMPT && gOpenmptModule) {
-    // Tracker modules loop forever by default - check if we've reached end
-    // openmpt doesn't have a built-in "ended" check, so we rely on position
-    return JNI_FALSE; // Tracker files typically loop forever
+    // openmpt has no "ended" query; a short read means the repeats ran out
+    return gStreamExhausted;
   }
   if (gPlayerType == PlayerType::LIBKSS && gKssPlay) {
     // KSS files can detect stop via KSSPLAY_get_stop_flag
-    return KSSPLAY_get_stop_flag(gKssPlay) ? JNI_TRUE : JNI_FALSE;
+    return KSSPLAY_get_stop_flag(gKssPlay) != 0;
   }
   if (gPlayerType == PlayerType::LIBADLMIDI && gAdlPlayer) {
     // libADLMIDI: check if position >= total length
     double position = adl_positionTell(gAdlPlayer);
     double total = adl_totalTimeLength(gAdlPlayer);
     if (total > 0 && position >= total) {
-      return JNI_TRUE;
+      return true;
     }
-    return JNI_FALSE;
+    return false;
   }
   if (gPlayerType == PlayerType::LIBPSF) {
     std::lock_guard<std::mutex> lock(gPsfStateMutex);
     if (!gPsfCacheReady.load(std::memory_order_acquire))
-      return JNI_FALSE; // still generating initial buffer
+      return false; // still generating initial buffer
     if (!gPsfGenerationComplete.load(std::memory_order_acquire))
-      return JNI_FALSE; // generating but buffer ready, not ended yet
+      return false; // generating but buffer ready, not ended yet
     size_t cacheSize = gPsfAudioCachePtr ? gPsfAudioCachePtr->size() : 0;
     size_t currentPos = gPsfPlaybackPos.load(std::memory_order_relaxed);
-    return (currentPos >= cacheSize) ? JNI_TRUE : JNI_FALSE;
+    return currentPos >= cacheSize;
   }
   if (gPlayerType == PlayerType::LIBMUSDOOM && gMusDoomPlayer) {
     // libMusDoom: check if music is still playing
     // MUS files loop by default when started with looping=1
-    return musdoom_is_playing(gMusDoomPlayer) ? JNI_FALSE : JNI_TRUE;
+    return !musdoom_is_playing(gMusDoomPlayer);
   }
-  return JNI_TRUE;
+  return true;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_org_vlessert_vgmp_engine_VgmEngine_nIsEnded(JNIEnv *env, jclass cls) {
+  return isTrackEnded() ? JNI_TRUE : JNI_FALSE;
 }
 
 JNIEXPORT jboolean JNICALL
@@ -921,6 +1764,8 @@ Java_org_vlessert_vgmp_engine_VgmEngine_nIsPsfCacheReady(JNIEnv *env,
 JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSetBassEnabled(
     JNIEnv *env, jclass cls, jboolean enabled) {
   gBassEnabled = (enabled == JNI_TRUE);
+  // Bass boost is a preset on EQ band 0: +6 dB low shelf at 120 Hz
+  eq_set_band(0, EQ_LOW_SHELF, 120.0f, gBassEnabled ? 6.0f : 0.0f, 0.707f);
   LOGD("Bass enabled: %d", gBassEnabled);
 }
 
@@ -930,29 +1775,84 @@ Java_org_vlessert_vgmp_engine_VgmEngine_nGetBassEnabled(JNIEnv *env,
   return gBassEnabled ? JNI_TRUE : JNI_FALSE;
 }
 
+// Parametric EQ. type: 0 low shelf, 1 peaking, 2 high shelf; gainDb 0 turns
+// the band off. Band 0 is shared with the bass boost preset.
+JNIEXPORT jboolean JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSetEqBand(
+    JNIEnv *env, jclass cls, jint band, jint type, jfloat freqHz,
+    jfloat gainDb, jfloat q) {
+  return eq_set_band(band, type, freqHz, gainDb, q) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSetEqEnabled(
+    JNIEnv *env, jclass cls, jboolean enabled) {
+  eq_set_enabled(enabled == JNI_TRUE);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_org_vlessert_vgmp_engine_VgmEngine_nGetEqEnabled(JNIEnv *env,
+                                                      jclass cls) {
+  return eq_enabled() ? JNI_TRUE : JNI_FALSE;
+}
+
+// Output limiter: also catch inter-sample peaks (costs more while limiting)
+JNIEXPORT void JNICALL
+Java_org_vlessert_vgmp_engine_VgmEngine_nSetLimiterTruePeak(JNIEnv *env,
+                                                            jclass cls,
+                                                            jboolean enabled) {
+  limiter_set_true_peak(enabled == JNI_TRUE);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_org_vlessert_vgmp_engine_VgmEngine_nGetLimiterTruePeak(JNIEnv *env,
+                                                            jclass cls) {
+  return limiter_true_peak() ? JNI_TRUE : JNI_FALSE;
+}
+
+// Output loudness / true-peak / correlation meters (status block)
+JNIEXPORT void JNICALL
+Java_org_vlessert_vgmp_engine_VgmEngine_nSetOutputMeterEnabled(
+    JNIEnv *env, jclass cls, jboolean enabled) {
+  output_meter_set_enabled(enabled == JNI_TRUE);
+  publishStatus();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_org_vlessert_vgmp_engine_VgmEngine_nGetOutputMeterEnabled(JNIEnv *env,
+                                                               jclass cls) {
+  return output_meter_enabled() ? JNI_TRUE : JNI_FALSE;
+}
+
 // Reverb control
 JNIEXPORT void JNICALL
 Java_org_vlessert_vgmp_engine_VgmEngine_nSetReverbEnabled(JNIEnv *env,
                                                           jclass cls,
                                                           jboolean enabled) {
-  gReverbEnabled = (enabled == JNI_TRUE);
-  if (!gReverbEnabled) {
-    // Clear reverb buffer when disabled
-    memset(gReverbBuffer, 0, sizeof(gReverbBuffer));
-    gReverbWritePos = 0;
-  }
-  LOGD("Reverb enabled: %d", gReverbEnabled);
+  reverb_set_enabled(enabled == JNI_TRUE);
+  LOGD("Reverb enabled: %d", reverb_enabled());
 }
 
 JNIEXPORT jboolean JNICALL
 Java_org_vlessert_vgmp_engine_VgmEngine_nGetReverbEnabled(JNIEnv *env,
                                                           jclass cls) {
-  return gReverbEnabled ? JNI_TRUE : JNI_FALSE;
+  return reverb_enabled() ? JNI_TRUE : JNI_FALSE;
 }
 
 JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSetEndlessLoop(
     JNIEnv *env, jclass cls, jboolean enabled) {
   gEndlessLoopMode = (enabled == JNI_TRUE);
+  if (gEndlessLoopMode)
+    discardNextDecoder();
+
+  // Leaving endless mode while the loop cache was playing: the backend
+  // stopped at the point the cache took over, so move it to the matching
+  // spot of the first loop pass and carry on from there
+  if (!gEndlessLoopMode && gServingLoopCache) {
+    int64_t pos = loop_cache_equivalent(gOutputSample);
+    seekBackend(pos);
+    resetEndState();
+    gOutputSample = pos;
+    gServingLoopCache = false;
+  }
 
   if (gPlayerType == PlayerType::LIBGME && gGmePlayer) {
     if (gEndlessLoopMode) {
@@ -969,7 +1869,8 @@ JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSetEndlessLoop(
     gme_set_autoload_playback_limit(gGmePlayer, enabled ? 0 : 1);
   }
   // For VGM, the endless loop is handled by the gEndlessLoopMode flag in
-  // nIsEnded
+  // nIsEnded. Re-plan (or drop) the loop-count ending for the new mode.
+  planTrackEnd();
 }
 
 JNIEXPORT jboolean JNICALL
@@ -978,38 +1879,118 @@ Java_org_vlessert_vgmp_engine_VgmEngine_nGetEndlessLoop(JNIEnv *env,
   return gEndlessLoopMode ? JNI_TRUE : JNI_FALSE;
 }
 
-// Playback speed control (0.25 to 1.0 for 25% to 100%)
-static double gPlaybackSpeed = 1.0;
+// Loop-count ending: how many times the loop section plays before the fade
+JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSetLoopCount(
+    JNIEnv *env, jclass cls, jint loops) {
+  gLoopCount = loops < 1 ? 1 : loops;
+  planTrackEnd();
+  if (gXfadeStart < 0 || gOutputSample < gXfadeStart)
+    planCrossfade(); // follow the new ending unless already fading
+  publishStatus();
+}
+
+JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSetFadeLength(
+    JNIEnv *env, jclass cls, jint ms) {
+  gFadeMs = ms < 0 ? 0 : ms;
+  planTrackEnd();
+  if (gXfadeStart < 0 || gOutputSample < gXfadeStart)
+    planCrossfade();
+  publishStatus();
+}
+
+// Crossfade length into the prepared next track; 0 hands over gaplessly.
+// Applies from the next nPrepareNext.
+JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSetCrossfade(
+    JNIEnv *env, jclass cls, jint ms) {
+  gCrossfadeMs = ms < 0 ? 0 : (ms > CROSSFADE_MAX_MS ? CROSSFADE_MAX_MS : ms);
+}
+
+static float dbToTrackGain(float db) {
+  if (db < -24.0f)
+    db = -24.0f;
+  if (db > 12.0f)
+    db = 12.0f;
+  return std::pow(10.0f, db / 20.0f);
+}
+
+// Loudness normalisation of the open track in dB (ReplayGain style); reset to
+// 0 by every open. The limiter catches what a positive gain pushes over.
+JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSetTrackGain(
+    JNIEnv *env, jclass cls, jfloat gainDb) {
+  gTrackGain = dbToTrackGain(gainDb);
+}
+
+// Fade out from the current position over `ms` and end the track (manual
+// skip). Never lengthens an ending that is already closer.
+JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nFadeOut(
+    JNIEnv *env, jclass cls, jint ms) {
+  if (gPlayerType == PlayerType::NONE)
+    return;
+  // A manual fade-out is followed by an explicit open; don't hand over to the
+  // prepared track when it finishes
+  discardNextDecoder();
+  int64_t end = gOutputSample + msToSamples(ms < 0 ? 0 : ms);
+  if (gFadeEndSample >= 0 && gFadeEndSample <= end &&
+      gFadeStartSample <= gOutputSample)
+    return;
+  gFadeStartSample = gOutputSample;
+  gFadeEndSample = end;
+}
 
+// Playback speed control (0.25 to 1.0 for 25% to 100%). Every backend keeps
+// rendering at normal speed; the time stretch after the effects slows the
+// output down without changing its pitch.
 JNIEXPORT void JNICALL
 Java_org_vlessert_vgmp_engine_VgmEngine_nSetPlaybackSpeed(JNIEnv *env,
                                                           jclass cls,
                                                           jdouble speed) {
-  gPlaybackSpeed = speed;
-
-  if (gPlayerType == PlayerType::LIBVGM && gVgmPlayer) {
-    gVgmPlayer->SetPlaybackSpeed(speed);
-  }
-  if (gPlayerType == PlayerType::LIBGME && gGmePlayer) {
-    // gme_set_tempo uses tempo where 1.0 = normal, 2.0 = double speed
-    gme_set_tempo(gGmePlayer, speed);
-  }
-  if (gPlayerType == PlayerType::LIBKSS && gKssPlay) {
-    // KSSPLAY uses CPU speed multiplier (1.0 = normal, 2.0 = double speed)
-    KSSPLAY_set_speed(gKssPlay, speed);
-  }
-  // libopenmpt doesn't have a direct speed control API
+  timestretch_set_speed((float)speed);
 }
 
 JNIEXPORT jdouble JNICALL
 Java_org_vlessert_vgmp_engine_VgmEngine_nGetPlaybackSpeed(JNIEnv *env,
                                                           jclass cls) {
-  return gPlaybackSpeed;
+  return timestretch_speed();
 }
 
-JNIEXPORT jlong JNICALL
-Java_org_vlessert_vgmp_engine_VgmEngine_nGetTotalSamples(JNIEnv *env,
-                                                         jclass cls) {
+// Varispeed: slow down like a tape, the pitch following the speed. Only the
+// resampler runs, no time stretch.
+JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSetVarispeed(
+    JNIEnv *env, jclass cls, jboolean enabled) {
+  gVarispeed = enabled == JNI_TRUE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_org_vlessert_vgmp_engine_VgmEngine_nGetVarispeed(JNIEnv *env,
+                                                      jclass cls) {
+  return gVarispeed ? JNI_TRUE : JNI_FALSE;
+}
+
+// Resampler preset, 0 = low .. 2 = high (see resampler.h)
+JNIEXPORT void JNICALL
+Java_org_vlessert_vgmp_engine_VgmEngine_nSetResamplerQuality(JNIEnv *env,
+                                                             jclass cls,
+                                                             jint quality) {
+  if (quality < RESAMPLER_LOW)
+    quality = RESAMPLER_LOW;
+  if (quality > RESAMPLER_HIGH)
+    quality = RESAMPLER_HIGH;
+  gResamplerQuality = (ResamplerQuality)quality;
+  timestretch_set_resampler_quality(gResamplerQuality);
+  if (gPsfResamplerInit)
+    resampler_set_quality(&gPsfResampler, gResamplerQuality);
+}
+
+JNIEXPORT jint JNICALL
+Java_org_vlessert_vgmp_engine_VgmEngine_nGetResamplerQuality(JNIEnv *env,
+                                                             jclass cls) {
+  return gResamplerQuality;
+}
+
+static jlong totalSamples() {
+  // A planned ending is the real length, including the fade
+  if (gFadeEndSample >= 0 && !gEndlessLoopMode)
+    return (jlong)gFadeEndSample;
   if (gPlayerType == PlayerType::LIBVGM && gVgmPlayer) {
     // VGM files have accurate length from GD3 tags, use directly
     return (jlong)gVgmPlayer->Tick2Sample(gVgmPlayer->GetTotalTicks());
@@ -1081,8 +2062,14 @@ Java_org_vlessert_vgmp_engine_VgmEngine_nGetTotalSamples(JNIEnv *env,
 }
 
 JNIEXPORT jlong JNICALL
-Java_org_vlessert_vgmp_engine_VgmEngine_nGetCurrentSample(JNIEnv *env,
-                                                          jclass cls) {
+Java_org_vlessert_vgmp_engine_VgmEngine_nGetTotalSamples(JNIEnv *env,
+                                                         jclass cls) {
+  return totalSamples();
+}
+
+static jlong currentSample() {
+  if (gServingLoopCache)
+    return (jlong)gOutputSample; // backend is parked at the loop start
   if (gPlayerType == PlayerType::LIBVGM && gVgmPlayer) {
     return (jlong)gVgmPlayer->Tick2Sample(gVgmPlayer->GetCurPos(PLAYPOS_TICK));
   }
@@ -1096,10 +2083,8 @@ Java_org_vlessert_vgmp_engine_VgmEngine_nGetCurrentSample(JNIEnv *env,
     return (jlong)(seconds * gSampleRate);
   }
   if (gPlayerType == PlayerType::LIBKSS && gKssPlay) {
-    // KSS doesn't have a direct position function
-    // We track position via decoded_length which is updated during calc
-    // Return 0 for now - proper position tracking would need a timer
-    return 0;
+    // KSS doesn't have a direct position function; nFillBuffer counts frames
+    return (jlong)gKssRenderedFrames;
   }
   if (gPlayerType == PlayerType::LIBADLMIDI && gAdlPlayer) {
     double positionSeconds = adl_positionTell(gAdlPlayer);
@@ -1112,13 +2097,20 @@ Java_org_vlessert_vgmp_engine_VgmEngine_nGetCurrentSample(JNIEnv *env,
   if (gPlayerType == PlayerType::LIBPSF) {
     std::lock_guard<std::mutex> lock(gPsfStateMutex);
     // gPsfPlaybackPos is in bytes; each frame is 4 bytes (stereo 16-bit)
-    return (jlong)(gPsfPlaybackPos.load(std::memory_order_relaxed) / 4);
+    jlong generated =
+        (jlong)(gPsfPlaybackPos.load(std::memory_order_relaxed) / 4);
+    return generated * gSampleRate / PSF_SAMPLE_RATE;
   }
   return 0;
 }
 
-JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSeek(
-    JNIEnv *env, jclass cls, jlong samplePos) {
+JNIEXPORT jlong JNICALL
+Java_org_vlessert_vgmp_engine_VgmEngine_nGetCurrentSample(JNIEnv *env,
+                                                          jclass cls) {
+  return currentSample();
+}
+
+static void seekBackend(int64_t samplePos) {
   if (gPlayerType == PlayerType::LIBVGM && gVgmPlayer) {
     gVgmPlayer->Seek(PLAYPOS_SAMPLE, (UINT32)samplePos);
   }
@@ -1135,9 +2127,12 @@ JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSeek(
     adl_positionSeek(gAdlPlayer, seconds);
   }
   if (gPlayerType == PlayerType::LIBPSF) {
+    resetPsfResampler();
     std::lock_guard<std::mutex> lock(gPsfStateMutex);
-    // Convert sample position to bytes (4 bytes per stereo frame)
-    size_t targetBytes = (size_t)samplePos * 4;
+    // Convert the output sample position to generated bytes (4 bytes per
+    // stereo frame at PSF_SAMPLE_RATE)
+    size_t targetBytes =
+        (size_t)(samplePos * PSF_SAMPLE_RATE / gSampleRate) * 4;
     if (gPsfAudioCachePtr) {
       // Clamp to available data (cannot seek beyond generated buffer)
       size_t maxBytes = gPsfAudioCachePtr->size();
@@ -1172,26 +2167,182 @@ JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSeek(
       remaining -= toCalc;
     }
   }
+  if (gPlayerType == PlayerType::LIBKSS)
+    gKssRenderedFrames = samplePos;
   if (gPlayerType == PlayerType::LIBMUSDOOM && gMusDoomPlayer) {
     uint32_t positionMs = (uint32_t)(samplePos * 1000 / gSampleRate);
     musdoom_seek_ms(gMusDoomPlayer, positionMs);
   }
 }
 
-/**
- * Fill a short[] buffer with stereo int16 PCM samples.
- * buffer layout: [L0, R0, L1, R1, ...]  (interleaved stereo)
- * Returns number of sample frames written.
- */
-JNIEXPORT jint JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nFillBuffer(
-    JNIEnv *env, jclass cls, jshortArray buffer, jint frames) {
-  if (frames <= 0)
+JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSeek(
+    JNIEnv *env, jclass cls, jlong samplePos) {
+  // The prepared track (and its crossfade pre-render) assumed the old
+  // position; the caller prepares it again
+  discardNextDecoder();
+  seekBackend(samplePos);
+  // Don't ring the filters on the jump, or play the delayed and reverberated
+  // audio of the old position after it
+  eq_reset();
+  reverb_reset();
+  limiter_reset();
+  timestretch_reset();
+  resetEndState();
+  gOutputSample = samplePos;
+  // A verified loop cache stays valid: positions past its start are served
+  // from it on the next buffer
+  gServingLoopCache = gEndlessLoopMode && loop_cache_ready() &&
+                      gOutputSample >= loop_cache_start();
+  publishStatus();
+}
+
+// Re-key the live decoder after gTranspose changed. Decoders that play
+// rewritten input are reloaded and put back at the current position; the
+// rest are pitched by the time stretch stage.
+static void retransposeDecoder() {
+  if (gPlayerType == PlayerType::LIBOPENMPT && gOpenmptModule) {
+    transposeOpenmpt();
+    return;
+  }
+  bool vgm = gPlayerType == PlayerType::LIBVGM && gVgmPlayer &&
+             !gVgmHeader.empty();
+  bool adl = gPlayerType == PlayerType::LIBADLMIDI && gAdlPlayer &&
+             (gMidiFile.data || !gMusDoomMidiData.empty());
+  if (!vgm && !adl)
+    return;
+
+  // The loop cache and the pre-rendered audio are in the old key
+  int64_t pos = gServingLoopCache ? loop_cache_equivalent(gOutputSample)
+                                  : gOutputSample;
+  if (vgm) {
+    gVgmPlayer->Stop();
+    gVgmPlayer->UnloadFile();
+    transposeVgmData();
+    if (gVgmPlayer->LoadFile(gLoader)) {
+      LOGE("LoadFile failed after transpose");
+      return;
+    }
+    gVgmPlayer->SetSampleRate(gSampleRate);
+    gVgmPlayer->Start();
+  } else if ((gMidiFile.data
+                  ? openAdlTransposed(gMidiFile.data, gMidiFile.size)
+                  : openAdlTransposed(gMusDoomMidiData.data(),
+                                      gMusDoomMidiData.size())) != 0) {
+    LOGE("adl_openData failed after transpose: %s",
+         adl_errorInfo(gAdlPlayer));
+    return;
+  }
+  seekBackend(pos);
+  resetEndState();
+  gOutputSample = pos;
+  gPreroll.clear();
+  gPrerollPos = 0;
+  gServingLoopCache = false;
+  loop_cache_reset();
+  planLoopCache();
+}
+
+// Key change in semitones, -TRANSPOSE_MAX_SEMITONES..TRANSPOSE_MAX_SEMITONES.
+// Applies to the open track at once and to every track opened later.
+JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSetTranspose(
+    JNIEnv *env, jclass cls, jint semitones) {
+  if (semitones < -TRANSPOSE_MAX_SEMITONES)
+    semitones = -TRANSPOSE_MAX_SEMITONES;
+  if (semitones > TRANSPOSE_MAX_SEMITONES)
+    semitones = TRANSPOSE_MAX_SEMITONES;
+  if (semitones == gTranspose)
+    return;
+  gTranspose = semitones;
+  // The prepared track was opened in the old key; the caller prepares it
+  // again
+  discardNextDecoder();
+  retransposeDecoder();
+  LOGD("transpose %+d semitones, %+d by the decoder", gTranspose,
+       gTrackTranspose);
+  publishStatus();
+}
+
+JNIEXPORT jint JNICALL
+Java_org_vlessert_vgmp_engine_VgmEngine_nGetTranspose(JNIEnv *env,
+                                                      jclass cls) {
+  return gTranspose;
+}
+
+// Up to `frames` frames of generated PSF audio from the playback position.
+static jint readPsfCache(jshort *dst, jint frames) {
+  // Lock-free read: gPsfCommittedBytes is advanced by sexyd_update AFTER
+  // each insert(), so it only ever points to fully-written data.
+  // The vector is pre-reserved so it never reallocates — the raw data
+  // pointer is stable for the lifetime of the track.
+  static int psfZeroLogCounter = 0;
+  size_t committed = gPsfCommittedBytes.load(std::memory_order_acquire);
+  size_t currentPos = gPsfPlaybackPos.load(std::memory_order_relaxed);
+  const uint8_t *rawBuf = nullptr;
+  {
+    // One brief lock just to read the raw pointer (zero-copy, fast).
+    std::lock_guard<std::mutex> lock(gPsfStateMutex);
+    if (gPsfAudioCachePtr && committed > 0)
+      rawBuf = gPsfAudioCachePtr->data();
+  }
+  if (!rawBuf || committed <= currentPos + 4) {
+    if (psfZeroLogCounter++ % 100 == 0)
+      LOGD("PSF underrun: committed=%zu pos=%zu", committed, currentPos);
     return 0;
+  }
+  size_t bytesAvailable = committed - currentPos;
+  size_t framesAvailable = bytesAvailable / 4;
+  jint framesToCopy =
+      (framesAvailable >= (size_t)frames) ? frames : (jint)framesAvailable;
+  if (framesToCopy > 0) {
+    // Safe: rawBuf is stable (pre-reserved), bytes are committed.
+    memcpy(dst, rawBuf + currentPos, (size_t)framesToCopy * 4);
+    gPsfPlaybackPos.store(currentPos + (size_t)framesToCopy * 4,
+                          std::memory_order_relaxed);
+  }
+  return framesToCopy;
+}
 
-  jshort *dst = (jshort *)env->GetShortArrayElements(buffer, nullptr);
+// PSF audio converted to the output rate.
+static jint readPsfResampled(jshort *dst, jint frames) {
+  enum { CHUNK = 1024 };
+  jshort pcm[CHUNK * 2];
+  float x[CHUNK * 2];
+  jint written = 0;
+  while (written < frames) {
+    int n = frames - written < CHUNK ? frames - written : CHUNK;
+    int got = resampler_pull(&gPsfResampler, x, n);
+    for (int i = 0; i < got * 2; i++) {
+      float v = x[i] * 32768.0f;
+      dst[written * 2 + i] =
+          (jshort)(v > 32767.0f ? 32767.0f : (v < -32768.0f ? -32768.0f : v));
+    }
+    written += got;
+    if (written == frames)
+      break;
+    int want = resampler_input_wanted(&gPsfResampler, frames - written);
+    jint in = readPsfCache(pcm, want < CHUNK ? want : CHUNK);
+    if (in == 0)
+      break;
+    for (jint i = 0; i < in * 2; i++)
+      x[i] = pcm[i] * (1.0f / 32768.0f);
+    resampler_push(&gPsfResampler, x, in);
+  }
+  return written;
+}
+
+// Raw output of the active backend for `frames` frames starting at output
+// sample `startSample`. Returns the frames written.
+static jint decodeBackend(jshort *dst, jint frames, int64_t startSample) {
   jint written = 0;
 
-  if (gPlayerType == PlayerType::LIBVGM && gVgmPlayer) {
+  // Endless mode past the verified loop start: replay the cached loop body
+  // instead of running the emulation
+  gServingLoopCache = gEndlessLoopMode && loop_cache_ready() &&
+                      startSample >= loop_cache_start();
+
+  if (gServingLoopCache) {
+    written = loop_cache_read(dst, frames, startSample);
+  } else if (gPlayerType == PlayerType::LIBVGM && gVgmPlayer) {
     enum { MAX_FRAMES = 4096 };
     static WAVE_32BS buf[MAX_FRAMES];
 
@@ -1200,15 +2351,25 @@ JNIEXPORT jint JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nFillBuffer(
     while (remaining > 0) {
       jint chunk = (remaining > MAX_FRAMES) ? MAX_FRAMES : remaining;
       memset(buf, 0, chunk * sizeof(WAVE_32BS));
+      UINT32 startSmpl = gVgmPlayer->GetCurPos(PLAYPOS_SAMPLE);
       UINT32 got = gVgmPlayer->Render((UINT32)chunk, buf);
       if (got == 0) {
         LOGD("nFillBuffer: Render returned 0");
         break;
       }
+      // The END callback fired inside this chunk: drop the frames rendered
+      // past the end so the next track starts at the exact sample
+      bool hitEnd = false;
+      if (gVgmEndSample >= 0 && !gEndEventSent) {
+        int64_t keep = gVgmEndSample - (int64_t)startSmpl;
+        if (keep >= 0 && keep < (int64_t)got)
+          got = (UINT32)keep;
+        hitEnd = true;
+      }
 
       for (jint i = 0; i < (jint)got; i++) {
-        INT32 l = buf[i].L >> 8;
-        INT32 r = buf[i].R >> 8;
+        INT32 l = buf[i].L >> LIBVGM_BUS_SHIFT;
+        INT32 r = buf[i].R >> LIBVGM_BUS_SHIFT;
         if (l > 32767)
           l = 32767;
         if (l < -32768)
@@ -1219,12 +2380,11 @@ JNIEXPORT jint JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nFillBuffer(
           r = -32768;
         dst[(written + i) * 2] = (jshort)l;
         dst[(written + i) * 2 + 1] = (jshort)r;
-
-        gFftRingBuffer[gFftWriteIdx] = (float)(l + r) / 65536.0f;
-        gFftWriteIdx = (gFftWriteIdx + 1) % FFT_SIZE;
       }
       written += (jint)got;
       remaining -= (jint)got;
+      if (hitEnd)
+        break;
     }
   } else if (gPlayerType == PlayerType::LIBGME && gGmePlayer) {
     // libgme outputs directly in 16-bit stereo interleaved format
@@ -1233,31 +2393,43 @@ JNIEXPORT jint JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nFillBuffer(
       LOGE("gme_play error: %s", err);
     } else {
       written = frames;
-
-      // Feed mono samples to FFT ring buffer
-      for (jint i = 0; i < written; i++) {
-        float sample =
-            (float)dst[i * 2] / 32768.0f + (float)dst[i * 2 + 1] / 32768.0f;
-        gFftRingBuffer[gFftWriteIdx] = sample / 2.0f;
-        gFftWriteIdx = (gFftWriteIdx + 1) % FFT_SIZE;
-      }
     }
   } else if (gPlayerType == PlayerType::LIBOPENMPT && gOpenmptModule) {
     // libopenmpt outputs stereo interleaved
     written = (jint)openmpt_module_read_interleaved_stereo(
         gOpenmptModule, gSampleRate, frames, dst);
-
-    // Feed mono samples to FFT ring buffer
-    for (jint i = 0; i < written; i++) {
-      float sample =
-          (float)dst[i * 2] / 32768.0f + (float)dst[i * 2 + 1] / 32768.0f;
-      gFftRingBuffer[gFftWriteIdx] = sample / 2.0f;
-      gFftWriteIdx = (gFftWriteIdx + 1) % FFT_SIZE;
-    }
+    if (written < frames)
+      gStreamExhausted = true;
   } else if (gPlayerType == PlayerType::LIBKSS && gKssPlay) {
     // libkss outputs stereo interleaved 16-bit
     KSSPLAY_calc(gKssPlay, dst, frames);
     written = frames;
+    gKssRenderedFrames += frames;
+
+    // libkss detects loops itself; report them and start the loop-count fade
+    // when the track has no explicit length
+    int kssLoops = KSSPLAY_get_loop_count(gKssPlay);
+    if (kssLoops > gKssLastLoopCount) {
+      gKssLastLoopCount = kssLoops;
+      pushEngineEvent(ENGINE_EVENT_LOOP, kssLoops,
+                      heardSample(gKssRenderedFrames));
+      // libkss has no loop points up front: capture from the first reported
+      // loop and take the distance to the second as the loop length. The
+      // detection is per buffer, so the seam search spans one buffer.
+      if (gEndlessLoopMode) {
+        if (!loop_cache_capturing() && !loop_cache_ready() &&
+            !loop_cache_failed()) {
+          loop_cache_begin(startSample + written, -1, 0, gSampleRate);
+        } else if (loop_cache_capturing()) {
+          loop_cache_set_length(startSample + written - loop_cache_start(),
+                                frames);
+        }
+      }
+      if (kssLoops >= gLoopCount && gFadeEndSample < 0 && !gEndlessLoopMode) {
+        gFadeStartSample = startSample + written;
+        gFadeEndSample = gFadeStartSample + msToSamples(gFadeMs);
+      }
+    }
 
     // Debug: log first few samples occasionally
     static int kssLogCounter = 0;
@@ -1265,70 +2437,16 @@ JNIEXPORT jint JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nFillBuffer(
       LOGD("KSS samples: L=%d R=%d, stop_flag=%d", dst[0], dst[1],
            KSSPLAY_get_stop_flag(gKssPlay));
     }
-
-    // Feed mono samples to FFT ring buffer
-    for (jint i = 0; i < written; i++) {
-      float sample =
-          (float)dst[i * 2] / 32768.0f + (float)dst[i * 2 + 1] / 32768.0f;
-      gFftRingBuffer[gFftWriteIdx] = sample / 2.0f;
-      gFftWriteIdx = (gFftWriteIdx + 1) % FFT_SIZE;
-    }
   } else if (gPlayerType == PlayerType::LIBADLMIDI && gAdlPlayer) {
     // libADLMIDI outputs stereo interleaved 16-bit
     // adl_play returns number of samples rendered (stereo pairs)
     int samplesRendered = adl_play(gAdlPlayer, frames * 2, dst);
     if (samplesRendered > 0) {
       written = samplesRendered / 2; // Convert sample count to frame count
-
-      // Feed mono samples to FFT ring buffer
-      for (jint i = 0; i < written; i++) {
-        float sample =
-            (float)dst[i * 2] / 32768.0f + (float)dst[i * 2 + 1] / 32768.0f;
-        gFftRingBuffer[gFftWriteIdx] = sample / 2.0f;
-        gFftWriteIdx = (gFftWriteIdx + 1) % FFT_SIZE;
-      }
     }
   } else if (gPlayerType == PlayerType::LIBPSF) {
-    // Lock-free read: gPsfCommittedBytes is advanced by sexyd_update AFTER
-    // each insert(), so it only ever points to fully-written data.
-    // The vector is pre-reserved so it never reallocates — the raw data
-    // pointer is stable for the lifetime of the track.
-    static int psfZeroLogCounter = 0;
-    size_t committed = gPsfCommittedBytes.load(std::memory_order_acquire);
-    size_t currentPos = gPsfPlaybackPos.load(std::memory_order_relaxed);
-    const uint8_t *rawBuf = nullptr;
-    {
-      // One brief lock just to read the raw pointer (zero-copy, fast).
-      std::lock_guard<std::mutex> lock(gPsfStateMutex);
-      if (gPsfAudioCachePtr && committed > 0)
-        rawBuf = gPsfAudioCachePtr->data();
-    }
-    if (!rawBuf || committed <= currentPos + 4) {
-      if (psfZeroLogCounter++ % 100 == 0)
-        LOGD("PSF underrun: committed=%zu pos=%zu", committed, currentPos);
-      written = 0;
-    } else {
-      size_t bytesAvailable = committed - currentPos;
-      size_t framesAvailable = bytesAvailable / 4;
-      jint framesToCopy =
-          (framesAvailable >= (size_t)frames) ? frames : (jint)framesAvailable;
-      if (framesToCopy > 0) {
-        // Safe: rawBuf is stable (pre-reserved), bytes are committed.
-        memcpy(dst, rawBuf + currentPos, (size_t)framesToCopy * 4);
-
-        for (jint i = 0; i < framesToCopy; i++) {
-          int16_t l = dst[i * 2];
-          int16_t r = dst[i * 2 + 1];
-          float sample = (float)l / 32768.0f + (float)r / 32768.0f;
-          gFftRingBuffer[gFftWriteIdx] = sample / 2.0f;
-          gFftWriteIdx = (gFftWriteIdx + 1) % FFT_SIZE;
-        }
-
-        gPsfPlaybackPos.store(currentPos + (size_t)framesToCopy * 4,
-                              std::memory_order_relaxed);
-        written = framesToCopy;
-      }
-    }
+    written = gSampleRate == PSF_SAMPLE_RATE ? readPsfCache(dst, frames)
+                                             : readPsfResampled(dst, frames);
   } else if (gPlayerType == PlayerType::LIBMUSDOOM && gMusDoomPlayer) {
     // libMusDoom outputs stereo interleaved 16-bit
     // musdoom_generate_samples returns number of stereo samples generated
@@ -1336,14 +2454,6 @@ JNIEXPORT jint JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nFillBuffer(
         musdoom_generate_samples(gMusDoomPlayer, dst, frames);
     if (samplesGenerated > 0) {
       written = (jint)samplesGenerated;
-
-      // Feed mono samples to FFT ring buffer
-      for (jint i = 0; i < written; i++) {
-        float sample =
-            (float)dst[i * 2] / 32768.0f + (float)dst[i * 2 + 1] / 32768.0f;
-        gFftRingBuffer[gFftWriteIdx] = sample / 2.0f;
-        gFftWriteIdx = (gFftWriteIdx + 1) % FFT_SIZE;
-      }
     } else {
       static int musdoomZeroLogCounter = 0;
       if (musdoomZeroLogCounter++ % 100 == 0) {
@@ -1355,55 +2465,304 @@ JNIEXPORT jint JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nFillBuffer(
     }
   }
 
-  // Apply bass boost and reverb processing
-  if (written > 0 && (gBassEnabled || gReverbEnabled)) {
-    for (jint i = 0; i < written; i++) {
-      float l = (float)dst[i * 2] / 32768.0f;
-      float r = (float)dst[i * 2 + 1] / 32768.0f;
+  // libvgm and libkss report their loops above
+  reportLoopPasses(startSample, written);
+  return written;
+}
+
+// Next `frames` frames of the active track before any DSP: pre-rolled audio
+// first, then the backend. Captures the loop body in endless mode.
+static jint renderBackend(jshort *dst, jint frames) {
+  jint written = 0;
+  size_t prerollFrames = gPreroll.size() / 2;
+  if (gPrerollPos < prerollFrames) {
+    written = (jint)std::min<size_t>(prerollFrames - gPrerollPos, frames);
+    memcpy(dst, gPreroll.data() + gPrerollPos * 2,
+           (size_t)written * 2 * sizeof(jshort));
+    gPrerollPos += written;
+    if (gPrerollPos >= prerollFrames) {
+      gPreroll.clear();
+      gPreroll.shrink_to_fit();
+      gPrerollPos = 0;
+    }
+    if (written == frames)
+      return written;
+  }
+
+  int64_t start = gOutputSample + written;
+  jint got = decodeBackend(dst + written * 2, frames - written, start);
 
-      // Apply bass boost (simple low-shelf boost at ~200Hz)
-      if (gBassEnabled) {
-        // Simple bass boost by amplifying low frequencies
-        // Using a simple approach: amplify by 50% for bass
-        l = l * 1.0f + l * 0.5f * (1.0f - std::abs(l));
-        r = r * 1.0f + r * 0.5f * (1.0f - std::abs(r));
-      }
+  // Capture the raw backend output before any DSP so cached passes can go
+  // through the effects like emulated ones
+  if (!gServingLoopCache && gEndlessLoopMode && loop_cache_capturing())
+    loop_cache_feed(dst + written * 2, got, start);
+  return written + got;
+}
 
-      // Apply reverb (simple delay-based reverb)
-      if (gReverbEnabled) {
-        // Read delayed samples
-        int delayPos = (gReverbWritePos - REVERB_DELAY_SAMPLES +
-                        REVERB_DELAY_SAMPLES * 2) %
-                       (REVERB_DELAY_SAMPLES * 2);
-        float delayedL = gReverbBuffer[delayPos];
-        float delayedR = gReverbBuffer[delayPos + 1];
-
-        // Mix with delayed signal (30% wet)
-        float reverbMix = 0.3f;
-        l = l + delayedL * reverbMix;
-        r = r + delayedR * reverbMix;
-
-        // Store current samples in delay buffer
-        gReverbBuffer[gReverbWritePos] = l;
-        gReverbBuffer[gReverbWritePos + 1] = r;
-        gReverbWritePos = (gReverbWritePos + 2) % (REVERB_DELAY_SAMPLES * 2);
-      }
+static double monotonicSeconds() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Before the window opens, render the incoming track's part of the crossfade
+// into its pre-roll, one buffer per buffer played. The crossfade itself then
+// only copies, so the two emulators never have to run in the same buffer.
+// Returns the seconds spent.
+static double prerenderIncoming(jint frames) {
+  double t0 = monotonicSeconds();
+  int64_t window = gXfadeEnd - gXfadeStart;
+  swapDecoder(gNextSlot);
+  int64_t have = (int64_t)(gPreroll.size() / 2) - (int64_t)gPrerollPos;
+  if (have < window) {
+    jint n = (jint)std::min<int64_t>(window - have, frames);
+    size_t used = gPreroll.size();
+    gPreroll.resize(used + (size_t)n * 2);
+    jint got = decodeBackend(gPreroll.data() + used, n, gOutputSample + have);
+    gPreroll.resize(used + (size_t)got * 2);
+  }
+  swapDecoder(gNextSlot);
+  return monotonicSeconds() - t0;
+}
+
+// Mix the incoming track under the outgoing one with equal-power gains
+// (cos/sin of the window position). `dst` holds `frames` outgoing frames
+// starting at output sample `start`, as float at full scale; the incoming
+// ones are brought to it with their own track's bus gain (makeup and
+// loudness gain). Nothing is clamped: the sum goes through the effects and
+// the limiter like any other audio. Returns the seconds spent.
+static double mixCrossfade(float *dst, jint frames, int64_t start) {
+  double t0 = monotonicSeconds();
+  int64_t xStart = gXfadeStart;
+  int64_t xEnd = gXfadeEnd;
+  jint offset = start < xStart ? (jint)(xStart - start) : 0;
+  int64_t n = std::min<int64_t>(frames - offset, xEnd - (start + offset));
+  if (n <= 0)
+    return 0.0;
+
+  static std::vector<jshort> in;
+  in.resize((size_t)n * 2);
+  swapDecoder(gNextSlot);
+  jint got = renderBackend(in.data(), (jint)n);
+  if (got > 0)
+    got = applyTrackFade(in.data(), got, gOutputSample);
+  gOutputSample += got;
+  float inScale = outputGain() / 32768.0f;
+  swapDecoder(gNextSlot);
+
+  float span = (float)(xEnd - xStart);
+  for (jint i = 0; i < (jint)n; i++) {
+    float t = (float)(start + offset + i - xStart) / span;
+    if (t > 1.0f)
+      t = 1.0f;
+    float gainOut = std::cos(t * 1.57079633f);
+    float gainIn = std::sin(t * 1.57079633f);
+    float *o = dst + (offset + i) * 2;
+    for (int c = 0; c < 2; c++) {
+      o[c] *= gainOut;
+      if (i < got)
+        o[c] += (float)in[i * 2 + c] * inScale * gainIn;
+    }
+  }
+  return monotonicSeconds() - t0;
+}
+
+// Report once per transition when driving both decoders takes more than
+// XFADE_MAX_LOAD of real time. If the window has not opened yet the
+// crossfade is dropped, leaving the normal fade and a gapless handover.
+static void trackCrossfadeLoad(double busySeconds, jint frames) {
+  float load = (float)(busySeconds * gSampleRate / frames);
+  gXfadeLoad =
+      gXfadeLoadFills == 0 ? load : gXfadeLoad * 0.8f + load * 0.2f;
+  if (++gXfadeLoadFills < XFADE_MIN_FILLS || gXfadeLoad <= XFADE_MAX_LOAD ||
+      gXfadeOverloadSent)
+    return;
+  gXfadeOverloadSent = true;
+  pushEngineEvent(ENGINE_EVENT_XFADE_OVERLOAD, (int32_t)(gXfadeLoad * 100),
+                  gOutputSample);
+  LOGE("crossfade: two decoders need %.0f%% of real time",
+       gXfadeLoad * 100.0f);
+  if (gOutputSample < gXfadeStart) {
+    gXfadeStart = -1;
+    gXfadeEnd = -1;
+  }
+}
+
+static void floatToPcm(const float *src, jshort *dst, jint frames) {
+  for (jint i = 0; i < frames * 2; i++) {
+    float v = src[i] * 32767.0f;
+    if (v > 32767.0f)
+      v = 32767.0f;
+    if (v < -32768.0f)
+      v = -32768.0f;
+    dst[i] = (jshort)v;
+  }
+}
+
+// Once the track has ended by itself, pad it with the `room` frames of
+// silence it takes to play the limiter's delay line out, over as many
+// buffers as needed; END is reported after them. A faded-out ending has
+// nothing audible left in it, and a prepared next track pushes it out
+// instead. Returns the frames written.
+static jint padLimiterTail(float *dst, jint room) {
+  if (gLimiterTail < 0) {
+    if (!isTrackEnded() || gNextArmed)
+      return 0;
+    bool fadedOut = gFadeEndSample >= 0 && gOutputSample >= gFadeEndSample;
+    gLimiterTail = fadedOut ? 0 : limiter_latency();
+  }
+  jint n = std::min<jint>(gLimiterTail, room);
+  if (n <= 0)
+    return 0;
+  std::fill(dst, dst + n * 2, 0.0f);
+  gLimiterTail -= n;
+  gOutputSample += n;
+  return n;
+}
+
+// Render, process and account `frames` frames of the active track, as float
+// at full scale up to the limiter, which runs on the output (outputStage).
+static jint fillFrames(float *dst, jint frames) {
+  static std::vector<jshort> pcm;
+  pcm.resize((size_t)frames * 2);
+  bool crossfading = gNextArmed && gXfadeStart >= 0;
+  double t0 = crossfading ? monotonicSeconds() : 0.0;
+  // Past the end only the limiter's delay line is left to play
+  jint written = gLimiterTail >= 0 ? 0 : renderBackend(pcm.data(), frames);
+  updateChannelMeters(pcm.data(), written);
+
+  if (written > 0) {
+    if (gStatusFillCount == 0) {
+      limiter_reset_stats(); // counted per song
+      output_meter_reset();
+    }
+    float scale = outputGain() / 32768.0f;
+    for (jint i = 0; i < written * 2; i++)
+      dst[i] = (float)pcm[i] * scale;
+  }
+
+  // Crossfade into the prepared track, mixed before DSP so both share the
+  // effects chain
+  if (crossfading) {
+    double busy = monotonicSeconds() - t0;
+    if (gOutputSample + written > gXfadeStart)
+      busy += mixCrossfade(dst, written, gOutputSample);
+    else
+      busy += prerenderIncoming(frames);
+    trackCrossfadeLoad(busy, frames);
+  }
+
+  if (written > 0) {
+    eq_process(dst, written);
+    reverb_process(dst, written);
+    // Loop-count / manual fade, applied last so the effect tails fade too
+    written = applyTrackFade(dst, written, gOutputSample);
+  }
+  gOutputSample += written;
+  written += padLimiterTail(dst + written * 2, frames - written);
+
+  // Report end of stream once, at the sample where output stopped. A short
+  // render that is not the end means the backend could not keep up (PSF
+  // generation behind playback); the initial PSF fill is not counted.
+  gStatusFillCount++;
+  if (isTrackEnded()) {
+    if (!gEndEventSent && gLimiterTail <= 0) {
+      gEndEventSent = true;
+      pushEngineEvent(ENGINE_EVENT_END, 0, gOutputSample);
+    }
+  } else if (written < frames && (gPlayerType != PlayerType::LIBPSF ||
+                                  gPsfCacheReady.load(
+                                      std::memory_order_acquire))) {
+    gStatusUnderruns++;
+    pushEngineEvent(ENGINE_EVENT_UNDERRUN, frames - written, currentSample());
+  }
+  return written;
+}
+
+// `frames` frames in track time, continuing into the prepared next track if
+// the current one ends.
+static jint fillTrackTime(float *dst, jint frames) {
+  jint written = fillFrames(dst, frames);
+
+  // Gapless handover: the track ended inside this buffer and the next one is
+  // prepared, so continue with it at the very next sample
+  if (written < frames && gEndEventSent && gNextArmed) {
+    spliceNextDecoder();
+    written += fillFrames(dst + written * 2, frames - written);
+  }
+  return written;
+}
+
+// Slowed-down or pitched output: track-time audio is rendered only as fast
+// as the stretch consumes it. At the end of the stream the buffered rest is
+// played out unchanged.
+static jint fillStretched(float *dst, jint frames) {
+  static std::vector<float> x;
+  jint written = 0;
+  bool ended = false;
+  while (written < frames) {
+    written += timestretch_pull(dst + written * 2, frames - written);
+    if (written == frames || ended)
+      break;
+    if (!timestretch_active()) {
+      // Back at normal speed and pitch, and played out
+      written += fillTrackTime(dst + written * 2, frames - written);
+      break;
+    }
 
-      // Clamp and convert back to int16
-      if (l > 1.0f)
-        l = 1.0f;
-      if (l < -1.0f)
-        l = -1.0f;
-      if (r > 1.0f)
-        r = 1.0f;
-      if (r < -1.0f)
-        r = -1.0f;
-      dst[i * 2] = (jshort)(l * 32767.0f);
-      dst[i * 2 + 1] = (jshort)(r * 32767.0f);
+    int want = timestretch_input_wanted();
+    if (want == 0)
+      continue;
+    x.resize((size_t)want * 2);
+    jint in = fillTrackTime(x.data(), want);
+    timestretch_push(x.data(), in);
+    if (in < want) {
+      timestretch_finish();
+      ended = true;
     }
   }
+  return written;
+}
+
+// The last stage, on what is actually played: the limiter (always on, so
+// bus headroom, effect gain and the stretch can't clip), then the output
+// meters and the FFT ring the spectrum is computed from.
+static void outputStage(float *src, jshort *dst, jint frames) {
+  limiter_process(src, frames);
+  floatToPcm(src, dst, frames);
+  output_meter_feed(dst, frames);
+  for (jint i = 0; i < frames; i++) {
+    gFftRingBuffer[gFftWriteIdx] =
+        ((float)dst[i * 2] + (float)dst[i * 2 + 1]) / 65536.0f;
+    gFftWriteIdx = (gFftWriteIdx + 1) % FFT_SIZE;
+  }
+}
+
+/**
+ * Fill a short[] buffer with stereo int16 PCM samples.
+ * buffer layout: [L0, R0, L1, R1, ...]  (interleaved stereo)
+ * Returns number of sample frames written.
+ */
+JNIEXPORT jint JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nFillBuffer(
+    JNIEnv *env, jclass cls, jshortArray buffer, jint frames) {
+  if (frames <= 0)
+    return 0;
+
+  static std::vector<float> mix;
+  mix.resize((size_t)frames * 2);
+  // Whatever key change the decoder can't make itself, and the speed's in
+  // varispeed mode
+  float pitch = (float)transpose_ratio(gTranspose - gTrackTranspose);
+  if (gVarispeed)
+    pitch *= timestretch_speed();
+  timestretch_set_pitch(pitch);
+  jint written = timestretch_active() ? fillStretched(mix.data(), frames)
+                                      : fillTrackTime(mix.data(), frames);
 
+  jshort *dst = (jshort *)env->GetShortArrayElements(buffer, nullptr);
+  outputStage(mix.data(), dst, written);
   env->ReleaseShortArrayElements(buffer, dst, 0);
+  publishStatus();
 
   // Occasional logging to avoid flooding
   static int logCounter = 0;
@@ -1415,8 +2774,9 @@ JNIEXPORT jint JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nFillBuffer(
   return written;
 }
 
-JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nGetSpectrum(
-    JNIEnv *env, jclass cls, jfloatArray outMagnitudes) {
+// Hann-windowed FFT of the mono ring buffer, FFT_SIZE / 2 bins scaled so the
+// loudest bin is 255.
+static void computeSpectrum(float *dst) {
   int n = FFT_SIZE;
   std::vector<Complex> a(n);
 
@@ -1433,10 +2793,6 @@ JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nGetSpectrum(
 
   fft_process(a);
 
-  jfloat *dst = env->GetFloatArrayElements(outMagnitudes, nullptr);
-  if (!dst)
-    return;
-
   int outSize = n / 2;
   float maxMag = 0.0f;
   for (int i = 0; i < outSize; i++) {
@@ -1451,8 +2807,15 @@ JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nGetSpectrum(
       dst[i] = dst[i] * scale;
     }
   }
+}
 
-  env->ReleaseFloatArrayElements(outMagnitudes, dst, 0);
+JNIEXPORT void JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nGetSpectrum(
+    JNIEnv *env, jclass cls, jfloatArray outMagnitudes) {
+  EngineStatusBlock *blk = engine_status_block();
+  if (!blk)
+    return;
+  env->SetFloatArrayRegion(outMagnitudes, 0, STATUS_SPECTRUM_BINS,
+                           blk->spectrum);
 }
 
 static void compute_channel_spectrum(int16_t wave[512], int wave_idx,
@@ -1484,11 +2847,12 @@ static void compute_channel_spectrum(int16_t wave[512], int wave_idx,
   }
 }
 
-JNIEXPORT jfloatArray JNICALL
-Java_org_vlessert_vgmp_engine_VgmEngine_nGetChannelSpectrums(JNIEnv *env,
-                                                             jclass cls) {
-  if (gPlayerType != PlayerType::LIBKSS || !gKssPlay || !gKss)
-    return nullptr;
+// 16-band spectrum per KSS channel in the same order as nGetChannelName.
+// Returns the number of floats written (0 for other backends).
+static int computeChannelSpectrums(float *levels, int maxFloats) {
+  if (gPlayerType != PlayerType::LIBKSS || !gKssPlay || !gKss ||
+      gServingLoopCache)
+    return 0;
 
   int totalChannels = 0;
   if (!gKssPlay->device_mute[KSS_DEVICE_PSG])
@@ -1501,11 +2865,9 @@ Java_org_vlessert_vgmp_engine_VgmEngine_nGetChannelSpectrums(JNIEnv *env,
     totalChannels += 15;
 
   const int BANDS_PER_CH = 16;
-  jfloatArray result = env->NewFloatArray(totalChannels * BANDS_PER_CH);
-  if (!result)
-    return nullptr;
+  if (totalChannels * BANDS_PER_CH > maxFloats)
+    return 0;
 
-  float *levels = env->GetFloatArrayElements(result, nullptr);
   int idx = 0;
   auto &wave = gKssPlay->ch_wave;
   int w_idx = wave.wave_idx;
@@ -1541,11 +2903,160 @@ Java_org_vlessert_vgmp_engine_VgmEngine_nGetChannelSpectrums(JNIEnv *env,
                                &levels[idx++ * BANDS_PER_CH]);
     }
   }
+  return totalChannels * BANDS_PER_CH;
+}
+
+JNIEXPORT jfloatArray JNICALL
+Java_org_vlessert_vgmp_engine_VgmEngine_nGetChannelSpectrums(JNIEnv *env,
+                                                             jclass cls) {
+  EngineStatusBlock *blk = engine_status_block();
+  if (!blk || blk->channelSpectrumLen == 0)
+    return nullptr;
+  jfloatArray result = env->NewFloatArray(blk->channelSpectrumLen);
+  if (!result)
+    return nullptr;
+  env->SetFloatArrayRegion(result, 0, blk->channelSpectrumLen,
+                           blk->channelSpectrum);
+  return result;
+}
+
+// Refresh the shared status block from the current engine state. Called on
+// the JNI thread after every render and after open/seek/close.
+static void publishStatus() {
+  EngineStatusBlock *blk = engine_status_block();
+  if (!blk || gOpeningNext)
+    return;
+
+  bool loaded = gPlayerType != PlayerType::NONE;
+  uint32_t flags = 0;
+  if (loaded) {
+    flags |= STATUS_FLAG_LOADED;
+    if (isTrackEnded())
+      flags |= STATUS_FLAG_ENDED;
+    if (gPlayerType != PlayerType::LIBPSF ||
+        gPsfCacheReady.load(std::memory_order_acquire))
+      flags |= STATUS_FLAG_PSF_READY;
+    if (gPlayerType == PlayerType::LIBPSF &&
+        (flags & STATUS_FLAG_PSF_READY) && !gPsfReadySent) {
+      gPsfReadySent = true;
+      pushEngineEvent(ENGINE_EVENT_PSF_READY, 0, currentSample());
+    }
+  }
+  jlong cur = loaded ? currentSample() : 0;
+  jlong total = loaded ? totalSamples() : 0;
+  double now = monotonicSeconds();
+  if (gSpectrumTime < 0.0 || now - gSpectrumTime >= SPECTRUM_INTERVAL_S) {
+    gSpectrumTime = now;
+    computeSpectrum(gSpectrum);
+    gChannelSpectrumLen =
+        computeChannelSpectrums(gChannelSpectrum, STATUS_MAX_CHANNEL_SPECTRUM);
+  }
+
+  engine_status_begin_write(blk);
+  blk->flags = flags;
+  blk->currentSample = cur;
+  blk->totalSamples = total;
+  blk->sampleRate = (int32_t)gSampleRate;
+  blk->playerType = (int32_t)gPlayerType;
+  blk->underruns = gStatusUnderruns;
+  blk->fillCount = gStatusFillCount;
+  memcpy(blk->spectrum, gSpectrum, sizeof(gSpectrum));
+  memcpy(blk->channelSpectrum, gChannelSpectrum,
+         gChannelSpectrumLen * sizeof(float));
+  blk->channelSpectrumLen = gChannelSpectrumLen;
+  blk->levelCount = channel_meters_snapshot(blk->levels, STATUS_MAX_LEVELS);
+  LimiterStats lim;
+  limiter_get_stats(&lim);
+  blk->limiterReductionDb = lim.reductionDb;
+  blk->limiterMaxReductionDb = lim.maxReductionDb;
+  blk->limiterEngagements = lim.engagements;
+  blk->limiterFrames = lim.frames;
+  blk->limiterLimitedFrames = lim.limitedFrames;
+  OutputMeterValues meter;
+  output_meter_get(&meter);
+  blk->momentaryLufs = meter.momentaryLufs;
+  blk->shortTermLufs = meter.shortTermLufs;
+  blk->integratedLufs = meter.integratedLufs;
+  blk->truePeakDb = meter.truePeakDb;
+  blk->maxTruePeakDb = meter.maxTruePeakDb;
+  blk->correlation = meter.correlation;
+  engine_status_end_write(blk);
+}
+
+/**
+ * Per-channel levels for every backend, packed as [peak0, rms0, peak1, rms1,
+ * ...] in 0..1, as of the last rendered buffer (same data as the status block).
+ * Returns null when no track is loaded.
+ */
+JNIEXPORT jfloatArray JNICALL
+Java_org_vlessert_vgmp_engine_VgmEngine_nGetChannelLevels(JNIEnv *env,
+                                                          jclass cls) {
+  EngineStatusBlock *blk = engine_status_block();
+  if (!blk || channel_meters_count() == 0)
+    return nullptr;
+
+  int n = blk->levelCount;
+  jfloatArray result = env->NewFloatArray(n);
+  if (!result)
+    return nullptr;
+  env->SetFloatArrayRegion(result, 0, n, blk->levels);
+  return result;
+}
 
-  env->ReleaseFloatArrayElements(result, levels, 0);
+// Labels matching the channel order of nGetChannelLevels
+JNIEXPORT jobjectArray JNICALL
+Java_org_vlessert_vgmp_engine_VgmEngine_nGetChannelLevelLabels(JNIEnv *env,
+                                                               jclass cls) {
+  int count = channel_meters_count();
+  jclass stringClass = env->FindClass("java/lang/String");
+  jobjectArray result = env->NewObjectArray(count, stringClass, nullptr);
+  if (!result)
+    return nullptr;
+  for (int i = 0; i < count; i++) {
+    env->SetObjectArrayElement(
+        result, i, env->NewStringUTF(channel_meters_label(i).c_str()));
+  }
   return result;
 }
 
+/**
+ * Direct ByteBuffer over the native status block (layout in engine_status.h,
+ * mirrored by EngineStatus.kt). The buffer stays valid for the lifetime of
+ * the process, so Kotlin fetches it once and then reads it without JNI calls.
+ */
+JNIEXPORT jobject JNICALL
+Java_org_vlessert_vgmp_engine_VgmEngine_nGetStatusBuffer(JNIEnv *env,
+                                                         jclass cls) {
+  EngineStatusBlock *blk = engine_status_block();
+  if (!blk)
+    return nullptr;
+  return env->NewDirectByteBuffer(blk, (jlong)sizeof(EngineStatusBlock));
+}
+
+/**
+ * Ordered loads of the seqlock and event ring indices, for devices where
+ * Kotlin has no load fence (before API 33). The fence keeps the reader's
+ * earlier loads ahead of this one, the acquire its later loads behind it.
+ */
+JNIEXPORT jint JNICALL
+Java_org_vlessert_vgmp_engine_VgmEngine_nStatusSeq(JNIEnv *env, jclass cls) {
+  EngineStatusBlock *blk = engine_status_block();
+  if (!blk)
+    return 0;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return (jint)blk->seq.load(std::memory_order_acquire);
+}
+
+JNIEXPORT jint JNICALL
+Java_org_vlessert_vgmp_engine_VgmEngine_nStatusEventWriteIdx(JNIEnv *env,
+                                                             jclass cls) {
+  EngineStatusBlock *blk = engine_status_block();
+  if (!blk)
+    return 0;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return (jint)blk->eventWriteIdx.load(std::memory_order_acquire);
+}
+
 /**
  * Convert UTF-16LE to UTF-8.
  * Simple implementation for Android where iconv is not available.
@@ -1993,7 +3504,7 @@ Java_org_vlessert_vgmp_engine_VgmEngine_nGetTrackLengthDirect(JNIEnv *env,
   // Check if this is a libgme format
   if (isGmeFormat(path)) {
     Music_Emu *tempEmu;
-    gme_err_t err = gme_open_file(path, &tempEmu, gSampleRate);
+    gme_err_t err = openGme(path, &tempEmu, gSampleRate);
     env->ReleaseStringUTFChars(jpath, path);
 
     if (err || !tempEmu) {
@@ -2032,32 +3543,7 @@ Java_org_vlessert_vgmp_engine_VgmEngine_nGetTrackLengthDirect(JNIEnv *env,
 
   // Check if this is a KSS format
   if (isKssFormat(path)) {
-    // Read the entire file into memory for libkss
-    FILE *f = fopen(path, "rb");
-
-    if (!f) {
-      env->ReleaseStringUTFChars(jpath, path);
-      return 0;
-    }
-
-    fseek(f, 0, SEEK_END);
-    long fileSize = ftell(f);
-    fseek(f, 0, SEEK_SET);
-
-    std::vector<uint8_t> fileData(fileSize);
-    if (fread(fileData.data(), 1, fileSize, f) != (size_t)fileSize) {
-      fclose(f);
-      env->ReleaseStringUTFChars(jpath, path);
-      return 0;
-    }
-    fclose(f);
-
-    // Get filename for KSS_bin2kss
-    const char *filename = strrchr(path, '/');
-    filename = filename ? filename + 1 : path;
-
-    // Create KSS object
-    KSS *tempKss = KSS_bin2kss(fileData.data(), fileSize, filename);
+    KSS *tempKss = loadKss(path);
     if (!tempKss) {
       env->ReleaseStringUTFChars(jpath, path);
       return 0;
@@ -2083,60 +3569,10 @@ Java_org_vlessert_vgmp_engine_VgmEngine_nGetTrackLengthDirect(JNIEnv *env,
     return duration;
   }
 
-  // Check if this is a MUS format — convert to MIDI in memory, then query
-  // adl_totalTimeLength() which parses MIDI tempo events without rendering
-  // any audio, so this is fast enough to call once per track during import.
-  if (isMusFormat(path)) {
-    FILE *f = fopen(path, "rb");
-    env->ReleaseStringUTFChars(jpath, path);
-    if (!f)
-      return (jlong)180 * gSampleRate;
-
-    fseek(f, 0, SEEK_END);
-    long fileSize = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    std::vector<uint8_t> musData(fileSize);
-    if (fread(musData.data(), 1, fileSize, f) != (size_t)fileSize) {
-      fclose(f);
-      return (jlong)180 * gSampleRate;
-    }
-    fclose(f);
-
-    MEMFILE *musIn = mem_fopen_read(musData.data(), musData.size());
-    MEMFILE *midiOut = mem_fopen_write();
-    bool convertError = mus2mid(musIn, midiOut);
-
-    void *midiBuf = nullptr;
-    size_t midiSize = 0;
-    if (!convertError)
-      mem_get_buf(midiOut, &midiBuf, &midiSize);
-    mem_fclose(musIn);
-    mem_fclose(midiOut);
-
-    if (convertError || !midiBuf || midiSize == 0)
-      return (jlong)180 * gSampleRate;
-
-    ADL_MIDIPlayer *tempPlayer = adl_init(gSampleRate);
-    if (!tempPlayer)
-      return (jlong)180 * gSampleRate;
-
-    adl_setBank(tempPlayer, 14); // DMX bank — same as nOpen()
-    int res = adl_openData(tempPlayer, midiBuf, (unsigned long)midiSize);
-    if (res != 0) {
-      adl_close(tempPlayer);
-      return (jlong)180 * gSampleRate;
-    }
-
-    double totalSeconds = adl_totalTimeLength(tempPlayer);
-    adl_close(tempPlayer);
-
-    if (totalSeconds > 0)
-      return (jlong)(totalSeconds * gSampleRate);
-    return (jlong)180 * gSampleRate;
-  }
-
-  // Check if this is a MIDI format
-  if (isMidiFormat(path)) {
+  // MIDI, and MUS converted to MIDI in memory: adl_totalTimeLength() parses
+  // the tempo events without rendering any audio, so this is fast enough to
+  // call once per track during import.
+  if (isMusFormat(path) || isMidiFormat(path)) {
     ADL_MIDIPlayer *tempPlayer = adl_init(gSampleRate);
 
     if (!tempPlayer) {
@@ -2147,8 +3583,7 @@ Java_org_vlessert_vgmp_engine_VgmEngine_nGetTrackLengthDirect(JNIEnv *env,
     // Set DMX Bobby Prince v2 bank (bank 14) for Doom MIDI files
     adl_setBank(tempPlayer, 14);
 
-    // Open the MIDI file
-    if (adl_openFile(tempPlayer, path) != 0) {
+    if (openAdlPath(tempPlayer, path) != 0) {
       adl_close(tempPlayer);
       env->ReleaseStringUTFChars(jpath, path);
       return (jlong)180 * gSampleRate; // Default 3 minutes
@@ -2179,13 +3614,13 @@ Java_org_vlessert_vgmp_engine_VgmEngine_nGetTrackLengthDirect(JNIEnv *env,
   }
 
   // Use libvgm for VGM/VGZ - VGM files have accurate length from GD3 tags
-  DATA_LOADER *locLoader = FileLoader_Init(path);
+  DATA_LOADER *locLoader = mapped_file_loader(path);
   env->ReleaseStringUTFChars(jpath, path);
 
   if (!locLoader)
     return 0;
-  if (DataLoader_Load(locLoader)) {
-    DataLoader_Deinit(locLoader);
+  if (mapped_file_loader_load(locLoader)) {
+    mapped_file_loader_free(locLoader);
     return 0;
   }
 
@@ -2193,7 +3628,7 @@ Java_org_vlessert_vgmp_engine_VgmEngine_nGetTrackLengthDirect(JNIEnv *env,
   locPlayer->SetSampleRate(gSampleRate);
   if (locPlayer->LoadFile(locLoader)) {
     delete locPlayer;
-    DataLoader_Deinit(locLoader);
+    mapped_file_loader_free(locLoader);
     return 0;
   }
 
@@ -2202,7 +3637,7 @@ Java_org_vlessert_vgmp_engine_VgmEngine_nGetTrackLengthDirect(JNIEnv *env,
 
   locPlayer->UnloadFile();
   delete locPlayer;
-  DataLoader_Deinit(locLoader);
+  mapped_file_loader_free(locLoader);
   return length;
 }
 
@@ -2816,6 +4251,12 @@ JNIEXPORT jboolean JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSetTrack(
                            1); // disable silence-based end detection
       }
 
+      resetEndState();
+      gOutputSample = 0;
+      gKssLastLoopCount = 0;
+      loop_cache_reset();
+      planTrackEnd();
+      publishStatus();
       return JNI_TRUE;
     }
   }
@@ -2828,7 +4269,14 @@ JNIEXPORT jboolean JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSetTrack(
     if (actualTrack >= gKss->trk_min && actualTrack <= gKss->trk_max) {
       KSSPLAY_reset(gKssPlay, actualTrack, 0);
       gKssTrackIndex = actualTrack;
+      gKssRenderedFrames = 0;
       LOGD("nSetTrack: KSS track set to %d", actualTrack);
+      resetEndState();
+      gOutputSample = 0;
+      gKssLastLoopCount = 0;
+      loop_cache_reset();
+      planTrackEnd();
+      publishStatus();
       return JNI_TRUE;
     }
     LOGE("nSetTrack: KSS track %d out of range", actualTrack);
@@ -2836,6 +4284,61 @@ JNIEXPORT jboolean JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nSetTrack(
   return JNI_FALSE;
 }
 
+/**
+ * Open the track that follows the current one as a second decoder and
+ * pre-roll its first frames, so nFillBuffer can switch to it at the exact
+ * sample the current track ends. subTrack < 0 keeps the file's default
+ * track; gainDb is its loudness gain (see nSetTrackGain). Returns false
+ * (nothing prepared) for PSF, in endless mode, or if the file fails to open;
+ * the caller then falls back to a normal open.
+ */
+JNIEXPORT jboolean JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nPrepareNext(
+    JNIEnv *env, jclass cls, jstring jpath, jint subTrack, jfloat gainDb) {
+  discardNextDecoder();
+  if (gEndlessLoopMode || gPlayerType == PlayerType::NONE ||
+      gPlayerType == PlayerType::LIBPSF)
+    return JNI_FALSE;
+
+  const char *path = env->GetStringUTFChars(jpath, nullptr);
+  bool psf = isPsfFormat(path);
+  env->ReleaseStringUTFChars(jpath, path);
+  if (psf)
+    return JNI_FALSE;
+
+  // Park the playing track; the globals are empty while the next one opens
+  DecoderSlot current;
+  swapDecoder(current);
+
+  gOpeningNext = true;
+  bool ok = Java_org_vlessert_vgmp_engine_VgmEngine_nOpen(env, cls, jpath) ==
+            JNI_TRUE;
+  if (ok && subTrack >= 0)
+    ok = Java_org_vlessert_vgmp_engine_VgmEngine_nSetTrack(env, cls,
+                                                           subTrack) ==
+         JNI_TRUE;
+  if (ok) {
+    // Pay for the first render (chip reset, file parsing on first Render())
+    // now rather than at the track boundary
+    std::vector<jshort> preroll(NEXT_PREROLL_FRAMES * 2);
+    jint got = renderBackend(preroll.data(), NEXT_PREROLL_FRAMES);
+    preroll.resize((size_t)got * 2);
+    gPreroll.swap(preroll);
+    gPrerollPos = 0;
+    gTrackGain = dbToTrackGain(gainDb);
+    swapDecoder(gNextSlot);
+  } else {
+    cleanup();
+  }
+  gOpeningNext = false;
+
+  swapDecoder(current);
+  gNextArmed = ok;
+  planCrossfade();
+  publishStatus();
+  LOGD("nPrepareNext: %s", ok ? "armed" : "failed");
+  return ok ? JNI_TRUE : JNI_FALSE;
+}
+
 // libgme-specific: get current track index
 JNIEXPORT jint JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nGetCurrentTrack(
     JNIEnv *env, jclass cls) {
@@ -2865,7 +4368,7 @@ JNIEXPORT jlong JNICALL Java_org_vlessert_vgmp_engine_VgmEngine_nGetTrackLength(
   // Check if this is a libgme format
   if (isGmeFormat(path)) {
     Music_Emu *tempEmu;
-    gme_err_t err = gme_open_file(path, &tempEmu, gSampleRate);
+    gme_err_t err = openGme(path, &tempEmu, gSampleRate);
     env->ReleaseStringUTFChars(jpath, path);
 
     if (err || !tempEmu) {
@@ -2925,30 +4428,10 @@ Java_org_vlessert_vgmp_engine_VgmEngine_nGetKssTrackCountDirect(JNIEnv *env,
     return 1; // Not a KSS file, return 1 track
   }
 
-  // Get filename for KSS_bin2kss
-  const char *filename = strrchr(path, '/');
-  filename = filename ? filename + 1 : path;
-
-  // Read file into memory
-  FILE *f = fopen(path, "rb");
-  env->ReleaseStringUTFChars(jpath, path);
-
-  if (!f) {
-    LOGE("Failed to open KSS file for track count");
-    return 1;
-  }
-
-  fseek(f, 0, SEEK_END);
-  long fileSize = ftell(f);
-  fseek(f, 0, SEEK_SET);
-
-  std::vector<uint8_t> fileData(fileSize);
-  fread(fileData.data(), 1, fileSize, f);
-  fclose(f);
-
   // Create temporary KSS object using KSS_bin2kss which properly parses
   // headers
-  KSS *kss = KSS_bin2kss(fileData.data(), fileSize, filename);
+  KSS *kss = loadKss(path);
+  env->ReleaseStringUTFChars(jpath, path);
   if (!kss) {
     LOGE("Failed to create KSS object for track count");
     return 1;
@@ -2986,29 +4469,10 @@ Java_org_vlessert_vgmp_engine_VgmEngine_nGetKssTrackRange(JNIEnv *env,
     return result;
   }
 
-  // Get filename for KSS_bin2kss
-  const char *filename = strrchr(path, '/');
-  filename = filename ? filename + 1 : path;
-
-  // Read file into memory
-  FILE *f = fopen(path, "rb");
-  env->ReleaseStringUTFChars(jpath, path);
-
-  if (!f) {
-    return result;
-  }
-
-  fseek(f, 0, SEEK_END);
-  long fileSize = ftell(f);
-  fseek(f, 0, SEEK_SET);
-
-  std::vector<uint8_t> fileData(fileSize);
-  fread(fileData.data(), 1, fileSize, f);
-  fclose(f);
-
   // Create temporary KSS object using KSS_bin2kss which properly parses
   // headers
-  KSS *kss = KSS_bin2kss(fileData.data(), fileSize, filename);
+  KSS *kss = loadKss(path);
+  env->ReleaseStringUTFChars(jpath, path);
   if (!kss) {
     return result;
   }
@@ -3021,4 +4485,241 @@ Java_org_vlessert_vgmp_engine_VgmEngine_nGetKssTrackRange(JNIEnv *env,
   return result;
 }
 
+
+// ---------------------------------------------------------------------------
+// Offline loudness analysis
+//
+// Renders a track with its own decoder instance instead of the engine's
+// globals, so any number of analyses can run on worker threads alongside
+// playback. PSF (one global emulator) and MUS are not analysed. Looping
+// tracks are measured over one pass of the file, capped at
+// ANALYSIS_MAX_SECONDS.
+// ---------------------------------------------------------------------------
+
+#define ANALYSIS_MAX_SECONDS 300
+#define ANALYSIS_CHUNK 4096
+
+static void feedPcm16(LoudnessMeter *m, const jshort *pcm, int frames) {
+  float buf[ANALYSIS_CHUNK * 2];
+  for (int i = 0; i < frames * 2; i++)
+    buf[i] = (float)pcm[i] / 32768.0f;
+  loudness_feed(m, buf, frames);
+}
+
+static int64_t analyzeVgm(const char *path, int rate, int64_t maxFrames,
+                          LoudnessMeter *m) {
+  DATA_LOADER *loader = mapped_file_loader(path);
+  if (!loader)
+    return -1;
+  if (mapped_file_loader_load(loader)) {
+    mapped_file_loader_free(loader);
+    return -1;
+  }
+  VGMPlayer *player = new VGMPlayer();
+  player->SetSampleRate(rate);
+  player->SetFileReqCallback(RequestFileCallback, nullptr);
+  VGM_PLAY_OPTIONS opts;
+  memset(&opts, 0, sizeof(opts));
+  player->SetPlayerOptions(opts);
+  if (player->LoadFile(loader)) {
+    delete player;
+    mapped_file_loader_free(loader);
+    return -1;
+  }
+  player->Start();
+
+  // One pass through the file: intro plus a single loop
+  int64_t total = player->Tick2Sample(player->GetTotalTicks());
+  if (total <= 0 || total > maxFrames)
+    total = maxFrames;
+
+  static thread_local WAVE_32BS wave[ANALYSIS_CHUNK];
+  float buf[ANALYSIS_CHUNK * 2];
+  int64_t done = 0;
+  while (done < total && !(player->GetState() & PLAYSTATE_END)) {
+    UINT32 n = (UINT32)std::min<int64_t>(ANALYSIS_CHUNK, total - done);
+    memset(wave, 0, n * sizeof(WAVE_32BS));
+    UINT32 got = player->Render(n, wave);
+    if (got == 0)
+      break;
+    // Unclipped: overs count towards the true peak
+    for (UINT32 i = 0; i < got; i++) {
+      buf[i * 2] = (float)wave[i].L / (256.0f * 32768.0f);
+      buf[i * 2 + 1] = (float)wave[i].R / (256.0f * 32768.0f);
+    }
+    loudness_feed(m, buf, (int)got);
+    done += got;
+  }
+
+  player->Stop();
+  player->UnloadFile();
+  delete player;
+  mapped_file_loader_free(loader);
+  return done;
+}
+
+static int64_t analyzeGme(const char *path, int subTrack, int rate,
+                          int64_t maxFrames, LoudnessMeter *m) {
+  Music_Emu *emu = nullptr;
+  if (openGme(path, &emu, rate))
+    return -1;
+  int track = subTrack >= 0 ? subTrack : 0;
+  if (gme_start_track(emu, track)) {
+    gme_delete(emu);
+    return -1;
+  }
+  int64_t total = maxFrames;
+  gme_info_t *info = nullptr;
+  if (gme_track_info(emu, &info, track) == 0) {
+    long ms = info->length > 0 ? info->length : info->play_length;
+    if (ms > 0)
+      total = std::min<int64_t>(total, (int64_t)ms * rate / 1000);
+    gme_free_info(info);
+  }
+
+  jshort pcm[ANALYSIS_CHUNK * 2];
+  int64_t done = 0;
+  while (done < total && !gme_track_ended(emu)) {
+    int n = (int)std::min<int64_t>(ANALYSIS_CHUNK, total - done);
+    if (gme_play(emu, n * 2, pcm))
+      break;
+    feedPcm16(m, pcm, n);
+    done += n;
+  }
+  gme_delete(emu);
+  return done;
+}
+
+static int64_t analyzeKss(const char *path, int subTrack, int rate,
+                          int64_t maxFrames, LoudnessMeter *m) {
+  KSS *kss = loadKss(path);
+  if (!kss)
+    return -1;
+  KSSPLAY *play = KSSPLAY_new(rate, 2, 16);
+  if (!play) {
+    KSS_delete(kss);
+    return -1;
+  }
+  KSSPLAY_set_data(play, kss);
+  KSSPLAY_reset(play, subTrack >= 0 ? subTrack : kss->trk_min, 0);
+
+  // No length information: stop at the first detected loop
+  jshort pcm[ANALYSIS_CHUNK * 2];
+  int64_t done = 0;
+  while (done < maxFrames && !KSSPLAY_get_stop_flag(play) &&
+         KSSPLAY_get_loop_count(play) < 1) {
+    int n = (int)std::min<int64_t>(ANALYSIS_CHUNK, maxFrames - done);
+    KSSPLAY_calc(play, pcm, n);
+    feedPcm16(m, pcm, n);
+    done += n;
+  }
+  KSSPLAY_delete(play);
+  KSS_delete(kss);
+  return done;
+}
+
+static int64_t analyzeOpenmpt(const char *path, int rate, int64_t maxFrames,
+                              LoudnessMeter *m) {
+  MappedFile file;
+  if (!mapped_file_open(&file, path, MAPPED_FILE_SEQUENTIAL))
+    return -1;
+  openmpt_module *mod = openmpt_module_create_from_memory2(
+      file.data, file.size, openmpt_log_func_silent, nullptr,
+      openmpt_error_func_ignore, nullptr, nullptr, nullptr, nullptr);
+  mapped_file_close(&file);
+  if (!mod)
+    return -1;
+
+  jshort pcm[ANALYSIS_CHUNK * 2];
+  int64_t done = 0;
+  while (done < maxFrames) {
+    int n = (int)std::min<int64_t>(ANALYSIS_CHUNK, maxFrames - done);
+    int got = (int)openmpt_module_read_interleaved_stereo(mod, rate, n, pcm);
+    if (got <= 0)
+      break;
+    feedPcm16(m, pcm, got);
+    done += got;
+  }
+  openmpt_module_destroy(mod);
+  return done;
+}
+
+static int64_t analyzeMidi(const char *path, int rate, int64_t maxFrames,
+                           LoudnessMeter *m) {
+  ADL_MIDIPlayer *adl = adl_init(rate);
+  if (!adl)
+    return -1;
+  // Same synth setup as playback
+  adl_setNumChips(adl, 2);
+  adl_setBank(adl, 14);
+  adl_setSoftPanEnabled(adl, 1);
+  if (openAdlPath(adl, path) != 0) {
+    adl_close(adl);
+    return -1;
+  }
+
+  jshort pcm[ANALYSIS_CHUNK * 2];
+  int64_t done = 0;
+  while (done < maxFrames && !adl_atEnd(adl)) {
+    int n = (int)std::min<int64_t>(ANALYSIS_CHUNK, maxFrames - done);
+    int got = adl_play(adl, n * 2, pcm) / 2;
+    if (got <= 0)
+      break;
+    feedPcm16(m, pcm, got);
+    done += got;
+  }
+  adl_close(adl);
+  return done;
+}
+
+/**
+ * Measure integrated loudness and true peak of a track offline, faster than
+ * real time. Thread-safe and independent of the playing track: call it from
+ * worker threads without the engine lock. Returns [integrated LUFS, true
+ * peak dBTP, seconds analysed], or null if the format is not supported or
+ * the file can't be rendered.
+ */
+JNIEXPORT jfloatArray JNICALL
+Java_org_vlessert_vgmp_engine_VgmEngine_nAnalyzeLoudness(JNIEnv *env,
+                                                         jclass cls,
+                                                         jstring jpath,
+                                                         jint subTrack) {
+  const char *path = env->GetStringUTFChars(jpath, nullptr);
+  int rate = (int)gSampleRate;
+  int64_t maxFrames = (int64_t)ANALYSIS_MAX_SECONDS * rate;
+
+  std::unique_ptr<LoudnessMeter> meter(new LoudnessMeter());
+  loudness_init(meter.get(), rate);
+
+  int64_t frames = -1;
+  if (isPsfFormat(path))
+    frames = -1;
+  else if (isGmeFormat(path))
+    frames = analyzeGme(path, subTrack, rate, maxFrames, meter.get());
+  else if (isKssFormat(path))
+    frames = analyzeKss(path, subTrack, rate, maxFrames, meter.get());
+  else if (isOpenmptFormat(path))
+    frames = analyzeOpenmpt(path, rate, maxFrames, meter.get());
+  else if (isMidiFormat(path) || isMusFormat(path))
+    frames = analyzeMidi(path, rate, maxFrames, meter.get());
+  else
+    frames = analyzeVgm(path, rate, maxFrames, meter.get());
+
+  LOGD("nAnalyzeLoudness: %s -> %.1f LUFS, %.1f dBTP over %.1f s", path,
+       loudness_integrated(meter.get()), loudness_true_peak_db(meter.get()),
+       frames > 0 ? (double)frames / rate : 0.0);
+  env->ReleaseStringUTFChars(jpath, path);
+  if (frames <= 0)
+    return nullptr;
+
+  jfloatArray result = env->NewFloatArray(3);
+  if (!result)
+    return nullptr;
+  float values[3] = {loudness_integrated(meter.get()),
+                     loudness_true_peak_db(meter.get()),
+                     (float)frames / rate};
+  env->SetFloatArrayRegion(result, 0, 3, values);
+  return result;
+}
+
 } // extern "C"
@@ -0,0 +1,172 @@
+/*
+ * vgz_cache.cpp
+ *
+ * Entries are files named "<crc32>-<isize>-<compressed size>.vgm" in the
+ * cache directory; files being written are named VGZ_CACHE_TMP_PREFIX
+ * followed by a mkstemp suffix and don't count towards the cap. Leftovers
+ * of a process killed mid-write are deleted when the directory is first
+ * set.
+ */
+
+#include "vgz_cache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include <android/log.h>
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, "VgmJNI", __VA_ARGS__)
+
+#define VGZ_CACHE_TMP_PREFIX ".tmp-"
+
+static std::mutex gLock;
+static std::string gDir;
+static uint64_t gMaxBytes = 0;
+
+// The entry name of the gzip data `gz`, from its trailer; false if `gz`
+// isn't gzip data.
+static bool entryName(const MappedFile *gz, std::string *name,
+                      uint32_t *length) {
+  const uint8_t *d = gz->data;
+  size_t size = gz->size;
+  if (size < 18 || d[0] != 0x1F || d[1] != 0x8B)
+    return false;
+  const uint8_t *t = d + size - 8;
+  uint32_t crc = (uint32_t)t[0] | (uint32_t)t[1] << 8 |
+                 (uint32_t)t[2] << 16 | (uint32_t)t[3] << 24;
+  *length = (uint32_t)t[4] | (uint32_t)t[5] << 8 | (uint32_t)t[6] << 16 |
+            (uint32_t)t[7] << 24;
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%08" PRIx32 "-%08" PRIx32 "-%zx.vgm", crc,
+           *length, size);
+  *name = buf;
+  return true;
+}
+
+static bool isTemporary(const char *name) {
+  return strncmp(name, VGZ_CACHE_TMP_PREFIX,
+                 sizeof(VGZ_CACHE_TMP_PREFIX) - 1) == 0;
+}
+
+struct CacheFile {
+  std::string path;
+  uint64_t size;
+  int64_t mtime;
+};
+
+// Delete the oldest entries beyond the cap, and with `temporaries` the
+// files left half-written. Called with gLock held.
+static void trim(bool temporaries) {
+  DIR *d = opendir(gDir.c_str());
+  if (!d)
+    return;
+  std::vector<CacheFile> files;
+  uint64_t total = 0;
+  while (struct dirent *e = readdir(d)) {
+    if (e->d_name[0] == '.' && !isTemporary(e->d_name))
+      continue;
+    std::string path = gDir + "/" + e->d_name;
+    if (isTemporary(e->d_name)) {
+      if (temporaries)
+        unlink(path.c_str());
+      continue;
+    }
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+      continue;
+    files.push_back({path, (uint64_t)st.st_size, (int64_t)st.st_mtime});
+    total += (uint64_t)st.st_size;
+  }
+  closedir(d);
+  if (total <= gMaxBytes)
+    return;
+
+  std::sort(files.begin(), files.end(),
+            [](const CacheFile &a, const CacheFile &b) {
+              return a.mtime < b.mtime;
+            });
+  for (const CacheFile &f : files) {
+    if (total <= gMaxBytes)
+      break;
+    if (unlink(f.path.c_str()) == 0)
+      total -= f.size;
+  }
+}
+
+void vgz_cache_set_dir(const char *dir, uint64_t maxBytes) {
+  std::lock_guard<std::mutex> lock(gLock);
+  bool first = gDir != dir;
+  gDir = dir;
+  gMaxBytes = maxBytes;
+  if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+    gDir.clear();
+    return;
+  }
+  trim(first);
+  LOGD("VGZ cache: %s, up to %" PRIu64 " bytes", dir, maxBytes);
+}
+
+bool vgz_cache_open(MappedFile *out, const MappedFile *gz) {
+  std::string name;
+  uint32_t length;
+  if (!entryName(gz, &name, &length) || length < VGZ_CACHE_MIN_BYTES)
+    return false;
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(gLock);
+    if (gDir.empty() || gMaxBytes == 0)
+      return false;
+    path = gDir + "/" + name;
+  }
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  bool ok = fstat(fd, &st) == 0 && (uint64_t)st.st_size == length &&
+            mapped_file_open_fd(out, fd, 0, length, MAPPED_FILE_SEQUENTIAL);
+  // Most recently opened; trim() goes by mtime
+  if (ok)
+    futimens(fd, nullptr);
+  close(fd);
+  return ok;
+}
+
+int vgz_cache_create(const MappedFile *gz, size_t length, std::string *tmp) {
+  std::string name;
+  uint32_t isize;
+  if (!entryName(gz, &name, &isize) || isize != length ||
+      length < VGZ_CACHE_MIN_BYTES)
+    return -1;
+  std::lock_guard<std::mutex> lock(gLock);
+  if (gDir.empty() || length > gMaxBytes)
+    return -1;
+  *tmp = gDir + "/" VGZ_CACHE_TMP_PREFIX "XXXXXX";
+  int fd = mkstemp(&(*tmp)[0]);
+  if (fd < 0)
+    tmp->clear();
+  return fd;
+}
+
+void vgz_cache_commit(const MappedFile *gz, const std::string &tmp,
+                      bool ok) {
+  std::string name;
+  uint32_t length;
+  std::lock_guard<std::mutex> lock(gLock);
+  // The cache may have been turned off or moved meanwhile
+  if (!ok || gDir.empty() || gMaxBytes == 0 ||
+      !entryName(gz, &name, &length) ||
+      tmp.compare(0, gDir.size() + 1, gDir + "/") != 0 ||
+      rename(tmp.c_str(), (gDir + "/" + name).c_str()) != 0) {
+    unlink(tmp.c_str());
+    return;
+  }
+  trim(false);
+}
@@ -0,0 +1,51 @@
+/*
+ * vgz_cache.h
+ *
+ * On-disk cache of inflated .vgz data. Every open of a .vgz (playback, the
+ * length probe, loudness analysis) used to inflate the whole file; for a
+ * VGZ with a few MB of PCM that is tens of milliseconds on a slow core,
+ * each time. With the cache, the first open inflates into a cache file and
+ * later ones map that file, so re-opening a recently played track is an
+ * mmap.
+ *
+ * An entry is named by the gzip trailer (CRC-32 and size of the inflated
+ * data) and the size of the compressed data, so it needs no stat of the
+ * source and serves assets and zip pack entries alike; copies of one file
+ * share an entry. Entries are written under a temporary name and renamed
+ * once fully inflated, which is when inflate has checked the CRC, so a
+ * present entry is complete.
+ *
+ * Only data of at least VGZ_CACHE_MIN_BYTES inflated is cached. The cache
+ * is kept within its size cap by deleting the least recently opened
+ * entries (a hit touches the entry's mtime); entries still mapped stay
+ * readable until unmapped. A cap of 0 turns the cache off and empties it.
+ *
+ * Safe to call from any thread.
+ */
+
+#ifndef VGZ_CACHE_H
+#define VGZ_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+#include "mapped_file.h"
+
+#define VGZ_CACHE_MIN_BYTES (256 << 10)
+
+// Keep the cache in `dir`, created if needed, within `maxBytes`.
+void vgz_cache_set_dir(const char *dir, uint64_t maxBytes);
+
+// Map the cached inflated data of the gzip data `gz` at `out`. False,
+// leaving `out` closed, on a miss.
+bool vgz_cache_open(MappedFile *out, const MappedFile *gz);
+
+// A new, empty read-write file for the `length` inflated bytes of `gz`,
+// named `tmp`, or -1 if they aren't to be cached. Hand `tmp` to
+// vgz_cache_commit once written; the caller closes the descriptor.
+int vgz_cache_create(const MappedFile *gz, size_t length, std::string *tmp);
+
+// Add the file `tmp` as the entry of `gz` if `ok`, else delete it.
+void vgz_cache_commit(const MappedFile *gz, const std::string &tmp, bool ok);
+
+#endif // VGZ_CACHE_H
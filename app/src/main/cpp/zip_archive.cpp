@@ -0,0 +1,436 @@
+/*
+ * zip_archive.cpp
+ *
+ * The index is built from a temporary mapping of the whole pack: the end of
+ * central directory record (zip64 if any field overflows), then every
+ * central directory entry. An entry's data starts after its local header,
+ * whose name and extra lengths may differ from the central copy, so that
+ * offset is read from the local header when the entry is first opened.
+ *
+ * Opening an entry takes the lock only to look the entry up and duplicate
+ * the pack's descriptor; mapping and inflating run unlocked.
+ *
+ * A cached inflation is a memfd; every open maps it privately, so a
+ * library scribbling on its buffer copies only the pages it touches, and
+ * an evicted memfd lives on until its last mapping is gone.
+ */
+
+#include "zip_archive.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fcntl.h>
+#include <list>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <zlib.h>
+
+#include <android/log.h>
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, "VgmJNI", __VA_ARGS__)
+
+// From linux/memfd.h, which older NDK sysroots lack
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+#define ZIP_EOCD_SIG 0x06054B50
+#define ZIP64_LOCATOR_SIG 0x07064B50
+#define ZIP64_EOCD_SIG 0x06064B50
+#define ZIP_CENTRAL_SIG 0x02014B50
+#define ZIP_LOCAL_SIG 0x04034B50
+#define ZIP_EOCD_SIZE 22
+#define ZIP_CENTRAL_SIZE 46
+#define ZIP_LOCAL_SIZE 30
+#define ZIP_MAX_COMMENT 0xFFFF
+
+#define ZIP_STORED 0
+#define ZIP_DEFLATED 8
+
+struct ZipEntry {
+  uint16_t method;
+  uint32_t crc;
+  uint64_t compSize;
+  uint64_t size;
+  uint64_t localOffset;
+  int64_t dataOffset; // -1 until the local header has been read
+};
+
+struct ZipIndex {
+  std::string path;
+  int fd;
+  int64_t fileSize; // with mtime, to notice the pack being replaced
+  int64_t mtime;
+  std::unordered_map<std::string, ZipEntry> entries;
+};
+
+struct Inflated {
+  std::string key;
+  int fd; // memfd holding the inflated entry
+  size_t size;
+};
+
+static std::mutex gLock;
+static std::list<ZipIndex> gIndexes; // most recently used first
+static std::list<Inflated> gInflated; // most recently used first
+static size_t gInflatedBytes = 0;
+
+static uint16_t le16(const uint8_t *p) { return (uint16_t)(p[0] | p[1] << 8); }
+
+static uint32_t le32(const uint8_t *p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+         (uint32_t)p[3] << 24;
+}
+
+static uint64_t le64(const uint8_t *p) {
+  return (uint64_t)le32(p) | (uint64_t)le32(p + 4) << 32;
+}
+
+static bool endsWithPack(const char *path, const char *sep) {
+  static const char *const kPackExtensions[] = {".zip", ".vgmpack"};
+  for (const char *ext : kPackExtensions) {
+    size_t n = strlen(ext);
+    if ((size_t)(sep - path) >= n && strncasecmp(sep - n, ext, n) == 0)
+      return true;
+  }
+  return false;
+}
+
+bool zip_archive_split(const char *path, std::string *zip,
+                       std::string *entry) {
+  const char *sep = path;
+  while ((sep = strstr(sep, ZIP_ENTRY_SEPARATOR)) != nullptr) {
+    // Only a pack extension right before the separator makes it a pack
+    if (endsWithPack(path, sep) && sep[2] != '\0') {
+      zip->assign(path, (size_t)(sep - path));
+      entry->assign(sep + 2);
+      return true;
+    }
+    sep += 2;
+  }
+  return false;
+}
+
+// Replace the 0xFFFF... placeholders of a central entry with the values in
+// its zip64 extra field, which appear in this order and only if needed.
+static bool readZip64Extra(const uint8_t *extra, size_t len, ZipEntry *e,
+                           bool needSize, bool needComp, bool needOffset) {
+  while (len >= 4) {
+    uint16_t id = le16(extra);
+    uint16_t n = le16(extra + 2);
+    if ((size_t)n + 4 > len)
+      return false;
+    if (id == 0x0001) {
+      const uint8_t *p = extra + 4;
+      const uint8_t *end = p + n;
+      if (needSize) {
+        if (p + 8 > end)
+          return false;
+        e->size = le64(p);
+        p += 8;
+      }
+      if (needComp) {
+        if (p + 8 > end)
+          return false;
+        e->compSize = le64(p);
+        p += 8;
+      }
+      if (needOffset) {
+        if (p + 8 > end)
+          return false;
+        e->localOffset = le64(p);
+      }
+      return true;
+    }
+    extra += 4 + n;
+    len -= 4 + n;
+  }
+  return false;
+}
+
+static bool parseCentralDirectory(const uint8_t *d, size_t size,
+                                  ZipIndex *index) {
+  if (size < ZIP_EOCD_SIZE)
+    return false;
+  size_t lowest = size - ZIP_EOCD_SIZE > ZIP_MAX_COMMENT
+                      ? size - ZIP_EOCD_SIZE - ZIP_MAX_COMMENT
+                      : 0;
+  size_t eocd = size - ZIP_EOCD_SIZE;
+  while (le32(d + eocd) != ZIP_EOCD_SIG) {
+    if (eocd == lowest)
+      return false;
+    eocd--;
+  }
+  uint64_t count = le16(d + eocd + 10);
+  uint64_t cdSize = le32(d + eocd + 12);
+  uint64_t cdOffset = le32(d + eocd + 16);
+  if (count == 0xFFFF || cdSize == 0xFFFFFFFF || cdOffset == 0xFFFFFFFF) {
+    if (eocd < 20 || le32(d + eocd - 20) != ZIP64_LOCATOR_SIG)
+      return false;
+    uint64_t at = le64(d + eocd - 20 + 8);
+    if (size < 56 || at > size - 56 || le32(d + at) != ZIP64_EOCD_SIG)
+      return false;
+    count = le64(d + at + 32);
+    cdSize = le64(d + at + 40);
+    cdOffset = le64(d + at + 48);
+  }
+  if (cdOffset > size || cdSize > size - cdOffset)
+    return false;
+
+  const uint8_t *p = d + cdOffset;
+  const uint8_t *end = p + cdSize;
+  index->entries.reserve((size_t)std::min<uint64_t>(count, 65536));
+  for (uint64_t i = 0; i < count; i++) {
+    if (end - p < ZIP_CENTRAL_SIZE || le32(p) != ZIP_CENTRAL_SIG)
+      return false;
+    uint16_t nameLen = le16(p + 28);
+    uint16_t extraLen = le16(p + 30);
+    uint16_t commentLen = le16(p + 32);
+    size_t total = (size_t)ZIP_CENTRAL_SIZE + nameLen + extraLen + commentLen;
+    if ((size_t)(end - p) < total)
+      return false;
+    ZipEntry e;
+    e.method = le16(p + 10);
+    e.crc = le32(p + 16);
+    e.compSize = le32(p + 20);
+    e.size = le32(p + 24);
+    e.localOffset = le32(p + 42);
+    e.dataOffset = -1;
+    bool needSize = e.size == 0xFFFFFFFF;
+    bool needComp = e.compSize == 0xFFFFFFFF;
+    bool needOffset = e.localOffset == 0xFFFFFFFF;
+    if ((needSize || needComp || needOffset) &&
+        !readZip64Extra(p + ZIP_CENTRAL_SIZE + nameLen, extraLen, &e,
+                        needSize, needComp, needOffset))
+      return false;
+    std::string name((const char *)p + ZIP_CENTRAL_SIZE, nameLen);
+    // Directories have no data
+    if (!name.empty() && name.back() != '/')
+      index->entries.emplace(std::move(name), e);
+    p += total;
+  }
+  return true;
+}
+
+static void dropIndex(std::list<ZipIndex>::iterator it) {
+  close(it->fd);
+  gIndexes.erase(it);
+}
+
+// The index of `path`, moved to the front, or null. Called with gLock held.
+static ZipIndex *findIndex(const char *path) {
+  struct stat st;
+  if (stat(path, &st) != 0)
+    return nullptr;
+  for (auto it = gIndexes.begin(); it != gIndexes.end(); ++it) {
+    if (it->path != path)
+      continue;
+    if (it->fileSize != (int64_t)st.st_size ||
+        it->mtime != (int64_t)st.st_mtime) {
+      dropIndex(it);
+      break;
+    }
+    gIndexes.splice(gIndexes.begin(), gIndexes, it);
+    return &gIndexes.front();
+  }
+
+  ZipIndex index;
+  index.path = path;
+  index.fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (index.fd < 0)
+    return nullptr;
+  if (fstat(index.fd, &st) != 0 || st.st_size <= 0) {
+    close(index.fd);
+    return nullptr;
+  }
+  index.fileSize = (int64_t)st.st_size;
+  index.mtime = (int64_t)st.st_mtime;
+  MappedFile whole;
+  bool ok = mapped_file_open_fd(&whole, index.fd, 0, (size_t)st.st_size,
+                                MAPPED_FILE_RANDOM) &&
+            parseCentralDirectory(whole.data, whole.size, &index);
+  mapped_file_close(&whole);
+  if (!ok) {
+    LOGE("Not a readable zip: %s", path);
+    close(index.fd);
+    return nullptr;
+  }
+
+  gIndexes.push_front(std::move(index));
+  while (gIndexes.size() > ZIP_INDEX_CACHE)
+    dropIndex(std::prev(gIndexes.end()));
+  return &gIndexes.front();
+}
+
+static bool readDataOffset(const ZipIndex *index, ZipEntry *e) {
+  if (e->dataOffset >= 0)
+    return true;
+  uint8_t h[ZIP_LOCAL_SIZE];
+  if (pread(index->fd, h, sizeof(h), (off_t)e->localOffset) != sizeof(h) ||
+      le32(h) != ZIP_LOCAL_SIG)
+    return false;
+  int64_t offset = (int64_t)e->localOffset + ZIP_LOCAL_SIZE + le16(h + 26) +
+                   le16(h + 28);
+  if (offset > index->fileSize ||
+      e->compSize > (uint64_t)(index->fileSize - offset))
+    return false;
+  e->dataOffset = offset;
+  return true;
+}
+
+// Map the cached inflation of `key` at `f`. Called with gLock held.
+static bool takeInflated(const std::string &key, MappedFile *f,
+                         MappedFileAccess access) {
+  for (auto it = gInflated.begin(); it != gInflated.end(); ++it) {
+    if (it->key != key)
+      continue;
+    gInflated.splice(gInflated.begin(), gInflated, it);
+    return mapped_file_open_fd(f, it->fd, 0, it->size, access);
+  }
+  return false;
+}
+
+// Cache the inflation of `key` in `fd`, which the cache takes over.
+static void keepInflated(const std::string &key, int fd, size_t size) {
+  std::lock_guard<std::mutex> lock(gLock);
+  for (const Inflated &c : gInflated) {
+    if (c.key == key) {
+      close(fd); // another thread got there first
+      return;
+    }
+  }
+  while (!gInflated.empty() &&
+         gInflatedBytes + size > ZIP_INFLATE_CACHE_BYTES) {
+    gInflatedBytes -= gInflated.back().size;
+    close(gInflated.back().fd);
+    gInflated.pop_back();
+  }
+  gInflated.push_front({key, fd, size});
+  gInflatedBytes += size;
+}
+
+// A memfd of `size` bytes, or -1 where there are none.
+static int openMemfd(size_t size) {
+#ifdef __NR_memfd_create
+  int fd = (int)syscall(__NR_memfd_create, "zip-entry", MFD_CLOEXEC);
+  if (fd >= 0 && ftruncate(fd, (off_t)size) != 0) {
+    close(fd);
+    fd = -1;
+  }
+  return fd;
+#else
+  return -1;
+#endif
+}
+
+// Inflate entry `e` of the pack open at `fd` into `out`, e.size bytes.
+static bool inflateInto(int fd, const ZipEntry &e, uint8_t *dst) {
+  MappedFile packed;
+  if (e.compSize == 0 ||
+      !mapped_file_open_fd(&packed, fd, e.dataOffset, (size_t)e.compSize,
+                           MAPPED_FILE_SEQUENTIAL))
+    return false;
+
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  bool ok = inflateInit2(&zs, -MAX_WBITS) == Z_OK;
+  if (ok) {
+    // zlib counts in uInt; feed and drain large entries in slices
+    uint8_t *in = packed.data, *out = dst;
+    size_t inLeft = packed.size, outLeft = (size_t)e.size;
+    int ret = Z_OK;
+    while (ret == Z_OK) {
+      uInt inChunk = (uInt)std::min<size_t>(inLeft, 1u << 30);
+      uInt outChunk = (uInt)std::min<size_t>(outLeft, 1u << 30);
+      zs.next_in = in;
+      zs.avail_in = inChunk;
+      zs.next_out = out;
+      zs.avail_out = outChunk;
+      ret = inflate(&zs, Z_NO_FLUSH);
+      in += inChunk - zs.avail_in;
+      inLeft -= inChunk - zs.avail_in;
+      out += outChunk - zs.avail_out;
+      outLeft -= outChunk - zs.avail_out;
+    }
+    ok = ret == Z_STREAM_END && outLeft == 0;
+    inflateEnd(&zs);
+  }
+  mapped_file_close(&packed);
+  return ok && crc32_z(crc32(0L, Z_NULL, 0), dst, (size_t)e.size) == e.crc;
+}
+
+// Inflate entry `e` of the pack open at `fd` and map it at `f`: through a
+// memfd kept under `key` if it fits the cache, else into private memory.
+static bool inflateEntry(int fd, const ZipEntry &e, const std::string &key,
+                         MappedFile *f, MappedFileAccess access) {
+  size_t size = (size_t)e.size;
+  int mfd = size <= ZIP_INFLATE_CACHE_BYTES ? openMemfd(size) : -1;
+  if (mfd < 0) {
+    if (!mapped_file_alloc(f, size))
+      return false;
+    if (inflateInto(fd, e, f->data))
+      return true;
+    mapped_file_close(f);
+    return false;
+  }
+
+  void *map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, mfd, 0);
+  bool ok = map != MAP_FAILED && inflateInto(fd, e, (uint8_t *)map);
+  if (map != MAP_FAILED)
+    munmap(map, size);
+  if (ok)
+    ok = mapped_file_open_fd(f, mfd, 0, size, access);
+  if (ok)
+    keepInflated(key, mfd, size);
+  else
+    close(mfd);
+  return ok;
+}
+
+bool zip_archive_open_entry(MappedFile *f, const char *zipPath,
+                            const char *entry, MappedFileAccess access) {
+  memset(f, 0, sizeof(*f));
+  ZipEntry e;
+  std::string key;
+  int fd;
+  {
+    std::lock_guard<std::mutex> lock(gLock);
+    ZipIndex *index = findIndex(zipPath);
+    if (!index)
+      return false;
+    auto it = index->entries.find(entry);
+    if (it == index->entries.end() || it->second.size == 0)
+      return false;
+    if (!readDataOffset(index, &it->second)) {
+      LOGE("Corrupt zip entry: %s in %s", entry, zipPath);
+      return false;
+    }
+    e = it->second;
+    if (e.method == ZIP_DEFLATED) {
+      key = std::string(zipPath) + ZIP_ENTRY_SEPARATOR + entry + "@" +
+            std::to_string(index->mtime);
+      if (takeInflated(key, f, access))
+        return true;
+    }
+    // Stays valid if the index is evicted meanwhile
+    fd = dup(index->fd);
+  }
+  if (fd < 0)
+    return false;
+
+  bool ok = false;
+  if (e.method == ZIP_STORED) {
+    ok = e.compSize == e.size &&
+         mapped_file_open_fd(f, fd, e.dataOffset, (size_t)e.size, access);
+  } else if (e.method == ZIP_DEFLATED) {
+    ok = inflateEntry(fd, e, key, f, access);
+  } else {
+    LOGE("Unsupported zip method %d: %s", e.method, entry);
+  }
+  close(fd);
+  return ok;
+}
@@ -0,0 +1,47 @@
+/*
+ * zip_archive.h
+ *
+ * Tracks imported from a zip pack are played from inside the pack instead
+ * of being extracted. Such a track is named by the pack's path,
+ * ZIP_ENTRY_SEPARATOR and the entry's name within the pack, e.g.
+ * ".../Sonic.zip!/01 Green Hill Zone.vgz"; mapped_file_open resolves these
+ * names, so every backend (and mapped_file_loader for libvgm) reads an
+ * entry as it would a file.
+ *
+ * The central directory of a pack is parsed once; the entry index and an
+ * open descriptor are kept for the ZIP_INDEX_CACHE most recently used
+ * packs, and dropped when the pack's size or mtime changes. A stored entry
+ * is mapped straight from the pack. A deflated one is inflated into
+ * anonymous shared memory; the most recently inflated entries, up to
+ * ZIP_INFLATE_CACHE_BYTES, are kept, so reopening a track (import probes
+ * each one for its tags and length, then playback opens it) maps the same
+ * pages again instead of inflating or copying it. Entries too large for the
+ * cache, or without memfd support, are inflated into private memory.
+ *
+ * Game packs (.vgmpack, see VgmPack.kt) are zips too, with their tracks
+ * stored page-aligned, and are named the same way.
+ *
+ * Safe to call from any thread.
+ */
+
+#ifndef ZIP_ARCHIVE_H
+#define ZIP_ARCHIVE_H
+
+#include <string>
+
+#include "mapped_file.h"
+
+#define ZIP_ENTRY_SEPARATOR "!/"
+#define ZIP_INDEX_CACHE 4
+#define ZIP_INFLATE_CACHE_BYTES (16 << 20)
+
+// Split `path` into the pack and the entry name if it names a zip entry.
+bool zip_archive_split(const char *path, std::string *zip, std::string *entry);
+
+// Map the entry `entry` of the pack at `zipPath`. False, leaving `f`
+// closed, if the pack can't be read, has no such entry, or the entry is
+// empty, corrupt, or compressed other than with deflate.
+bool zip_archive_open_entry(MappedFile *f, const char *zipPath,
+                            const char *entry, MappedFileAccess access);
+
+#endif // ZIP_ARCHIVE_H
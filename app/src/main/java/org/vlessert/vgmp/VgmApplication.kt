@@ -4,13 +4,20 @@ import android.app.Application
 import kotlinx.coroutines.CoroutineScope
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.launch
+import org.vlessert.vgmp.engine.VgmEngine
 import org.vlessert.vgmp.library.GameLibrary
+import org.vlessert.vgmp.settings.SettingsManager
+import java.io.File
 
 class VgmApplication : Application() {
     private val applicationScope = CoroutineScope(Dispatchers.IO)
     
     override fun onCreate() {
         super.onCreate()
+        // Bundled tracks are played from the APK, see GameLibrary.ASSET_PATH_PREFIX
+        VgmEngine.setAssetManager(assets)
+        VgmEngine.setScratchDir(cacheDir)
+        VgmEngine.setVgzCache(File(cacheDir, VgmEngine.VGZ_CACHE_DIR), SettingsManager.getVgzCacheBytes(this))
         GameLibrary.init(this)
         
         // Load all bundled files sequentially to avoid race conditions with VgmEngine
@@ -114,6 +121,9 @@ class VgmApplication : Application() {
                 gameName = "Doom II",
                 year = "1994"
             )
+
+            // Measure anything imported since the last run
+            GameLibrary.scheduleLoudnessAnalysis()
         }
     }
 }
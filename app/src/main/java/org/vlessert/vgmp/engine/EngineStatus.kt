@@ -0,0 +1,262 @@
+package org.vlessert.vgmp.engine
+
+import android.os.Build
+import java.lang.invoke.VarHandle
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.nio.FloatBuffer
+
+/**
+ * Lock-free reader for the native status block (see engine_status.h).
+ *
+ * The native side republishes position, end state and channel levels after every rendered
+ * buffer, and the spectra at most 30 times a second. Reading them here never waits on the
+ * engine mutex, so the render loop and the UI can poll as often as they like. Writes are
+ * guarded by a seqlock: [read] retries until it copies a snapshot that was not being written at
+ * the time. The sequence and event index are loaded with load fences from API 33, and through
+ * JNI on older devices, which have no fences.
+ *
+ * The output limiter's gain reduction is published the same way, with counters that restart
+ * for every song, and so are the output meters: momentary / short-term / integrated loudness
+ * (LUFS), true peak (dBTP) and stereo correlation of exactly what is being played.
+ *
+ * Engine events (loop point, end of stream, underrun, PSF ready, track change, crossfade
+ * overload) come through a ring in the same block and are consumed with [pollEvents]. There is a single
+ * consumer: the render loop.
+ */
+class EngineStatus(buffer: ByteBuffer) {
+
+    companion object {
+        const val MAGIC = 0x534D4756 // "VGMS"
+        const val VERSION = 4
+
+        const val SPECTRUM_BINS = 512
+        const val MAX_LEVELS = 128
+        const val MAX_CHANNEL_SPECTRUM = 1024
+
+        const val FLAG_LOADED = 0x01
+        const val FLAG_ENDED = 0x02
+        const val FLAG_PSF_READY = 0x04
+
+        // Event types, must match EngineEventType
+        // Loop points of every backend that knows them; MUS and PSF have none
+        const val EVENT_LOOP = 1
+        const val EVENT_END = 2
+        const val EVENT_UNDERRUN = 3
+        const val EVENT_PSF_READY = 4
+        const val EVENT_TRACK_CHANGED = 5
+        const val EVENT_XFADE_OVERLOAD = 6
+        private const val EVENT_CAPACITY = 64
+        private const val EVENT_SIZE = 16
+
+        // Byte offsets, must match EngineStatusBlock
+        private const val OFF_MAGIC = 0
+        private const val OFF_VERSION = 4
+        private const val OFF_SEQ = 8
+        private const val OFF_FLAGS = 12
+        private const val OFF_CURRENT_SAMPLE = 16
+        private const val OFF_TOTAL_SAMPLES = 24
+        private const val OFF_SAMPLE_RATE = 32
+        private const val OFF_PLAYER_TYPE = 36
+        private const val OFF_UNDERRUNS = 40
+        private const val OFF_FILL_COUNT = 44
+        private const val OFF_LEVEL_COUNT = 52
+        private const val OFF_CHANNEL_SPECTRUM_LEN = 56
+        private const val OFF_EVENT_WRITE_IDX = 60
+        private const val OFF_LIMITER_REDUCTION = 64
+        private const val OFF_LIMITER_MAX_REDUCTION = 68
+        private const val OFF_LIMITER_ENGAGEMENTS = 72
+        private const val OFF_LIMITER_FRAMES = 80
+        private const val OFF_LIMITER_LIMITED_FRAMES = 88
+        private const val OFF_MOMENTARY_LUFS = 96
+        private const val OFF_SHORT_TERM_LUFS = 100
+        private const val OFF_INTEGRATED_LUFS = 104
+        private const val OFF_TRUE_PEAK = 108
+        private const val OFF_MAX_TRUE_PEAK = 112
+        private const val OFF_CORRELATION = 116
+        private const val OFF_SPECTRUM = 256
+        private const val OFF_LEVELS = 2304
+        private const val OFF_CHANNEL_SPECTRUM = 2816
+        private const val OFF_EVENTS = 6912
+
+        private const val MAX_RETRIES = 64
+    }
+
+    /** Reusable copy of the block; [read] overwrites it in place. */
+    class Snapshot {
+        var flags = 0
+        var currentSample = 0L
+        var totalSamples = 0L
+        var sampleRate = 0
+        var playerType = 0
+        var underruns = 0
+        var fillCount = 0
+        val spectrum = FloatArray(SPECTRUM_BINS)
+        var levelCount = 0
+        val levels = FloatArray(MAX_LEVELS)
+        var channelSpectrumLen = 0
+        val channelSpectrum = FloatArray(MAX_CHANNEL_SPECTRUM)
+
+        // Output limiter, per song; reductions in dB (>= 0)
+        var limiterReductionDb = 0f
+        var limiterMaxReductionDb = 0f
+        var limiterEngagements = 0
+        var limiterFrames = 0L
+        var limiterLimitedFrames = 0L
+
+        // Output meters; -70 means silence (or meters disabled)
+        var momentaryLufs = -70f
+        var shortTermLufs = -70f
+        var integratedLufs = -70f  // this song
+        var truePeakDb = -70f      // last 400 ms
+        var maxTruePeakDb = -70f   // this song
+        var correlation = 0f       // +1 mono, 0 unrelated, -1 out of phase
+
+        val loaded: Boolean get() = flags and FLAG_LOADED != 0
+        val ended: Boolean get() = flags and FLAG_ENDED != 0
+        val psfReady: Boolean get() = flags and FLAG_PSF_READY != 0
+
+        fun levelsOrNull(): FloatArray? = if (levelCount > 0) levels.copyOf(levelCount) else null
+        fun channelSpectrumOrNull(): FloatArray? =
+            if (channelSpectrumLen > 0) channelSpectrum.copyOf(channelSpectrumLen) else null
+    }
+
+    private val buf: ByteBuffer = buffer.duplicate().order(ByteOrder.nativeOrder())
+
+    val isValid: Boolean =
+        buf.capacity() >= OFF_EVENTS + EVENT_CAPACITY * EVENT_SIZE &&
+            buf.getInt(OFF_MAGIC) == MAGIC && buf.getInt(OFF_VERSION) == VERSION
+
+    // Float views over the array sections, created once so reads don't allocate
+    private val spectrumView = floatView(OFF_SPECTRUM, SPECTRUM_BINS)
+    private val levelsView = floatView(OFF_LEVELS, MAX_LEVELS)
+    private val channelSpectrumView = floatView(OFF_CHANNEL_SPECTRUM, MAX_CHANNEL_SPECTRUM)
+
+    // The arrays are read here first and copied out only once the read is known consistent
+    private val spectrumScratch = FloatArray(SPECTRUM_BINS)
+    private val levelsScratch = FloatArray(MAX_LEVELS)
+    private val channelSpectrumScratch = FloatArray(MAX_CHANNEL_SPECTRUM)
+
+    /**
+     * Copy a consistent snapshot into [out]. Returns false if the writer kept the block busy
+     * for [MAX_RETRIES] attempts; [out] then keeps its previous values, arrays included.
+     */
+    fun read(out: Snapshot): Boolean {
+        if (!isValid) return false
+        repeat(MAX_RETRIES) {
+            val seq1 = loadSeq()
+            if (seq1 and 1 != 0) return@repeat
+
+            val flags = buf.getInt(OFF_FLAGS)
+            val currentSample = buf.getLong(OFF_CURRENT_SAMPLE)
+            val totalSamples = buf.getLong(OFF_TOTAL_SAMPLES)
+            val sampleRate = buf.getInt(OFF_SAMPLE_RATE)
+            val playerType = buf.getInt(OFF_PLAYER_TYPE)
+            val underruns = buf.getInt(OFF_UNDERRUNS)
+            val fillCount = buf.getInt(OFF_FILL_COUNT)
+            val levelCount = buf.getInt(OFF_LEVEL_COUNT).coerceIn(0, MAX_LEVELS)
+            val chSpecLen = buf.getInt(OFF_CHANNEL_SPECTRUM_LEN).coerceIn(0, MAX_CHANNEL_SPECTRUM)
+            val limReduction = buf.getFloat(OFF_LIMITER_REDUCTION)
+            val limMaxReduction = buf.getFloat(OFF_LIMITER_MAX_REDUCTION)
+            val limEngagements = buf.getInt(OFF_LIMITER_ENGAGEMENTS)
+            val limFrames = buf.getLong(OFF_LIMITER_FRAMES)
+            val limLimitedFrames = buf.getLong(OFF_LIMITER_LIMITED_FRAMES)
+            val momentary = buf.getFloat(OFF_MOMENTARY_LUFS)
+            val shortTerm = buf.getFloat(OFF_SHORT_TERM_LUFS)
+            val integrated = buf.getFloat(OFF_INTEGRATED_LUFS)
+            val truePeak = buf.getFloat(OFF_TRUE_PEAK)
+            val maxTruePeak = buf.getFloat(OFF_MAX_TRUE_PEAK)
+            val correlation = buf.getFloat(OFF_CORRELATION)
+            readFloats(spectrumView, spectrumScratch, SPECTRUM_BINS)
+            readFloats(levelsView, levelsScratch, levelCount)
+            readFloats(channelSpectrumView, channelSpectrumScratch, chSpecLen)
+
+            if (loadSeq() == seq1) {
+                spectrumScratch.copyInto(out.spectrum)
+                levelsScratch.copyInto(out.levels, endIndex = levelCount)
+                channelSpectrumScratch.copyInto(out.channelSpectrum, endIndex = chSpecLen)
+                out.flags = flags
+                out.currentSample = currentSample
+                out.totalSamples = totalSamples
+                out.sampleRate = sampleRate
+                out.playerType = playerType
+                out.underruns = underruns
+                out.fillCount = fillCount
+                out.levelCount = levelCount
+                out.channelSpectrumLen = chSpecLen
+                out.limiterReductionDb = limReduction
+                out.limiterMaxReductionDb = limMaxReduction
+                out.limiterEngagements = limEngagements
+                out.limiterFrames = limFrames
+                out.limiterLimitedFrames = limLimitedFrames
+                out.momentaryLufs = momentary
+                out.shortTermLufs = shortTerm
+                out.integratedLufs = integrated
+                out.truePeakDb = truePeak
+                out.maxTruePeakDb = maxTruePeak
+                out.correlation = correlation
+                return true
+            }
+        }
+        return false
+    }
+
+    private var eventReadIdx = 0
+
+    /** Drop everything queued so far, e.g. events of the previous track. */
+    fun skipEvents() {
+        if (!isValid) return
+        eventReadIdx = loadEventWriteIdx()
+    }
+
+    /**
+     * Deliver queued events in order to [handler] as (type, arg, sample). Returns the number
+     * delivered. If the reader fell more than a ring behind, the oldest events are skipped.
+     *
+     * `sample` is in track time, like [Snapshot.currentSample]: with the time stretch on it is
+     * not a count of output frames; divide by the playback speed for that.
+     */
+    fun pollEvents(handler: (type: Int, arg: Int, sample: Long) -> Unit): Int {
+        if (!isValid) return 0
+        val writeIdx = loadEventWriteIdx()
+        if (writeIdx - eventReadIdx > EVENT_CAPACITY) eventReadIdx = writeIdx - EVENT_CAPACITY
+        var delivered = 0
+        while (eventReadIdx != writeIdx) {
+            val off = OFF_EVENTS + (eventReadIdx and (EVENT_CAPACITY - 1)) * EVENT_SIZE
+            handler(buf.getInt(off), buf.getInt(off + 4), buf.getLong(off + 8))
+            eventReadIdx++
+            delivered++
+        }
+        return delivered
+    }
+
+    private fun floatView(offset: Int, count: Int): FloatBuffer {
+        val view = buf.duplicate().order(ByteOrder.nativeOrder())
+        if (view.capacity() < offset + count * 4) return FloatBuffer.allocate(count)
+        view.position(offset)
+        view.limit(offset + count * 4)
+        return view.slice().order(ByteOrder.nativeOrder()).asFloatBuffer()
+    }
+
+    private fun readFloats(view: FloatBuffer, dst: FloatArray, count: Int) {
+        view.position(0)
+        view.get(dst, 0, count)
+    }
+
+    private val hasLoadFence = Build.VERSION.SDK_INT >= Build.VERSION_CODES.TIRAMISU
+
+    // Loads of the two indices the writer publishes with release stores: earlier loads stay
+    // ahead of them and later loads behind them
+    private fun loadSeq(): Int =
+        if (hasLoadFence) orderedLoad(OFF_SEQ) else VgmEngine.nStatusSeq()
+
+    private fun loadEventWriteIdx(): Int =
+        if (hasLoadFence) orderedLoad(OFF_EVENT_WRITE_IDX) else VgmEngine.nStatusEventWriteIdx()
+
+    private fun orderedLoad(offset: Int): Int {
+        VarHandle.loadLoadFence()
+        val value = buf.getInt(offset)
+        VarHandle.loadLoadFence()
+        return value
+    }
+}
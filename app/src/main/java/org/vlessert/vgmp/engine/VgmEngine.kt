@@ -1,7 +1,12 @@
 package org.vlessert.vgmp.engine
 
+import android.content.res.AssetManager
+import kotlinx.coroutines.currentCoroutineContext
+import kotlinx.coroutines.ensureActive
 import kotlinx.coroutines.sync.Mutex
 import kotlinx.coroutines.sync.withLock
+import java.io.File
+import java.nio.ByteBuffer
 
 /**
  * Kotlin singleton wrapper around the libvgm JNI layer.
@@ -19,6 +24,14 @@ object VgmEngine {
 
     @JvmStatic external fun nSetSampleRate(rate: Int)
     @JvmStatic external fun nSetRomPath(path: String)
+    // Lets every backend open "asset:///<path>" straight from the APK; set once at startup
+    @JvmStatic external fun nSetAssetManager(assets: AssetManager)
+    // Where large .vgz files are inflated to, so they are paged in rather than held in memory
+    @JvmStatic external fun nSetScratchDir(path: String)
+    // Where inflated .vgz files are kept for the next open, up to maxBytes (0 = off)
+    @JvmStatic external fun nSetVgzCache(path: String, maxBytes: Long)
+    // Reads these files into the page cache in the background, replacing the previous list
+    @JvmStatic external fun nPrefetch(paths: Array<String>)
     @JvmStatic external fun nOpen(path: String): Boolean
     @JvmStatic external fun nClose()
     @JvmStatic external fun nPlay()
@@ -57,6 +70,20 @@ object VgmEngine {
     @JvmStatic external fun nSetChannelMuted(index: Int, muted: Boolean)
     @JvmStatic external fun nGetChannelSpectrums(): FloatArray?
 
+    /**
+     * Per-channel levels for every format, packed as [peak0, rms0, peak1, rms1, ...] in 0..1.
+     * Values are those of the last rendered buffer. Null when nothing is loaded.
+     */
+    @JvmStatic external fun nGetChannelLevels(): FloatArray?
+    @JvmStatic external fun nGetChannelLevelLabels(): Array<String>
+
+    /** Direct buffer over the native status block, see [EngineStatus]. */
+    @JvmStatic external fun nGetStatusBuffer(): ByteBuffer?
+
+    /** Ordered loads of the status block's seqlock and event index, see [EngineStatus]. */
+    @JvmStatic external fun nStatusSeq(): Int
+    @JvmStatic external fun nStatusEventWriteIdx(): Int
+
     // libgme multi-track support (NSF, GBS, etc.)
     @JvmStatic external fun nGetTrackCount(): Int
     @JvmStatic external fun nSetTrack(trackIndex: Int): Boolean
@@ -68,10 +95,53 @@ object VgmEngine {
     @JvmStatic external fun nSetEndlessLoop(enabled: Boolean)
     @JvmStatic external fun nGetEndlessLoop(): Boolean
 
-    // Playback speed control
+    // Loop-count ending with a native, sample-accurate fade
+    @JvmStatic external fun nSetLoopCount(loops: Int)
+    @JvmStatic external fun nSetFadeLength(ms: Int)
+    /** Fade out from the current position over [ms] and end the track (manual skip). */
+    @JvmStatic external fun nFadeOut(ms: Int)
+
+    /**
+     * Open [path] as the track after the current one and pre-roll it. The engine switches to it
+     * at the exact sample the current track ends and reports EVENT_TRACK_CHANGED. Returns false
+     * if nothing was prepared (PSF, endless mode, open failure). [gainDb] is the track's
+     * loudness gain, applied from the first sample it plays.
+     */
+    @JvmStatic external fun nPrepareNext(path: String, subTrack: Int, gainDb: Float): Boolean
+    /** Equal-power crossfade length into the prepared track; 0 for a plain gapless handover. */
+    @JvmStatic external fun nSetCrossfade(ms: Int)
+    /** Loudness (ReplayGain) gain of the current track, clamped to -24..+12 dB natively. */
+    @JvmStatic external fun nSetTrackGain(gainDb: Float)
+    /**
+     * Decode [path] offline and measure it: [integrated LUFS, true peak dBTP, seconds measured],
+     * or null if the format can't be analysed. Uses its own decoder, so it may run on any thread
+     * while playback continues.
+     */
+    @JvmStatic external fun nAnalyzeLoudness(path: String, subTrack: Int): FloatArray?
+
+    // Playback speed control, 0.25..1.0; pitch-preserving time stretch for every format
     @JvmStatic external fun nSetPlaybackSpeed(speed: Double)
     @JvmStatic external fun nGetPlaybackSpeed(): Double
 
+    /**
+     * Key change in semitones, -12..12, kept across tracks. libvgm, libopenmpt and MIDI change
+     * key natively (chip clocks, pitch factor, note numbers); other formats are pitch shifted
+     * by the time stretch stage. Drops the prepared next track.
+     */
+    @JvmStatic external fun nSetTranspose(semitones: Int)
+    @JvmStatic external fun nGetTranspose(): Int
+
+    /**
+     * Varispeed: when on, the playback speed also lowers the pitch, like a slowed-down tape,
+     * instead of being time stretched.
+     */
+    @JvmStatic external fun nSetVarispeed(enabled: Boolean)
+    @JvmStatic external fun nGetVarispeed(): Boolean
+
+    // Resampler quality for pitch, varispeed and PSF rate conversion: 0 low, 1 medium, 2 high
+    @JvmStatic external fun nSetResamplerQuality(quality: Int)
+    @JvmStatic external fun nGetResamplerQuality(): Int
+
     // KSS direct track info (without opening as active track)
     @JvmStatic external fun nGetKssTrackCountDirect(path: String): Int
     @JvmStatic external fun nGetKssTrackRange(path: String): IntArray  // Returns [minTrack, maxTrack]
@@ -83,14 +153,44 @@ object VgmEngine {
     @JvmStatic external fun nSetBassEnabled(enabled: Boolean)
     @JvmStatic external fun nGetBassEnabled(): Boolean
 
+    // Parametric EQ (band 0 doubles as the bass boost preset)
+    @JvmStatic external fun nSetEqBand(band: Int, type: Int, freqHz: Float, gainDb: Float, q: Float): Boolean
+    @JvmStatic external fun nSetEqEnabled(enabled: Boolean)
+    @JvmStatic external fun nGetEqEnabled(): Boolean
+
+    // Output limiter (always on); true-peak mode also catches inter-sample overs
+    @JvmStatic external fun nSetLimiterTruePeak(enabled: Boolean)
+    @JvmStatic external fun nGetLimiterTruePeak(): Boolean
+    /** Output loudness / true-peak / correlation meters in the status block; on by default. */
+    @JvmStatic external fun nSetOutputMeterEnabled(enabled: Boolean)
+    @JvmStatic external fun nGetOutputMeterEnabled(): Boolean
+
     // Reverb control
     @JvmStatic external fun nSetReverbEnabled(enabled: Boolean)
     @JvmStatic external fun nGetReverbEnabled(): Boolean
 
+    /**
+     * Shared-memory view of position, end state, spectrum and levels. Reading it needs
+     * neither JNI nor the mutex; null only if the native block could not be allocated.
+     */
+    val status: EngineStatus? by lazy {
+        nGetStatusBuffer()?.let { EngineStatus(it) }?.takeIf { it.isValid }
+    }
+
     // ----- Thread-safe wrappers -----
 
     suspend fun setSampleRate(rate: Int) = mutex.withLock { nSetSampleRate(rate) }
     suspend fun setRomPath(path: String) = mutex.withLock { nSetRomPath(path) }
+    // Not behind the mutex: called once, before anything is opened
+    fun setAssetManager(assets: AssetManager) = nSetAssetManager(assets)
+    // Not behind the mutex: called once, before anything is opened
+    fun setScratchDir(dir: File) = nSetScratchDir(dir.absolutePath)
+    // Inflated .vgz files are kept in cacheDir/VGZ_CACHE_DIR
+    const val VGZ_CACHE_DIR = "vgz"
+    // Not behind the mutex: the native cache has its own lock
+    fun setVgzCache(dir: File, maxBytes: Long) = nSetVgzCache(dir.absolutePath, maxBytes)
+    // Not behind the mutex: only hands the list to the native prefetch thread
+    fun prefetch(paths: List<String>) = nPrefetch(paths.toTypedArray())
     suspend fun open(path: String): Boolean = mutex.withLock { nOpen(path) }
     suspend fun close() = mutex.withLock { nClose() }
     suspend fun play() = mutex.withLock { nPlay() }
@@ -114,6 +214,8 @@ object VgmEngine {
     suspend fun isChannelMuted(index: Int): Boolean = mutex.withLock { nIsChannelMuted(index) }
     suspend fun setChannelMuted(index: Int, muted: Boolean) = mutex.withLock { nSetChannelMuted(index, muted) }
     suspend fun getChannelSpectrums(): FloatArray? = mutex.withLock { nGetChannelSpectrums() }
+    suspend fun getChannelLevels(): FloatArray? = mutex.withLock { nGetChannelLevels() }
+    suspend fun getChannelLevelLabels(): Array<String> = mutex.withLock { nGetChannelLevelLabels() }
     
     // Multi-track support (NSF, GBS, etc.)
     suspend fun getTrackCount(): Int = mutex.withLock { nGetTrackCount() }
@@ -125,10 +227,32 @@ object VgmEngine {
     // Endless loop mode
     suspend fun setEndlessLoop(enabled: Boolean) = mutex.withLock { nSetEndlessLoop(enabled) }
     suspend fun getEndlessLoop(): Boolean = mutex.withLock { nGetEndlessLoop() }
+
+    // Loop-count ending
+    suspend fun setLoopCount(loops: Int) = mutex.withLock { nSetLoopCount(loops) }
+    suspend fun setFadeLength(ms: Int) = mutex.withLock { nSetFadeLength(ms) }
+    suspend fun fadeOut(ms: Int) = mutex.withLock { nFadeOut(ms) }
+    // Checks for cancellation once it holds the lock: a prepare cancelled by an open must
+    // not arm a next track for the track that was just replaced
+    suspend fun prepareNext(path: String, subTrack: Int, gainDb: Float = 0f): Boolean =
+        mutex.withLock {
+            currentCoroutineContext().ensureActive()
+            nPrepareNext(path, subTrack, gainDb)
+        }
+    suspend fun setCrossfade(ms: Int) = mutex.withLock { nSetCrossfade(ms) }
+    suspend fun setTrackGain(gainDb: Float) = mutex.withLock { nSetTrackGain(gainDb) }
+    // Not behind the mutex: analysis never touches the playing decoder
+    fun analyzeLoudness(path: String, subTrack: Int): FloatArray? = nAnalyzeLoudness(path, subTrack)
     
     // Playback speed control
     suspend fun setPlaybackSpeed(speed: Double) = mutex.withLock { nSetPlaybackSpeed(speed) }
     suspend fun getPlaybackSpeed(): Double = mutex.withLock { nGetPlaybackSpeed() }
+    suspend fun setTranspose(semitones: Int) = mutex.withLock { nSetTranspose(semitones) }
+    suspend fun getTranspose(): Int = mutex.withLock { nGetTranspose() }
+    suspend fun setVarispeed(enabled: Boolean) = mutex.withLock { nSetVarispeed(enabled) }
+    suspend fun getVarispeed(): Boolean = mutex.withLock { nGetVarispeed() }
+    suspend fun setResamplerQuality(quality: Int) = mutex.withLock { nSetResamplerQuality(quality) }
+    suspend fun getResamplerQuality(): Int = mutex.withLock { nGetResamplerQuality() }
     
     // KSS direct track info
     suspend fun getKssTrackCountDirect(path: String): Int = mutex.withLock { nGetKssTrackCountDirect(path) }
@@ -141,6 +265,21 @@ object VgmEngine {
     suspend fun setBassEnabled(enabled: Boolean) = mutex.withLock { nSetBassEnabled(enabled) }
     suspend fun getBassEnabled(): Boolean = mutex.withLock { nGetBassEnabled() }
 
+    // Parametric EQ
+    const val EQ_LOW_SHELF = 0
+    const val EQ_PEAKING = 1
+    const val EQ_HIGH_SHELF = 2
+    suspend fun setEqBand(band: Int, type: Int, freqHz: Float, gainDb: Float, q: Float = 0.707f): Boolean =
+        mutex.withLock { nSetEqBand(band, type, freqHz, gainDb, q) }
+    suspend fun setEqEnabled(enabled: Boolean) = mutex.withLock { nSetEqEnabled(enabled) }
+    suspend fun getEqEnabled(): Boolean = mutex.withLock { nGetEqEnabled() }
+
+    // Output limiter; gain reduction stats are in the status block
+    suspend fun setLimiterTruePeak(enabled: Boolean) = mutex.withLock { nSetLimiterTruePeak(enabled) }
+    suspend fun getLimiterTruePeak(): Boolean = mutex.withLock { nGetLimiterTruePeak() }
+    suspend fun setOutputMeterEnabled(enabled: Boolean) = mutex.withLock { nSetOutputMeterEnabled(enabled) }
+    suspend fun getOutputMeterEnabled(): Boolean = mutex.withLock { nGetOutputMeterEnabled() }
+
     // Reverb control
     suspend fun setReverbEnabled(enabled: Boolean) = mutex.withLock { nSetReverbEnabled(enabled) }
     suspend fun getReverbEnabled(): Boolean = mutex.withLock { nGetReverbEnabled() }
@@ -40,6 +40,9 @@ interface GameDao {
     @Query("SELECT COUNT(*) FROM games")
     suspend fun count(): Int
 
+    @Query("SELECT * FROM games WHERE id = :gameId")
+    suspend fun getGameById(gameId: Long): GameEntity?
+
     @Query("SELECT * FROM games WHERE folderPath = :path LIMIT 1")
     suspend fun findByPath(path: String): GameEntity?
 
@@ -51,6 +54,9 @@ interface GameDao {
 
     @Query("DELETE FROM games WHERE id = :gameId")
     suspend fun deleteGameById(gameId: Long)
+
+    @Query("UPDATE games SET loudnessLufs = :lufs, truePeakDb = :peakDb WHERE id = :gameId")
+    suspend fun updateLoudness(gameId: Long, lufs: Float?, peakDb: Float?)
 }
 
 @Dao
@@ -75,4 +81,17 @@ interface TrackDao {
 
     @Query("DELETE FROM tracks WHERE gameId = :gameId")
     suspend fun deleteTracksForGame(gameId: Long)
+
+    @Query("SELECT * FROM tracks WHERE loudnessLufs IS NULL")
+    suspend fun getTracksWithoutLoudness(): List<TrackEntity>
+
+    @Query("UPDATE tracks SET loudnessLufs = :lufs, truePeakDb = :peakDb WHERE id = :trackId")
+    suspend fun updateLoudness(trackId: Long, lufs: Float, peakDb: Float)
+
+    @Query("UPDATE tracks SET filePath = :filePath WHERE id = :trackId")
+    suspend fun updateFilePath(trackId: Long, filePath: String)
+
+    // Tracks played from the file at :path, or from an entry of the pack at :path
+    @Query("SELECT COUNT(*) FROM tracks WHERE filePath = :path OR filePath LIKE :path || '!/%'")
+    suspend fun countTracksUsing(path: String): Int
 }
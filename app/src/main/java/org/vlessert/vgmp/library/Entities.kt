@@ -17,7 +17,9 @@ data class GameEntity(
     val artPath: String,       // absolute path to .png art, or ""
     val zipSource: String,     // source zip filename for reference
     val isFavorite: Boolean = false,
-    val soundChips: String = "" // sound chips used (e.g., "YM2612, SN76489")
+    val soundChips: String = "", // sound chips used (e.g., "YM2612, SN76489")
+    val loudnessLufs: Float? = null, // all analysed tracks together, null until analysed
+    val truePeakDb: Float? = null    // loudest track's true peak (dBTP)
 )
 
 @Entity(
@@ -39,5 +41,7 @@ data class TrackEntity(
     val durationSamples: Long,  // -1 if unknown
     val trackIndex: Int,        // order within the game
     val isFavorite: Boolean = false,
-    val subTrackIndex: Int = -1 // for multi-track files like NSF (-1 = not a subtrack)
+    val subTrackIndex: Int = -1, // for multi-track files like NSF (-1 = not a subtrack)
+    val loudnessLufs: Float? = null, // integrated loudness (EBU R128), null until analysed
+    val truePeakDb: Float? = null    // true peak (dBTP)
 )
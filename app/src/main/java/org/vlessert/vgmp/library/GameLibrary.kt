@@ -3,18 +3,32 @@ package org.vlessert.vgmp.library
 import android.content.Context
 import android.graphics.Bitmap
 import android.graphics.BitmapFactory
+import android.os.Process
 import android.util.Log
 import com.github.junrar.Archive
 import com.github.junrar.rarfile.FileHeader
+import kotlinx.coroutines.CoroutineScope
 import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.SupervisorJob
+import kotlinx.coroutines.asCoroutineDispatcher
+import kotlinx.coroutines.async
+import kotlinx.coroutines.awaitAll
+import kotlinx.coroutines.launch
+import kotlinx.coroutines.sync.Mutex
+import kotlinx.coroutines.sync.withLock
 import kotlinx.coroutines.withContext
 import org.vlessert.vgmp.engine.VgmEngine
 import org.vlessert.vgmp.settings.SettingsManager
 import java.io.*
+import java.util.concurrent.LinkedBlockingQueue
+import java.util.concurrent.ThreadPoolExecutor
+import java.util.concurrent.TimeUnit
 import java.util.zip.ZipEntry
+import java.util.zip.ZipFile
 import java.util.zip.ZipInputStream
 import java.util.zip.ZipOutputStream
 import org.json.JSONArray
+import org.json.JSONException
 import org.json.JSONObject
 
 private const val TAG = "GameLibrary"
@@ -36,6 +50,21 @@ private const val TRACKER_GAME_NAME = "Tracker files"
 private const val MIDI_GAME_NAME = "MIDI files"
 private const val DOOM1_GAME_NAME = "Doom"
 private const val DOOM2_GAME_NAME = "Doom II"
+// Weight of a track of unknown length in a game's loudness
+private const val LOUDNESS_DEFAULT_SECONDS = 60.0
+// Track paths naming a file bundled in the APK, played by the engine without extracting it
+const val ASSET_PATH_PREFIX = "asset:///"
+// Separates a zip pack's path from an entry name in a track path ("pack.zip!/track.vgz");
+// the engine plays such entries from inside the pack (native zip_archive)
+const val ZIP_ENTRY_SEPARATOR = "!/"
+// Packs whose entries track paths may name: imported zips and converted games (VgmPack)
+private val PACK_EXTENSIONS = listOf(".zip", VgmPack.EXTENSION)
+// Formats the engine reads through its file layer, and so can play from inside a pack.
+// KSS, RSN and PSF tracks still need files of their own.
+private val ZIP_IN_PLACE_EXTENSIONS = VGM_EXTENSIONS + GME_EXTENSIONS + TRACKER_EXTENSIONS +
+    MIDI_EXTENSIONS + MUS_EXTENSIONS
+// Sources replaced by a game pack, one path per line, deleted at the next launch
+private const val PACKED_SOURCES_FILE = "packed_sources.txt"
 
 // Data class for vigamup gameinfo
 data class VigamupGameInfo(
@@ -79,6 +108,28 @@ object GameLibrary {
     private lateinit var appContext: Context
     private var initialized = false
 
+    // Loudness analysis decodes on its own background-priority threads, one fewer than there
+    // are cores, so playback and the UI always keep a core; idle threads exit
+    private val analysisThreads = maxOf(1, Runtime.getRuntime().availableProcessors() - 1)
+    private val analysisDispatcher = ThreadPoolExecutor(
+        analysisThreads, analysisThreads, 10L, TimeUnit.SECONDS, LinkedBlockingQueue()
+    ) { task ->
+        Thread({
+            Process.setThreadPriority(Process.THREAD_PRIORITY_BACKGROUND)
+            task.run()
+        }, "LoudnessAnalysis").apply { isDaemon = true }
+    }.apply { allowCoreThreadTimeOut(true) }.asCoroutineDispatcher()
+    private val analysisScope = CoroutineScope(SupervisorJob() + analysisDispatcher)
+    private val analysisLock = Any()
+    private var analysisRunning = false
+    private var analysisRerun = false
+    // Tracks the native analyser could not measure; not retried until the next launch
+    private val analysisFailed = mutableSetOf<Long>()
+
+    // Game pack conversion runs one game at a time, behind imports
+    private val packScope = CoroutineScope(SupervisorJob() + Dispatchers.IO)
+    private val packMutex = Mutex()
+
     private val EXTENSION_GROUPS = mapOf(
         SettingsManager.TYPE_GROUP_VGM to VGM_EXTENSIONS,
         SettingsManager.TYPE_GROUP_GME to GME_EXTENSIONS,
@@ -96,6 +147,12 @@ object GameLibrary {
         gamesDir = File(context.filesDir, "games").also { it.mkdirs() }
         appContext = context.applicationContext
         initialized = true
+        packScope.launch {
+            packMutex.withLock {
+                deletePackedSources()
+                restorePacks()
+            }
+        }
     }
 
     private fun getEnabledExtensions(): Set<String> {
@@ -161,15 +218,8 @@ object GameLibrary {
                             importRsn(stream, fileName)
                         }
                     } else {
-                        // Copy asset to a temp file then import as single file
-                        val tempFile = File(context.cacheDir, fileName)
-                        context.assets.open(assetPath).use { input ->
-                            tempFile.outputStream().use { output ->
-                                input.copyTo(output)
-                            }
-                        }
-                        importSingleFile(tempFile)
-                        tempFile.delete()
+                        // Played from the APK, nothing is copied
+                        addSingleFile(ASSET_PATH_PREFIX + assetPath, fileName)
                     }
                 } catch (e: Exception) {
                     Log.e(TAG, "Failed to load bundled audio file $assetPath", e)
@@ -184,7 +234,10 @@ object GameLibrary {
     suspend fun importZip(inputStream: InputStream, zipName: String): Game? =
         withContext(Dispatchers.IO) {
             try {
-                _importZip(inputStream, zipName)
+                _importZip(inputStream, zipName).also { game ->
+                    scheduleLoudnessAnalysis()
+                    if (game != null) schedulePackConversion(game.id)
+                }
             } catch (e: Exception) {
                 Log.e(TAG, "importZip failed for $zipName", e)
                 null
@@ -196,7 +249,12 @@ object GameLibrary {
         val folderName = zipName.removeSuffix(".zip").removeSuffix(".ZIP")
         val gameFolder = File(gamesDir, sanitizeFilename(folderName)).also { it.mkdirs() }
 
-        // Extract files
+        // Keep the pack itself: tracks the engine can read from it are played in place, so
+        // only what needs a file of its own (art, KSS, RSN, PSF, metadata) is extracted
+        val packFile = File(gameFolder, sanitizeFilename(folderName) + ".zip")
+        packFile.outputStream().use { out -> inputStream.copyTo(out) }
+        var playsFromPack = false
+
         val vgmFiles = mutableListOf<File>()
         var artFile: File? = null
         var m3uContent: String? = null
@@ -210,14 +268,20 @@ object GameLibrary {
         val artFiles = mutableMapOf<String, File>()       // baseName -> png file
         val kssFiles = mutableMapOf<String, File>()       // baseName -> kss file
 
-        ZipInputStream(BufferedInputStream(inputStream)).use { zis ->
-            var entry = zis.nextEntry
-            while (entry != null) {
+        ZipFile(packFile).use { zip ->
+            for (entry in zip.entries()) {
                 if (!entry.isDirectory) {
                     val name = entry.name.substringAfterLast('/')
+                    if (ZIP_IN_PLACE_EXTENSIONS.any { ext -> name.endsWith(ext, true) }) {
+                        vgmFiles.add(File(packFile.path + ZIP_ENTRY_SEPARATOR + entry.name))
+                        playsFromPack = true
+                        continue
+                    }
                     val outFile = File(gameFolder, sanitizeFilename(name))
-                    outFile.outputStream().use { out -> zis.copyTo(out) }
-                    
+                    zip.getInputStream(entry).use { input ->
+                        outFile.outputStream().use { out -> input.copyTo(out) }
+                    }
+
                     // Check for vigamup format files
                     val baseName = name.substringBeforeLast('.')
                     when {
@@ -259,10 +323,9 @@ object GameLibrary {
                         }
                     }
                 }
-                zis.closeEntry()
-                entry = zis.nextEntry
             }
         }
+        if (!playsFromPack) packFile.delete()
 
         if (vgmFiles.isEmpty()) {
             Log.w(TAG, "No audio files found in $zipName")
@@ -835,6 +898,109 @@ object GameLibrary {
         }
     }
 
+    /**
+     * Measure the loudness of every track that hasn't been measured yet, in the background.
+     * Tracks are decoded in parallel (on all cores but one) and stored as they finish; each game's
+     * value is recomputed from its tracks. Calls while a pass is running queue one more pass.
+     */
+    fun scheduleLoudnessAnalysis() {
+        synchronized(analysisLock) {
+            if (analysisRunning) {
+                analysisRerun = true
+                return
+            }
+            analysisRunning = true
+        }
+        analysisScope.launch {
+            do {
+                synchronized(analysisLock) { analysisRerun = false }
+                try {
+                    analyzePendingTracks()
+                } catch (e: Exception) {
+                    Log.e(TAG, "Loudness analysis failed", e)
+                }
+                val again = synchronized(analysisLock) {
+                    analysisRunning = analysisRerun
+                    analysisRerun
+                }
+            } while (again)
+        }
+    }
+
+    private suspend fun analyzePendingTracks() {
+        val skip = PSF_EXTENSIONS // not decodable offline
+        val pending = db.trackDao().getTracksWithoutLoudness().filter { track ->
+            val path = track.filePath.lowercase()
+            track.id !in synchronized(analysisLock) { analysisFailed } &&
+                skip.none { path.endsWith(it) } && trackFileExists(track.filePath)
+        }
+        if (pending.isEmpty()) return
+        Log.d(TAG, "Analysing loudness of ${pending.size} tracks")
+
+        // analysisDispatcher's threads bound the parallel decoders
+        val games = pending.map { track ->
+            analysisScope.async {
+                val result = VgmEngine.analyzeLoudness(track.filePath, track.subTrackIndex)
+                if (result == null || result.size < 3 || result[2] <= 0f) {
+                    synchronized(analysisLock) { analysisFailed.add(track.id) }
+                    null
+                } else {
+                    db.trackDao().updateLoudness(track.id, result[0], result[1])
+                    track.gameId
+                }
+            }
+        }.awaitAll().filterNotNull().toSet()
+
+        for (gameId in games) updateGameLoudness(gameId)
+    }
+
+    /**
+     * A game's loudness is the length-weighted mean energy of its measured tracks, which is
+     * what measuring the whole album as one stream would give (up to gating); its peak is
+     * the highest track peak.
+     */
+    private suspend fun updateGameLoudness(gameId: Long) {
+        val measured = db.trackDao().getTracksForGame(gameId).filter { it.loudnessLufs != null }
+        if (measured.isEmpty()) return
+        var energy = 0.0
+        var weight = 0.0
+        var peak = Float.NEGATIVE_INFINITY
+        for (track in measured) {
+            val seconds = if (track.durationSamples > 0) track.durationSamples / 44100.0
+                          else LOUDNESS_DEFAULT_SECONDS
+            energy += seconds * Math.pow(10.0, track.loudnessLufs!! / 10.0)
+            weight += seconds
+            track.truePeakDb?.let { if (it > peak) peak = it }
+        }
+        val lufs = (10.0 * Math.log10(energy / weight)).toFloat()
+        db.gameDao().updateLoudness(gameId, lufs, if (peak.isFinite()) peak else null)
+    }
+
+    /**
+     * ReplayGain for [track] in dB under the current setting: moves its measured loudness
+     * (or its game's) to the target level, but never lifts the true peak above 0 dBTP.
+     * 0 when off or not measured yet.
+     */
+    suspend fun getReplayGainDb(track: TrackEntity): Float = withContext(Dispatchers.IO) {
+        val mode = SettingsManager.getReplayGainMode(appContext)
+        if (mode == SettingsManager.REPLAY_GAIN_OFF) return@withContext 0f
+        val lufs: Float?
+        val peak: Float?
+        if (mode == SettingsManager.REPLAY_GAIN_GAME) {
+            val game = db.gameDao().getGameById(track.gameId)
+            lufs = game?.loudnessLufs
+            peak = game?.truePeakDb
+        } else {
+            val fresh = db.trackDao().getTrackById(track.id) ?: track
+            lufs = fresh.loudnessLufs
+            peak = fresh.truePeakDb
+        }
+        if (lufs == null || lufs <= -70f) return@withContext 0f
+        var gain = SettingsManager.REPLAY_GAIN_TARGET_LUFS - lufs
+        if (peak != null && peak.isFinite() && gain > -peak) gain = -peak
+        gain
+    }
+
     /** Get count of games in library */
     suspend fun getGameCount(): Int = withContext(Dispatchers.IO) {
         db.gameDao().count()
@@ -852,8 +1018,12 @@ object GameLibrary {
     
     /** Delete a game and all its tracks */
     suspend fun deleteGame(gameId: Long) = withContext(Dispatchers.IO) {
+        val game = db.gameDao().getGameById(gameId)
         db.trackDao().deleteTracksForGame(gameId)
         db.gameDao().deleteGameById(gameId)
+        // Its pack would be restored at the next launch; a mapped pack stays readable
+        game?.let { File(it.folderPath).listFiles { f -> f.name.endsWith(VgmPack.EXTENSION) } }
+            ?.forEach { it.delete() }
     }
     
     /**
@@ -863,7 +1033,7 @@ object GameLibrary {
      */
     suspend fun importSingleFile(file: File): Game? = withContext(Dispatchers.IO) {
         try {
-            _importSingleFile(file)
+            _importSingleFile(file).also { scheduleLoudnessAnalysis() }
         } catch (e: Exception) {
             Log.e(TAG, "importSingleFile failed for ${file.name}", e)
             null
@@ -871,12 +1041,21 @@ object GameLibrary {
     }
     
     private suspend fun _importSingleFile(file: File): Game? {
-        val fileName = file.nameWithoutExtension
-        val gameFolder = File(gamesDir, sanitizeFilename(fileName)).also { it.mkdirs() }
+        val gameFolder = File(gamesDir, sanitizeFilename(file.nameWithoutExtension)).also { it.mkdirs() }
         
         // Copy file to game folder
         val destFile = File(gameFolder, file.name)
         file.copyTo(destFile, overwrite = true)
+        return addSingleFile(destFile.absolutePath, file.name)
+    }
+
+    /**
+     * Add the single file at [path] (a file or an [ASSET_PATH_PREFIX] asset) as a game of its own.
+     * [name] is its file name.
+     */
+    private suspend fun addSingleFile(path: String, name: String): Game? {
+        val fileName = name.substringBeforeLast('.')
+        val gameFolder = File(gamesDir, sanitizeFilename(fileName)).also { it.mkdirs() }
         
         VgmEngine.setSampleRate(44100)
         var gameName = fileName
@@ -885,10 +1064,10 @@ object GameLibrary {
         var yearStr = ""
         
         // Check if this is a multi-track file (NSF, GBS, etc.)
-        val isMultiTrack = VgmEngine.isMultiTrack(destFile.absolutePath)
+        val isMultiTrack = VgmEngine.isMultiTrack(path)
         val trackCount = if (isMultiTrack) {
             // Open to get track count
-            if (VgmEngine.open(destFile.absolutePath)) {
+            if (VgmEngine.open(path)) {
                 val count = VgmEngine.getTrackCount()
                 VgmEngine.close()
                 count
@@ -897,7 +1076,7 @@ object GameLibrary {
         
         // Get tags from file
         try {
-            if (VgmEngine.open(destFile.absolutePath)) {
+            if (VgmEngine.open(path)) {
                 val tags = VgmEngine.parseTags(VgmEngine.getTags())
                 if (tags.gameEn.isNotEmpty()) gameName = tags.gameEn
                 else if (tags.gameJp.isNotEmpty()) gameName = tags.gameJp
@@ -909,12 +1088,12 @@ object GameLibrary {
                 VgmEngine.close()
             }
         } catch (e: Exception) {
-            Log.w(TAG, "Could not get tags from ${file.name}")
+            Log.w(TAG, "Could not get tags from $name")
         }
         
         // Fallback system name based on file extension
         if (systemName.isEmpty()) {
-            val ext = file.extension.lowercase()
+            val ext = name.substringAfterLast('.', "").lowercase()
             systemName = when {
                 ext == "nsf" || ext == "nsfe" -> "Famicom (NSF)"
                 ext == "gbs" -> "Game Boy (GBS)"
@@ -957,7 +1136,7 @@ object GameLibrary {
             year = yearStr,
             folderPath = gameFolder.absolutePath,
             artPath = "",
-            zipSource = file.name
+            zipSource = name
         )
         val gameId = db.gameDao().insertGame(tempGameEntity)
         
@@ -968,7 +1147,7 @@ object GameLibrary {
             // Multi-track file (NSF, GBS, etc.)
             for (i in 0 until trackCount) {
                 val durationSamples = try {
-                    VgmEngine.getTrackLength(destFile.absolutePath, i)
+                    VgmEngine.getTrackLength(path, i)
                 } catch (e: Exception) { 
                     Log.e(TAG, "Failed to get duration for track $i", e)
                     -1L 
@@ -978,7 +1157,7 @@ object GameLibrary {
                     id = 0,
                     gameId = gameId,
                     title = "Track ${i + 1}",
-                    filePath = destFile.absolutePath,
+                    filePath = path,
                     durationSamples = durationSamples,
                     trackIndex = i,
                     isFavorite = false,
@@ -988,9 +1167,9 @@ object GameLibrary {
         } else {
             // Single-track file
             val durationSamples = try {
-                VgmEngine.getTrackLengthDirect(destFile.absolutePath)
+                VgmEngine.getTrackLengthDirect(path)
             } catch (e: Exception) { 
-                Log.e(TAG, "Failed to get duration for ${destFile.name}", e)
+                Log.e(TAG, "Failed to get duration for $name", e)
                 -1L 
             }
             
@@ -998,7 +1177,7 @@ object GameLibrary {
                 id = 0,
                 gameId = gameId,
                 title = fileName,
-                filePath = destFile.absolutePath,
+                filePath = path,
                 durationSamples = durationSamples,
                 trackIndex = 0,
                 isFavorite = false
@@ -1014,7 +1193,7 @@ object GameLibrary {
             year = yearStr,
             folderPath = gameFolder.absolutePath,
             artPath = "",
-            zipSource = file.name
+            zipSource = name
         )
         db.gameDao().insertGame(gameEntity)
         db.trackDao().insertTracks(trackEntities)
@@ -1028,7 +1207,7 @@ object GameLibrary {
      */
     suspend fun importTrackerFile(file: File): Game? = withContext(Dispatchers.IO) {
         try {
-            _importTrackerFile(file)
+            _importTrackerFile(file).also { scheduleLoudnessAnalysis() }
         } catch (e: Exception) {
             Log.e(TAG, "importTrackerFile failed for ${file.name}", e)
             null
@@ -1036,38 +1215,44 @@ object GameLibrary {
     }
     
     private suspend fun _importTrackerFile(file: File): Game? {
-        // Get or create the "Tracker files" game entry
-        var trackerGame = db.gameDao().searchGames(TRACKER_GAME_NAME).firstOrNull()
-        
         val trackerFolder = File(gamesDir, sanitizeFilename(TRACKER_GAME_NAME)).also { it.mkdirs() }
         
         // Copy file to tracker folder
         val destFile = File(trackerFolder, file.name)
         file.copyTo(destFile, overwrite = true)
+        return addTrackerTrack(destFile.absolutePath, file.name)
+    }
+
+    /** Add the tracker file at [path] (a file or an asset) named [name] to the "Tracker files" game. */
+    private suspend fun addTrackerTrack(path: String, name: String): Game? {
+        // Get or create the "Tracker files" game entry
+        var trackerGame = db.gameDao().searchGames(TRACKER_GAME_NAME).firstOrNull()
+        
+        val trackerFolder = File(gamesDir, sanitizeFilename(TRACKER_GAME_NAME)).also { it.mkdirs() }
         
         VgmEngine.setSampleRate(44100)
         
         // Get tags from tracker file
-        var trackTitle = file.nameWithoutExtension
+        var trackTitle = name.substringBeforeLast('.')
         var authorName = ""
         var systemName = "Tracker"
         
         try {
-            if (VgmEngine.open(destFile.absolutePath)) {
+            if (VgmEngine.open(path)) {
                 val tags = VgmEngine.parseTags(VgmEngine.getTags())
                 if (tags.trackEn.isNotEmpty()) trackTitle = tags.trackEn
                 if (tags.authorEn.isNotEmpty()) authorName = tags.authorEn
                 VgmEngine.close()
             }
         } catch (e: Exception) {
-            Log.w(TAG, "Could not get tags from tracker file ${file.name}")
+            Log.w(TAG, "Could not get tags from tracker file $name")
         }
         
         // Get duration (tracker files default to 3 minutes in the engine)
         val durationSamples = try {
-            VgmEngine.getTrackLengthDirect(destFile.absolutePath)
+            VgmEngine.getTrackLengthDirect(path)
         } catch (e: Exception) { 
-            Log.e(TAG, "Failed to get duration for ${destFile.name}", e)
+            Log.e(TAG, "Failed to get duration for $name", e)
             -1L 
         }
         
@@ -1088,7 +1273,7 @@ object GameLibrary {
                 id = 0,
                 gameId = gameId,
                 title = trackTitle,
-                filePath = destFile.absolutePath,
+                filePath = path,
                 durationSamples = durationSamples,
                 trackIndex = 0,
                 isFavorite = false
@@ -1105,7 +1290,7 @@ object GameLibrary {
                 id = 0,
                 gameId = trackerGame.id,
                 title = trackTitle,
-                filePath = destFile.absolutePath,
+                filePath = path,
                 durationSamples = durationSamples,
                 trackIndex = nextIndex,
                 isFavorite = false
@@ -1130,15 +1315,8 @@ object GameLibrary {
             
             for (assetPath in trackerFiles) {
                 try {
-                    val fileName = assetPath.substringAfterLast('/')
-                    val tempFile = File(context.cacheDir, fileName)
-                    context.assets.open(assetPath).use { input ->
-                        tempFile.outputStream().use { output ->
-                            input.copyTo(output)
-                        }
-                    }
-                    importTrackerFile(tempFile)
-                    tempFile.delete()
+                    // Played from the APK, nothing is copied
+                    addTrackerTrack(ASSET_PATH_PREFIX + assetPath, assetPath.substringAfterLast('/'))
                 } catch (e: Exception) {
                     Log.e(TAG, "Failed to load bundled tracker file $assetPath", e)
                 }
@@ -1159,14 +1337,20 @@ object GameLibrary {
     }
     
     private suspend fun _importMusFile(file: File, gameName: String = DOOM1_GAME_NAME, year: String = "1993"): Game? {
-        // Get or create the game entry - use exact name match
-        var musGame = db.gameDao().findGameByName(gameName)
-        
         val musFolder = File(gamesDir, sanitizeFilename(gameName)).also { it.mkdirs() }
         
         // Copy file to MUS folder
         val destFile = File(musFolder, file.name)
         file.copyTo(destFile, overwrite = true)
+        return addMusTrack(destFile.absolutePath, file.name, gameName, year)
+    }
+
+    /** Add the MUS file at [path] (a file or an asset) named [name] to the game [gameName]. */
+    private suspend fun addMusTrack(path: String, name: String, gameName: String, year: String): Game? {
+        // Get or create the game entry - use exact name match
+        var musGame = db.gameDao().findGameByName(gameName)
+        
+        val musFolder = File(gamesDir, sanitizeFilename(gameName)).also { it.mkdirs() }
         
         // Also ensure GENMIDI.lmp exists in the MUS folder (required for OPL synthesis)
         val genmidiFile = File(musFolder, "GENMIDI.lmp")
@@ -1185,26 +1369,26 @@ object GameLibrary {
         VgmEngine.setSampleRate(44100)
         
         // Get tags from MUS file
-        var trackTitle = file.nameWithoutExtension
+        var trackTitle = name.substringBeforeLast('.')
         var authorName = "id Software"
         var systemName = "Doom (OPL3)"
         
         try {
-            if (VgmEngine.open(destFile.absolutePath)) {
+            if (VgmEngine.open(path)) {
                 val tags = VgmEngine.parseTags(VgmEngine.getTags())
                 if (tags.trackEn.isNotEmpty()) trackTitle = tags.trackEn
                 if (tags.authorEn.isNotEmpty()) authorName = tags.authorEn
                 VgmEngine.close()
             }
         } catch (e: Exception) {
-            Log.w(TAG, "Could not get tags from MUS file ${file.name}")
+            Log.w(TAG, "Could not get tags from MUS file $name")
         }
         
         // Get duration
         val durationSamples = try {
-            VgmEngine.getTrackLengthDirect(destFile.absolutePath)
+            VgmEngine.getTrackLengthDirect(path)
         } catch (e: Exception) { 
-            Log.e(TAG, "Failed to get duration for ${destFile.name}", e)
+            Log.e(TAG, "Failed to get duration for $name", e)
             -1L 
         }
         
@@ -1225,7 +1409,7 @@ object GameLibrary {
                 id = 0,
                 gameId = gameId,
                 title = trackTitle,
-                filePath = destFile.absolutePath,
+                filePath = path,
                 durationSamples = durationSamples,
                 trackIndex = 0,
                 isFavorite = false
@@ -1242,7 +1426,7 @@ object GameLibrary {
                 id = 0,
                 gameId = musGame.id,
                 title = trackTitle,
-                filePath = destFile.absolutePath,
+                filePath = path,
                 durationSamples = durationSamples,
                 trackIndex = nextIndex,
                 isFavorite = false
@@ -1311,14 +1495,8 @@ object GameLibrary {
                     continue
                 }
                 
-                val tempFile = File(context.cacheDir, fileName)
-                context.assets.open(assetPath).use { input ->
-                    tempFile.outputStream().use { output ->
-                        input.copyTo(output)
-                    }
-                }
-                _importMusFile(tempFile, gameName, year)
-                tempFile.delete()
+                // Played from the APK, nothing is copied
+                addMusTrack(ASSET_PATH_PREFIX + assetPath, fileName, gameName, year)
                 importedCount++
             } catch (e: Exception) {
                 Log.e(TAG, "Failed to load bundled MUS file $assetPath", e)
@@ -1334,7 +1512,7 @@ object GameLibrary {
      */
     suspend fun importMidiFile(file: File): Game? = withContext(Dispatchers.IO) {
         try {
-            _importMidiFile(file)
+            _importMidiFile(file).also { scheduleLoudnessAnalysis() }
         } catch (e: Exception) {
             Log.e(TAG, "importMidiFile failed for ${file.name}", e)
             null
@@ -1496,7 +1674,10 @@ object GameLibrary {
     suspend fun importRsn(inputStream: InputStream, rsnName: String): Game? =
         withContext(Dispatchers.IO) {
             try {
-                _importRsn(inputStream, rsnName)
+                _importRsn(inputStream, rsnName).also { game ->
+                    scheduleLoudnessAnalysis()
+                    if (game != null) schedulePackConversion(game.id)
+                }
             } catch (e: Exception) {
                 Log.e(TAG, "importRsn failed for $rsnName", e)
                 null
@@ -1664,6 +1845,178 @@ object GameLibrary {
         return Game(finalGameEntity, trackEntities, null)
     }
 
+    /**
+     * Convert game [gameId] into a single [VgmPack] in the background: its tracks, art and
+     * metadata in one mappable file in the game folder. Tracks are repointed at the pack
+     * straight away; the files and zip they came from may still be open for playback, so
+     * they are deleted at the next launch.
+     */
+    private fun schedulePackConversion(gameId: Long) {
+        packScope.launch {
+            packMutex.withLock {
+                try {
+                    convertToPack(gameId)
+                } catch (e: Exception) {
+                    Log.e(TAG, "Pack conversion failed for game $gameId", e)
+                }
+            }
+        }
+    }
+
+    private suspend fun convertToPack(gameId: Long) {
+        val game = db.gameDao().getGameById(gameId) ?: return
+        val folder = File(game.folderPath)
+        val tracks = db.trackDao().getTracksForGame(gameId)
+        val packable = tracks.filter { track ->
+            val path = track.filePath
+            path.startsWith(folder.path + File.separator) &&
+                ZIP_IN_PLACE_EXTENSIONS.any { path.endsWith(it, ignoreCase = true) } &&
+                zipPackPath(path)?.endsWith(VgmPack.EXTENSION) != true &&
+                trackFileExists(path)
+        }
+        // Only whole games: a pack next to loose tracks would save nothing
+        if (packable.isEmpty() || packable.size != tracks.size) return
+
+        // One entry per source; the subtracks of a multi-track file share it
+        val entryNames = linkedMapOf<String, String>()
+        for (track in packable) {
+            if (track.filePath in entryNames) continue
+            val name = File(track.filePath).name
+            entryNames[track.filePath] = if (name in entryNames.values) "${entryNames.size}_$name" else name
+        }
+        val artFile = game.artPath.takeIf { it.isNotEmpty() }?.let { File(it) }?.takeIf { it.exists() }
+        val artEntry = artFile?.let { "art." + it.extension.lowercase() }
+
+        val metadata = JSONObject().apply {
+            put("version", VgmPack.VERSION)
+            put("name", game.name)
+            put("system", game.system)
+            put("author", game.author)
+            put("year", game.year)
+            put("soundChips", game.soundChips)
+            put("zipSource", game.zipSource)
+            if (artEntry != null) put("art", artEntry)
+            put("tracks", JSONArray().apply {
+                for (track in packable) put(JSONObject().apply {
+                    put("title", track.title)
+                    put("entry", entryNames.getValue(track.filePath))
+                    put("trackIndex", track.trackIndex)
+                    put("subTrackIndex", track.subTrackIndex)
+                    put("durationSamples", track.durationSamples)
+                })
+            })
+        }
+
+        val packFile = File(folder, sanitizeFilename(folder.name) + VgmPack.EXTENSION)
+        VgmPack.write(
+            packFile,
+            entryNames.map { (path, name) -> VgmPack.Entry(name) { openTrack(path) } },
+            if (artFile != null && artEntry != null) VgmPack.Entry(artEntry) { artFile.inputStream() } else null,
+            metadata
+        )
+        for (track in packable) {
+            db.trackDao().updateFilePath(track.id, packFile.path + ZIP_ENTRY_SEPARATOR + entryNames.getValue(track.filePath))
+        }
+
+        val sources = entryNames.keys.map { zipPackPath(it) ?: it }.distinct()
+        File(gamesDir, PACKED_SOURCES_FILE).appendText(sources.joinToString("\n", postfix = "\n"))
+        Log.d(TAG, "Packed ${entryNames.size} files of ${game.name} into ${packFile.name}")
+    }
+
+    /**
+     * Delete the sources of games converted to packs during earlier runs, unless a track
+     * uses them again (the game was deleted and imported anew).
+     */
+    private suspend fun deletePackedSources() {
+        val list = File(gamesDir, PACKED_SOURCES_FILE)
+        if (!list.exists()) return
+        for (path in list.readLines().filter { it.isNotBlank() }.distinct()) {
+            if (db.trackDao().countTracksUsing(path) == 0) File(path).delete()
+        }
+        list.delete()
+    }
+
+    /**
+     * Add back the games of packs in the games folder that the library doesn't list, from the
+     * packs' metadata: a database rebuilt by a destructive migration loses the games, but their
+     * packs hold everything needed to play them. Art is taken out of the pack if it's gone.
+     */
+    private suspend fun restorePacks() {
+        val folders = gamesDir.listFiles { f -> f.isDirectory } ?: return
+        var restored = false
+        for (folder in folders) {
+            val pack = folder.listFiles { f -> f.name.endsWith(VgmPack.EXTENSION) }?.firstOrNull()
+                ?: continue
+            if (db.gameDao().findByPath(folder.absolutePath) != null) continue
+            val metadata = VgmPack.readMetadata(pack) ?: continue
+            val tracks = try {
+                val list = metadata.getJSONArray("tracks")
+                (0 until list.length()).map { i ->
+                    val track = list.getJSONObject(i)
+                    TrackEntity(
+                        gameId = 0,
+                        title = track.getString("title"),
+                        filePath = pack.path + ZIP_ENTRY_SEPARATOR + track.getString("entry"),
+                        durationSamples = track.optLong("durationSamples", -1L),
+                        trackIndex = track.optInt("trackIndex", i),
+                        subTrackIndex = track.optInt("subTrackIndex", -1)
+                    )
+                }
+            } catch (e: JSONException) {
+                Log.e(TAG, "Unreadable metadata in ${pack.path}", e)
+                continue
+            }
+            if (tracks.isEmpty()) continue
+
+            var artPath = ""
+            val artEntry = metadata.optString("art", "")
+            if (artEntry.isNotEmpty()) {
+                val artFile = File(folder, artEntry)
+                val present = artFile.exists() || try {
+                    VgmPack.extract(pack, artEntry, artFile)
+                } catch (e: IOException) {
+                    false
+                }
+                if (present) artPath = artFile.absolutePath
+            }
+            val gameId = db.gameDao().insertGame(GameEntity(
+                name = metadata.optString("name", folder.name),
+                system = metadata.optString("system", ""),
+                author = metadata.optString("author", ""),
+                year = metadata.optString("year", ""),
+                folderPath = folder.absolutePath,
+                artPath = artPath,
+                zipSource = metadata.optString("zipSource", ""),
+                soundChips = metadata.optString("soundChips", "")
+            ))
+            db.trackDao().insertTracks(tracks.map { it.copy(gameId = gameId) })
+            restored = true
+            Log.d(TAG, "Restored ${metadata.optString("name")} from ${pack.name}")
+        }
+        if (restored) scheduleLoudnessAnalysis()
+    }
+
+    /** The track at [path], a file or a pack entry, as a stream. */
+    private fun openTrack(path: String): InputStream {
+        val packPath = zipPackPath(path) ?: return File(path).inputStream()
+        val zip = ZipFile(packPath)
+        val entry = zip.getEntry(path.substring(packPath.length + ZIP_ENTRY_SEPARATOR.length))
+        if (entry == null) {
+            zip.close()
+            throw FileNotFoundException(path)
+        }
+        // Closing the entry's stream closes the zip
+        return object : FilterInputStream(zip.getInputStream(entry)) {
+            override fun close() {
+                try {
+                    super.close()
+                } finally {
+                    zip.close()
+                }
+            }
+        }
+    }
+
     /**
      * Export all games to a ZIP file with a JSON manifest.
      * Returns the output file on success, null on failure.
@@ -1727,10 +2080,10 @@ object GameLibrary {
                         for (track in tracks) {
                             val trackFile = File(track.filePath)
                             
-                            if (trackFile.exists()) {
+                            if (trackFileExists(track.filePath)) {
                                 val relativePath = "games/${gameFolder.name}/${trackFile.name}"
                                 if (!addedEntries.contains(relativePath)) {
-                                    addFileToZip(zos, trackFile, relativePath)
+                                    addTrackToZip(zos, track.filePath, relativePath)
                                     addedEntries.add(relativePath)
                                 }
 
@@ -1776,6 +2129,34 @@ object GameLibrary {
         zos.closeEntry()
     }
 
+    /** Copy the track at [path], a file, a bundled asset or a pack entry, into [zos]. */
+    private fun addTrackToZip(zos: ZipOutputStream, path: String, entryName: String) {
+        zos.putNextEntry(ZipEntry(entryName))
+        val input = if (path.startsWith(ASSET_PATH_PREFIX)) {
+            appContext.assets.open(path.removePrefix(ASSET_PATH_PREFIX))
+        } else {
+            openTrack(path)
+        }
+        input.use { it.copyTo(zos) }
+        zos.closeEntry()
+    }
+
+    /** The zip pack or game pack holding the track at [path], or null if it isn't a pack entry. */
+    private fun zipPackPath(path: String): String? {
+        var sep = path.indexOf(ZIP_ENTRY_SEPARATOR)
+        while (sep >= 0) {
+            if (PACK_EXTENSIONS.any { ext ->
+                    path.regionMatches(sep - ext.length, ext, 0, ext.length, ignoreCase = true)
+                }) return path.substring(0, sep)
+            sep = path.indexOf(ZIP_ENTRY_SEPARATOR, sep + 1)
+        }
+        return null
+    }
+
+    /** Whether the track at [path], a file, a bundled asset or a pack entry, is there to be played. */
+    private fun trackFileExists(path: String): Boolean =
+        path.startsWith(ASSET_PATH_PREFIX) || File(zipPackPath(path) ?: path).exists()
+
     /**
      * Import games from an exported ZIP file.
      * Returns the number of games imported on success, -1 on failure.
@@ -1903,6 +2284,7 @@ object GameLibrary {
                 tempExtractDir.deleteRecursively()
             }
 
+            scheduleLoudnessAnalysis()
             gameCount
         } catch (e: Exception) {
             Log.e(TAG, "Import failed", e)
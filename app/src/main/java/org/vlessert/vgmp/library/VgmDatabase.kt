@@ -4,10 +4,12 @@ import android.content.Context
 import androidx.room.Database
 import androidx.room.Room
 import androidx.room.RoomDatabase
+import androidx.room.migration.Migration
+import androidx.sqlite.db.SupportSQLiteDatabase
 
 @Database(
     entities = [GameEntity::class, TrackEntity::class],
-    version = 5,
+    version = 6,
     exportSchema = false
 )
 abstract class VgmDatabase : RoomDatabase() {
@@ -17,13 +19,24 @@ abstract class VgmDatabase : RoomDatabase() {
     companion object {
         @Volatile private var INSTANCE: VgmDatabase? = null
 
+        // 6: loudness analysis results; keeps the library instead of rebuilding it
+        private val MIGRATION_5_6 = object : Migration(5, 6) {
+            override fun migrate(db: SupportSQLiteDatabase) {
+                db.execSQL("ALTER TABLE games ADD COLUMN loudnessLufs REAL")
+                db.execSQL("ALTER TABLE games ADD COLUMN truePeakDb REAL")
+                db.execSQL("ALTER TABLE tracks ADD COLUMN loudnessLufs REAL")
+                db.execSQL("ALTER TABLE tracks ADD COLUMN truePeakDb REAL")
+            }
+        }
+
         fun getInstance(context: Context): VgmDatabase {
             return INSTANCE ?: synchronized(this) {
                 INSTANCE ?: Room.databaseBuilder(
                     context.applicationContext,
                     VgmDatabase::class.java,
                     "vgmp.db"
-                ).fallbackToDestructiveMigration()
+                ).addMigrations(MIGRATION_5_6)
+                 .fallbackToDestructiveMigration()
                  .build()
                  .also { INSTANCE = it }
             }
@@ -0,0 +1,141 @@
+package org.vlessert.vgmp.library
+
+import org.json.JSONObject
+import java.io.*
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.util.zip.CRC32
+import java.util.zip.GZIPInputStream
+import java.util.zip.ZipEntry
+import java.util.zip.ZipFile
+import java.util.zip.ZipOutputStream
+
+/**
+ * Writer and metadata reader for .vgmpack game packs: one file holding all tracks of a game,
+ * its art and its metadata, that the engine plays tracks from without extracting or copying
+ * them.
+ *
+ * A pack is a zip whose index is its central directory, so the native zip layer (zip_archive)
+ * that plays tracks from imported zips reads packs too: tracks are named
+ * "<pack>.vgmpack!/<entry>" and the index is parsed once per pack. Tracks are stored, not
+ * deflated, each starting on a 16 KB boundary (padded the way `zipalign -P 16` does), so
+ * opening one maps its pages straight out of the pack on 4 KB and 16 KB page devices alike.
+ * VGZ tracks that inflate to at most [INFLATE_LIMIT] are stored inflated and need no
+ * decompression to play; larger ones stay gzip-compressed and are inflated as they play.
+ * [METADATA_ENTRY] holds the game's tags and the tracks' titles and durations as JSON, enough
+ * to add the game back to the library from the pack alone ([readMetadata]).
+ */
+object VgmPack {
+    const val EXTENSION = ".vgmpack"
+    const val METADATA_ENTRY = "pack.json"
+    const val VERSION = 1
+
+    private const val INFLATE_LIMIT = 4 shl 20
+    private const val PAGE_SIZE = 16384
+    private const val LOCAL_HEADER_SIZE = 30
+    // Extra field zipalign pads with: id, size, alignment, then zeros
+    private const val ALIGN_EXTRA_ID = 0xD935
+    private const val ALIGN_EXTRA_SIZE = 6
+
+    /** A file to store in a pack under [entryName], read through [open]. */
+    class Entry(val entryName: String, val open: () -> InputStream)
+
+    /**
+     * Write [tracks], [art] (if any) and [metadata] to [target]. The pack is written to a
+     * temporary file first, so [target] is never seen half written.
+     */
+    fun write(target: File, tracks: List<Entry>, art: Entry?, metadata: JSONObject) {
+        val temp = File(target.path + ".tmp")
+        try {
+            FileOutputStream(temp).use { file ->
+                val counter = CountingOutputStream(BufferedOutputStream(file))
+                ZipOutputStream(counter).use { zos ->
+                    for (track in tracks) {
+                        putAligned(zos, counter, track.entryName, readTrack(track))
+                    }
+                    if (art != null) putAligned(zos, counter, art.entryName, art.open().use { it.readBytes() })
+                    zos.putNextEntry(ZipEntry(METADATA_ENTRY))
+                    zos.write(metadata.toString().toByteArray(Charsets.UTF_8))
+                    zos.closeEntry()
+                }
+            }
+            if (!temp.renameTo(target)) throw IOException("Could not write $target")
+        } finally {
+            temp.delete()
+        }
+    }
+
+    /**
+     * The [METADATA_ENTRY] of the pack [file], or null if it has none, can't be read or was
+     * written by a newer version.
+     */
+    fun readMetadata(file: File): JSONObject? = try {
+        ZipFile(file).use { zip ->
+            zip.getEntry(METADATA_ENTRY)?.let { entry ->
+                JSONObject(zip.getInputStream(entry).use { it.readBytes().toString(Charsets.UTF_8) })
+            }
+        }?.takeIf { it.optInt("version") in 1..VERSION }
+    } catch (e: Exception) {
+        null
+    }
+
+    /** Copy entry [entryName] of the pack [file] to [target]. False if it has no such entry. */
+    fun extract(file: File, entryName: String, target: File): Boolean =
+        ZipFile(file).use { zip ->
+            val entry = zip.getEntry(entryName) ?: return false
+            zip.getInputStream(entry).use { input -> target.outputStream().use { input.copyTo(it) } }
+            true
+        }
+
+    /** The bytes to store for [track]: small gzip data inflated, anything else as is. */
+    private fun readTrack(track: Entry): ByteArray {
+        val data = track.open().use { it.readBytes() }
+        if (data.size < 18 || data[0] != 0x1F.toByte() || data[1] != 0x8B.toByte()) return data
+        // ISIZE, the inflated length modulo 2^32, ends the gzip trailer
+        val inflated = ByteBuffer.wrap(data, data.size - 4, 4).order(ByteOrder.LITTLE_ENDIAN)
+            .int.toLong() and 0xFFFFFFFFL
+        if (inflated > INFLATE_LIMIT) return data
+        return try {
+            GZIPInputStream(ByteArrayInputStream(data)).use { it.readBytes() }
+        } catch (e: IOException) {
+            data
+        }
+    }
+
+    private fun putAligned(zos: ZipOutputStream, counter: CountingOutputStream, name: String,
+                           data: ByteArray) {
+        val entry = ZipEntry(name).apply {
+            method = ZipEntry.STORED
+            size = data.size.toLong()
+            compressedSize = data.size.toLong()
+            crc = CRC32().apply { update(data) }.value
+        }
+        // The data follows the local header, which ends with the name and extra field
+        val unpadded = counter.count + LOCAL_HEADER_SIZE + name.toByteArray(Charsets.UTF_8).size +
+            ALIGN_EXTRA_SIZE
+        val pad = ((PAGE_SIZE - unpadded % PAGE_SIZE) % PAGE_SIZE).toInt()
+        entry.extra = ByteBuffer.allocate(ALIGN_EXTRA_SIZE + pad).order(ByteOrder.LITTLE_ENDIAN)
+            .putShort(ALIGN_EXTRA_ID.toShort())
+            .putShort((ALIGN_EXTRA_SIZE - 4 + pad).toShort())
+            .putShort(PAGE_SIZE.toShort())
+            .array()
+        zos.putNextEntry(entry)
+        zos.write(data)
+        zos.closeEntry()
+    }
+
+    private class CountingOutputStream(out: OutputStream) : FilterOutputStream(out) {
+        var count = 0L
+            private set
+
+        override fun write(b: Int) {
+            out.write(b)
+            count++
+        }
+
+        override fun write(b: ByteArray, off: Int, len: Int) {
+            out.write(b, off, len)
+            count += len
+        }
+    }
+}
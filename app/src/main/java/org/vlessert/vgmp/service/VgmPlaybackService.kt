@@ -32,6 +32,7 @@ import kotlinx.coroutines.flow.asStateFlow
 import org.vlessert.vgmp.MainActivity
 import org.vlessert.vgmp.R
 import org.vlessert.vgmp.VgmServiceBinder
+import org.vlessert.vgmp.engine.EngineStatus
 import org.vlessert.vgmp.engine.VgmEngine
 import org.vlessert.vgmp.engine.VgmTags
 import org.vlessert.vgmp.library.Game
@@ -55,7 +56,10 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
         const val ACTION_STOP   = "org.vlessert.vgmp.ACTION_STOP"
         const val MEDIA_ID_ROOT = "root"
         private const val TAG = "VgmPlaybackService"
-        private const val FADE_MS = 2000L
+        private const val FADE_MS = 2000          // loop-count fade, applied natively
+        private const val SKIP_FADE_MS = 500L     // manual skip fade
+        private const val PREPARE_NEXT_MS = 5000L // open the next track this long before the end
+        private const val PREFETCH_TRACKS = 2     // upcoming tracks read ahead into the page cache
     }
 
     enum class ShuffleMode { OFF, GAME, ALL }
@@ -73,26 +77,40 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
     private var isPaused  = false
     private var shouldPlayAfterFocusGain = false
     private var shuffleMode = ShuffleMode.OFF
+        set(value) { field = value; nextPrepareRequested = false; prefetchUpcoming() }
     private var loopMode = LoopMode.OFF
+        set(value) { field = value; nextPrepareRequested = false; prefetchUpcoming() }
     private var currentTags = VgmTags()
     private var trackDurationMs = 0L
 
-    // For fade out
-    private var fadeStartTimeMs = 0L
+    // Manual skip fade in progress (the fade itself runs in the native engine)
     private var isFadingOut = false
     private var currentVolume = 1.0f
     
     // Endless loop mode
     private var endlessLoopMode = false
 
+    // Gapless handover: the engine holds the next track opened and pre-rolled, and switches
+    // to it by itself at the end of the current one (EVENT_TRACK_CHANGED). The render loop
+    // requests the prepare and reads the result; prepareJob does the work.
+    private class PreparedTrack(val gameIdx: Int, val trackIdx: Int, val game: Game, val track: TrackEntity)
+    @Volatile private var nextPrepareRequested = false
+    @Volatile private var preparedNext: PreparedTrack? = null
+    private var prepareJob: Job? = null
+    private var crossfadeMs = 0
+
     // Render thread
     private val _spectrum = MutableStateFlow(FloatArray(512))
     val spectrum: StateFlow<FloatArray> = _spectrum.asStateFlow()
-    private val spectrumBuffer = FloatArray(512)
+    private val statusSnapshot = EngineStatus.Snapshot()
     
     // Channel spectrums thread
     private val _channelSpectrums = MutableStateFlow<FloatArray?>(null)
     val channelSpectrums: StateFlow<FloatArray?> = _channelSpectrums.asStateFlow()
+
+    // Per-channel peak/RMS levels for formats without channel spectrums
+    private val _channelLevels = MutableStateFlow<FloatArray?>(null)
+    val channelLevels: StateFlow<FloatArray?> = _channelLevels.asStateFlow()
     
     private var lastSpectrumUpdateMs = 0L
     private val SPECTRUM_UPDATE_INTERVAL_MS = 33L // ~30 fps for smoother UI
@@ -137,6 +155,7 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
         // Load bundled assets + populate library
         serviceScope.launch {
             VgmEngine.setSampleRate(SAMPLE_RATE) // Use thread-safe version
+            VgmEngine.setFadeLength(FADE_MS)
             extractRoms()
             loadBundledAssets()
             allGames = GameLibrary.getAllGames()
@@ -177,20 +196,7 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
     private suspend fun extractRoms() = withContext(Dispatchers.IO) {
         val romsDir = File(filesDir, "roms").also { it.mkdirs() }
         
-        // Extract yrw801.rom for libvgm
-        val romFileName = "yrw801.rom"
-        val destFile = File(romsDir, romFileName)
-        if (!destFile.exists()) {
-            try {
-                assets.open(romFileName).use { input ->
-                    destFile.outputStream().use { output ->
-                        input.copyTo(output)
-                    }
-                }
-            } catch (e: Exception) {
-                Log.e(TAG, "Failed to extract $romFileName", e)
-            }
-        }
+        // yrw801.rom (YMF278B) is read by libvgm straight from the APK
         
         // Extract GENMIDI.lmp for libMusDoom (Doom MUS playback)
         val genmidiFileName = "GENMIDI.lmp"
@@ -410,6 +416,14 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
     }
 
     private suspend fun startTrackWithFocus(game: Game, track: TrackEntity) {
+        // Loop count decides where the native fade-out starts; set it before open plans the ending
+        VgmEngine.setLoopCount(SettingsManager.getLoopCount(applicationContext))
+        crossfadeMs = SettingsManager.getCrossfade(applicationContext) * 1000
+        VgmEngine.setCrossfade(crossfadeMs)
+        // Opening drops any prepared next track in the engine
+        prepareJob?.cancel()
+        nextPrepareRequested = false
+        preparedNext = null
         val opened = VgmEngine.open(track.filePath)
         if (!opened) {
             Log.e(TAG, "Failed to open ${track.filePath}")
@@ -432,12 +446,35 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
             }
         }
 
+        // Open resets the loudness gain to unity
+        VgmEngine.setTrackGain(GameLibrary.getReplayGainDb(track))
+
         // Reset endless loop mode when starting a new track
         if (endlessLoopMode) {
             endlessLoopMode = false
             VgmEngine.setEndlessLoop(false)
         }
 
+        loadTrackInfo(game, track)
+
+        // Start audio track and render loop
+        isPlaying = true
+        isPaused  = false
+        playbackStartTimeMs = SystemClock.elapsedRealtime()
+        pausedPositionMs    = 0L
+
+        audioTrack?.release()
+        audioTrack = createAudioTrack().also { it.play() }
+
+        startRenderJob()
+        updatePlaybackState(PlaybackStateCompat.STATE_PLAYING)
+        startForeground(NOTIF_ID, buildNotification(true))
+        _playbackState.value = PlaybackInfo(true, false, currentGameIdx, currentTrackIdx, track, trackDurationMs)
+        prefetchUpcoming()
+    }
+
+    /** Tags, duration and session metadata of the track now loaded in the engine. */
+    private suspend fun loadTrackInfo(game: Game, track: TrackEntity) {
         // Parse tags from VGM file
         val rawTags = VgmEngine.getTags()
         val parsedTags = VgmEngine.parseTags(rawTags)
@@ -467,20 +504,89 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
 
         // Update MediaSession metadata (→ AVRCP 1.6)
         updateMediaSessionMetadata()
+    }
 
-        // Start audio track and render loop
-        isPlaying = true
-        isPaused  = false
-        playbackStartTimeMs = SystemClock.elapsedRealtime()
-        pausedPositionMs    = 0L
-
-        audioTrack?.release()
-        audioTrack = createAudioTrack().also { it.play() }
+    /**
+     * Open the track that will follow this one in the engine, so it can take over without a gap.
+     * Runs in its own coroutine on the main thread: the library reload and gain lookup must not
+     * hold up the render loop, which only picks up [preparedNext].
+     */
+    private fun launchPrepareNext() {
+        prepareJob?.cancel()
+        prepareJob = serviceScope.launch {
+            if (loopMode == LoopMode.OFF) allGames = GameLibrary.getAllGames()
+            val (gi, ti) = chooseTrackAfterEnd() ?: return@launch
+            val game = allGames.getOrNull(gi) ?: return@launch
+            val track = game.tracks.getOrNull(ti) ?: return@launch
+            val gainDb = GameLibrary.getReplayGainDb(track)
+            // Blocking JNI; the render loop keeps writing what it has until the engine is free
+            val prepared = withContext(Dispatchers.IO) {
+                VgmEngine.prepareNext(track.filePath, track.subTrackIndex, gainDb)
+            }
+            preparedNext = if (prepared) PreparedTrack(gi, ti, game, track) else null
+        }
+    }
 
-        startRenderJob()
+    /**
+     * The engine switched to the prepared track at the end of the previous one. [startSample]
+     * is how far the new track already played (the crossfade window).
+     */
+    private suspend fun onNextTrackStarted(startSample: Long) {
+        val next = preparedNext ?: return
+        preparedNext = null
+        nextPrepareRequested = false
+        val track = next.track
+        currentGameIdx = next.gameIdx
+        currentTrackIdx = next.trackIdx
+        loadTrackInfo(next.game, track)
+        // startSample is track time; at a changed speed it took startSample / speed to play
+        val speed = VgmEngine.getPlaybackSpeed().takeIf { it > 0.0 } ?: 1.0
+        val playedMs = (startSample * 1000L / SAMPLE_RATE / speed).toLong()
+        playbackStartTimeMs = SystemClock.elapsedRealtime() - playedMs
+        pausedPositionMs = 0L
         updatePlaybackState(PlaybackStateCompat.STATE_PLAYING)
-        startForeground(NOTIF_ID, buildNotification(true))
-        _playbackState.value = PlaybackInfo(true, false, currentGameIdx, currentTrackIdx, track, trackDurationMs)
+        updateNotification(true)
+        _playbackState.value = PlaybackInfo(true, false, next.gameIdx, next.trackIdx, track, trackDurationMs)
+        prefetchUpcoming()
+    }
+
+    /**
+     * Have the engine read the files of the next [PREFETCH_TRACKS] tracks into the page cache
+     * while this one plays, so opening them reads no cold storage. Each call replaces the
+     * previous list, so changing track or play order cancels reads no longer needed.
+     */
+    private fun prefetchUpcoming() {
+        if (!isPlaying) return
+        VgmEngine.prefetch(upcomingTracks(PREFETCH_TRACKS).map { it.filePath }.distinct())
+    }
+
+    /**
+     * Tracks that will follow the current one as it ends by itself (see [chooseTrackAfterEnd]),
+     * as far as that order is known in advance: none when shuffled or in favorites-only mode.
+     */
+    private fun upcomingTracks(count: Int): List<TrackEntity> {
+        if (loopMode == LoopMode.TRACK) return emptyList()
+        if (loopMode == LoopMode.OFF &&
+            (shuffleMode != ShuffleMode.OFF || SettingsManager.isFavoritesOnlyMode(applicationContext))) {
+            return emptyList()
+        }
+        val upcoming = mutableListOf<TrackEntity>()
+        var gi = currentGameIdx
+        var ti = currentTrackIdx
+        while (upcoming.size < count) {
+            val game = allGames.getOrNull(gi) ?: break
+            if (ti + 1 < game.tracks.size) {
+                ti++
+            } else if (loopMode == LoopMode.GAME) {
+                ti = 0
+            } else {
+                gi = (gi + 1) % allGames.size
+                ti = 0
+            }
+            if (gi == currentGameIdx && ti == currentTrackIdx) break
+            upcoming += allGames.getOrNull(gi)?.tracks?.getOrNull(ti) ?: break
+        }
+        return upcoming
     }
 
     // Position update tracking
@@ -489,6 +595,8 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
 
     private fun startRenderJob() {
         renderJob = serviceScope.launch(Dispatchers.IO) {
+            val status = VgmEngine.status
+            status?.skipEvents()
             try {
                 while (isActive && isPlaying) {
                     if (isPaused) {
@@ -496,24 +604,45 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
                         continue
                     }
                     val framesWritten = VgmEngine.fillBuffer(renderBuffer, BUFFER_FRAMES)
+
+                    // Engine events; on END the buffer already stops at the last sample of the track
+                    var streamEnded = false
+                    var nextStartedAt = -1L
+                    status?.pollEvents { type, arg, sample ->
+                        when (type) {
+                            EngineStatus.EVENT_END -> streamEnded = true
+                            EngineStatus.EVENT_TRACK_CHANGED -> nextStartedAt = sample
+                            EngineStatus.EVENT_XFADE_OVERLOAD -> onCrossfadeOverload(arg)
+                            EngineStatus.EVENT_LOOP -> Log.d(TAG, "Loop $arg reached at sample $sample")
+                            EngineStatus.EVENT_UNDERRUN -> Log.w(TAG, "Engine underrun: $arg frames short at sample $sample")
+                            EngineStatus.EVENT_PSF_READY -> Log.d(TAG, "PSF initial buffer ready")
+                        }
+                    }
                     if (framesWritten > 0) {
-                        applyVolumeAndFade(renderBuffer, framesWritten)
                         audioTrack?.write(renderBuffer, 0, framesWritten * 2)
 
-                        // Update spectrum for UI
+                        // Update spectrum for UI from the shared status block (no JNI round-trips)
                         val nowSpectrum = SystemClock.elapsedRealtime()
                         if (nowSpectrum - lastSpectrumUpdateMs >= SPECTRUM_UPDATE_INTERVAL_MS) {
                             lastSpectrumUpdateMs = nowSpectrum
-                            VgmEngine.getSpectrum(spectrumBuffer)
-                            _spectrum.emit(spectrumBuffer.copyOf())
-                            // Channel levels for KSS
-                            val trackPath = _playbackState.value.track?.filePath ?: ""
-                            if (trackPath.endsWith(".kss", ignoreCase = true) ||
-                                trackPath.endsWith(".mgs", ignoreCase = true)) {
-                                val spectrums = VgmEngine.getChannelSpectrums()
-                                _channelSpectrums.emit(spectrums)
-                            } else {
-                                _channelSpectrums.emit(null)
+                            if (status != null && status.read(statusSnapshot)) {
+                                _spectrum.emit(statusSnapshot.spectrum.copyOf())
+                                // Per-channel level meters from the engine's taps; the per-channel
+                                // spectrums KSS also publishes only show if there are no levels
+                                val levels = statusSnapshot.levelsOrNull()
+                                _channelLevels.emit(levels)
+                                _channelSpectrums.emit(if (levels == null) statusSnapshot.channelSpectrumOrNull() else null)
+
+                                // Close to the end: have the engine open the next track ahead of time,
+                                // a whole crossfade before the window so the incoming side can be
+                                // pre-rendered at 1:1 before the window opens
+                                val remaining = statusSnapshot.totalSamples - statusSnapshot.currentSample
+                                if (!nextPrepareRequested && !endlessLoopMode && !isFadingOut &&
+                                    statusSnapshot.totalSamples > 0 &&
+                                    remaining < (PREPARE_NEXT_MS + 2L * crossfadeMs) * SAMPLE_RATE / 1000) {
+                                    nextPrepareRequested = true
+                                    serviceScope.launch { launchPrepareNext() }
+                                }
                             }
                         }
                     } else {
@@ -530,18 +659,18 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
                         updatePlaybackState(PlaybackStateCompat.STATE_PLAYING)
                     }
                     
-                    // Skip fade out and track end detection in endless loop mode
-                    if (endlessLoopMode) continue
-                    
-                    // Trigger fade out before actual end if we know the duration
-                    val pos = currentPositionMs()
-                    if (trackDurationMs > 0 && pos >= trackDurationMs - FADE_MS && !isFadingOut) {
-                        startFadeOut()
+                    // The prepared track already continued in this buffer; only the metadata changes
+                    if (nextStartedAt >= 0) {
+                        onNextTrackStarted(nextStartedAt)
+                        continue
                     }
 
-                    // Check if track ended
-                    if (VgmEngine.isEnded() || (isFadingOut && SystemClock.elapsedRealtime() >= fadeStartTimeMs + FADE_MS)) {
-                        onTrackEnded()
+                    // Check if track ended (event-driven; poll only if the status block is missing).
+                    // The engine fades and ends the track itself after the configured loop count.
+                    val ended = streamEnded || (status == null && !endlessLoopMode && VgmEngine.isEnded())
+                    if (ended) {
+                        // A manual skip already queued the next track once its fade finishes
+                        if (!isFadingOut) onTrackEnded()
                         break
                     }
                 }
@@ -551,23 +680,6 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
         }
     }
 
-    private fun startFadeOut() {
-        if (isFadingOut) return
-        isFadingOut = true
-        fadeStartTimeMs = SystemClock.elapsedRealtime()
-    }
-
-    private fun applyVolumeAndFade(buffer: ShortArray, frames: Int) {
-        if (!isFadingOut) return
-        
-        val elapsed = SystemClock.elapsedRealtime() - fadeStartTimeMs
-        val fadeFactor = (1.0f - (elapsed.toFloat() / FADE_MS)).coerceIn(0f, 100f)
-        
-        for (i in 0 until (frames * 2)) {
-            buffer[i] = (buffer[i] * fadeFactor).toInt().toShort()
-        }
-    }
-
     private fun stopRenderJob() {
         renderJob?.cancel()
         renderJob = null
@@ -577,23 +689,31 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
     }
 
     private suspend fun onTrackEnded() {
-        when (loopMode) {
-            LoopMode.TRACK -> {
-                // Restart same track
-                val game = allGames.getOrNull(currentGameIdx) ?: return
-                val track = game.tracks.getOrNull(currentTrackIdx) ?: return
-                startTrack(game, track)
-            }
-            LoopMode.GAME -> {
-                // Next track in same game, loop to start if at end
-                val game = allGames.getOrNull(currentGameIdx) ?: return
-                val nextT = if (currentTrackIdx + 1 < game.tracks.size) currentTrackIdx + 1 else 0
-                loadAndPlay(currentGameIdx, nextT)
-            }
-            LoopMode.OFF -> {
-                nextTrack()
-            }
+        // The track has already faded out in the engine, move on immediately
+        if (loopMode == LoopMode.OFF) allGames = GameLibrary.getAllGames()
+        val (gi, ti) = chooseTrackAfterEnd() ?: return
+        loadAndPlay(gi, ti)
+    }
+
+    /** Two emulators at once were too much for this device; the engine fell back to a plain handover. */
+    private fun onCrossfadeOverload(loadPercent: Int) {
+        Log.w(TAG, "Crossfade needs $loadPercent% of real time, skipping it")
+        serviceScope.launch {
+            Toast.makeText(applicationContext, "Crossfade skipped: device too slow for two tracks at once", Toast.LENGTH_SHORT).show()
+        }
+    }
+
+    /** Track that follows when the current one ends by itself. */
+    private fun chooseTrackAfterEnd(): Pair<Int, Int>? = when (loopMode) {
+        // Restart same track
+        LoopMode.TRACK -> currentGameIdx to currentTrackIdx
+        LoopMode.GAME -> {
+            // Next track in same game, loop to start if at end
+            val game = allGames.getOrNull(currentGameIdx)
+            if (game == null) null
+            else currentGameIdx to (if (currentTrackIdx + 1 < game.tracks.size) currentTrackIdx + 1 else 0)
         }
+        LoopMode.OFF -> chooseNextTrack()
     }
 
     private fun resumeOrPlay() {
@@ -628,6 +748,8 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
         isPlaying = false
         isPaused  = false
         stopRenderJob()
+        prepareJob?.cancel()
+        VgmEngine.prefetch(emptyList())
         serviceScope.launch {
             VgmEngine.stop()
             VgmEngine.close()
@@ -648,12 +770,13 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
 
     fun nextTrack() {
         if (!isFadingOut) {
-            // Manual skip - maybe smaller fade or immediate?
-            // User requested fade out to next track.
+            // Manual skip: short native fade, then the next track
+            isFadingOut = true
             serviceScope.launch {
-                startFadeOut()
-                delay(500) // Short fade for manual skip
+                VgmEngine.fadeOut(SKIP_FADE_MS.toInt())
+                delay(SKIP_FADE_MS)
                 performNextTrack()
+                isFadingOut = false
             }
         } else {
             serviceScope.launch { performNextTrack() }
@@ -662,11 +785,16 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
 
     private suspend fun performNextTrack() {
         allGames = GameLibrary.getAllGames()
-        if (allGames.isEmpty()) return
+        val (nextG, nextT) = chooseNextTrack() ?: return
+        loadAndPlay(nextG, nextT)
+    }
+
+    private fun chooseNextTrack(): Pair<Int, Int>? {
+        if (allGames.isEmpty()) return null
         
         val favoritesOnly = SettingsManager.isFavoritesOnlyMode(applicationContext)
         
-        val (nextG, nextT) = when (shuffleMode) {
+        return when (shuffleMode) {
             ShuffleMode.ALL -> {
                 if (favoritesOnly) {
                     // Favorites only: only pick from favorite games and tracks
@@ -674,7 +802,7 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
                     if (favoriteGames.isEmpty()) {
                         // No favorite games, fall back to all games with favorite tracks
                         val gamesWithFavTracks = allGames.filter { game -> game.tracks.any { it.isFavorite } }
-                        if (gamesWithFavTracks.isEmpty()) return // No favorites at all
+                        if (gamesWithFavTracks.isEmpty()) return null // No favorites at all
                         val game = gamesWithFavTracks.random()
                         val favTracks = game.tracks.filter { it.isFavorite }
                         val ti = game.tracks.indexOf(favTracks.random())
@@ -712,7 +840,7 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
                     if (favTracks.isEmpty()) {
                         // No favorite tracks in this game, move to next game with favorites
                         val gamesWithFavTracks = allGames.filter { g -> g.tracks.any { it.isFavorite } }
-                        if (gamesWithFavTracks.isEmpty()) return
+                        if (gamesWithFavTracks.isEmpty()) return null
                         val nextGame = gamesWithFavTracks.random()
                         val nextFavTracks = nextGame.tracks.filter { it.isFavorite }
                         val ti = nextGame.tracks.indexOf(nextFavTracks.random())
@@ -750,7 +878,6 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
                 }
             }
         }
-        loadAndPlay(nextG, nextT)
     }
     
     private fun findNextFavoriteTrack(): Pair<Int, Int> {
@@ -856,7 +983,10 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
 
     private fun seekTo(posMs: Long) {
         val samplePos = posMs * SAMPLE_RATE / 1000L
-        serviceScope.launch { VgmEngine.seek(samplePos) }
+        serviceScope.launch {
+            VgmEngine.seek(samplePos)
+            nextPrepareRequested = false // the engine dropped the prepared track
+        }
         pausedPositionMs = posMs
         playbackStartTimeMs = SystemClock.elapsedRealtime() - posMs
         updatePlaybackState(if (isPaused) PlaybackStateCompat.STATE_PAUSED
@@ -1121,6 +1251,8 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
     // Endless loop mode - track plays forever without ending
     fun setEndlessLoop(enabled: Boolean) {
         endlessLoopMode = enabled
+        // Endless mode drops a prepared next track; prepare again once it is off
+        nextPrepareRequested = false
         serviceScope.launch(Dispatchers.IO) {
             VgmEngine.setEndlessLoop(enabled)
         }
@@ -1191,23 +1323,19 @@ class VgmPlaybackService : MediaBrowserServiceCompat() {
     }
     
     /**
-     * Check if the current track supports playback speed control.
-     * KSS, tracker formats (MOD, XM, S3M, IT), MIDI, and MUS don't support speed control.
+     * Check if the current track supports playback speed control. The engine's time stretch
+     * works on the final output, so every format can be slowed down.
      */
-    fun isSpeedControlSupported(): Boolean {
-        val track = currentTrack ?: return false
-        val path = track.filePath.lowercase()
-        // KSS files
-        if (path.endsWith(".kss")) return false
-        // Tracker formats
-        if (path.endsWith(".mod") || path.endsWith(".xm") || 
-            path.endsWith(".s3m") || path.endsWith(".it") ||
-            path.endsWith(".mptm")) return false
-        // MIDI files
-        if (path.endsWith(".mid") || path.endsWith(".midi") ||
-            path.endsWith(".rmi") || path.endsWith(".smf")) return false
-        // MUS files (Doom music)
-        if (path.endsWith(".mus") || path.endsWith(".lmp")) return false
-        return true
+    fun isSpeedControlSupported(): Boolean = currentTrack != null
+
+    /**
+     * Shift the key by [semitones] (-12..12) for this and every following track. The engine
+     * drops the prepared next track, since it was opened in the old key.
+     */
+    fun setTranspose(semitones: Int) {
+        serviceScope.launch {
+            VgmEngine.setTranspose(semitones)
+            nextPrepareRequested = false
+        }
     }
 }
@@ -8,13 +8,28 @@ object SettingsManager {
     private const val KEY_ANALYZER_ENABLED = "analyzer_enabled"
     private const val KEY_TRANSPARENCY_LEVEL = "transparency_level"
     private const val KEY_FADE_TIMEOUT = "fade_timeout"
+    private const val KEY_LOOP_COUNT = "loop_count"
+    private const val KEY_CROSSFADE = "crossfade_seconds"
+    const val MAX_CROSSFADE_SECONDS = 10 // the settings slider's range; the engine clamps alike
     private const val KEY_FAVORITES_ONLY_MODE = "favorites_only_mode"
     private const val KEY_ANALYZER_STYLE = "analyzer_style"
     private const val KEY_ENABLED_TYPE_GROUPS = "enabled_type_groups"
+    private const val KEY_REPLAY_GAIN_MODE = "replay_gain_mode"
+    private const val KEY_VGZ_CACHE_MB = "vgz_cache_mb"
 
     const val ANALYZER_STYLE_KALEIDOSCOPE = "kaleidoscope"
     const val ANALYZER_STYLE_BARS = "bars"
 
+    const val REPLAY_GAIN_OFF = "off"
+    const val REPLAY_GAIN_TRACK = "track"
+    const val REPLAY_GAIN_GAME = "game"
+    // Level tracks are moved to (ReplayGain 2.0 reference)
+    const val REPLAY_GAIN_TARGET_LUFS = -18f
+
+    // Size steps of the decompressed .vgz cache setting
+    const val VGZ_CACHE_STEP_MB = 64
+    const val VGZ_CACHE_MAX_MB = 512
+
     const val TYPE_GROUP_VGM = "vgm"
     const val TYPE_GROUP_GME = "gme"
     const val TYPE_GROUP_KSS = "kss"
@@ -63,6 +78,32 @@ object SettingsManager {
         getPrefs(context).edit().putInt(KEY_FADE_TIMEOUT, timeout.coerceIn(0, 60)).apply()
     }
     
+    fun getLoopCount(context: Context): Int {
+        return getPrefs(context).getInt(KEY_LOOP_COUNT, 2) // loop passes before fade-out, default 2
+    }
+
+    fun setLoopCount(context: Context, loops: Int) {
+        getPrefs(context).edit().putInt(KEY_LOOP_COUNT, loops.coerceIn(1, 8)).apply()
+    }
+
+    fun getCrossfade(context: Context): Int {
+        return getPrefs(context).getInt(KEY_CROSSFADE, 0) // seconds, 0 = gapless without crossfade
+    }
+
+    fun setCrossfade(context: Context, seconds: Int) {
+        getPrefs(context).edit().putInt(KEY_CROSSFADE, seconds.coerceIn(0, MAX_CROSSFADE_SECONDS)).apply()
+    }
+
+    fun getVgzCacheMb(context: Context): Int {
+        return getPrefs(context).getInt(KEY_VGZ_CACHE_MB, 2 * VGZ_CACHE_STEP_MB) // 0 = off
+    }
+
+    fun setVgzCacheMb(context: Context, megabytes: Int) {
+        getPrefs(context).edit().putInt(KEY_VGZ_CACHE_MB, megabytes.coerceIn(0, VGZ_CACHE_MAX_MB)).apply()
+    }
+
+    fun getVgzCacheBytes(context: Context): Long = getVgzCacheMb(context) * 1024L * 1024L
+
     fun isFavoritesOnlyMode(context: Context): Boolean {
         return getPrefs(context).getBoolean(KEY_FAVORITES_ONLY_MODE, false)
     }
@@ -80,6 +121,15 @@ object SettingsManager {
         getPrefs(context).edit().putString(KEY_ANALYZER_STYLE, style).apply()
     }
 
+    fun getReplayGainMode(context: Context): String {
+        return getPrefs(context).getString(KEY_REPLAY_GAIN_MODE, REPLAY_GAIN_TRACK)
+            ?: REPLAY_GAIN_TRACK
+    }
+
+    fun setReplayGainMode(context: Context, mode: String) {
+        getPrefs(context).edit().putString(KEY_REPLAY_GAIN_MODE, mode).apply()
+    }
+
     fun getEnabledTypeGroups(context: Context): Set<String> {
         val stored = getPrefs(context).getStringSet(KEY_ENABLED_TYPE_GROUPS, null)
         return stored ?: DEFAULT_TYPE_GROUPS
@@ -37,6 +37,9 @@ class NowPlayingFragment : BottomSheetDialogFragment() {
     // Playback speed options: 100%, 75%, 50%, 25%
     private val speedOptions = doubleArrayOf(1.0, 0.75, 0.5, 0.25)
     private var currentSpeedIndex = 0
+
+    // Key change in semitones: tap raises, long press lowers
+    private var currentTranspose = 0
     
     // Soloed channels tracking
     private val soloedChannels = mutableSetOf<Int>()
@@ -111,12 +114,52 @@ class NowPlayingFragment : BottomSheetDialogFragment() {
                 updateChannelSpectrums(spectrums)
             }
         }
+
+        viewLifecycleOwner.lifecycleScope.launch {
+            svc.channelLevels.collectLatest { levels ->
+                if (levels != null) updateChannelLevels(levels)
+            }
+        }
+    }
+
+    private fun updateChannelLevels(levels: FloatArray) {
+        val container = binding.channelsMeterContainer
+        if (levels.isEmpty()) {
+            container.visibility = View.GONE
+            return
+        }
+
+        container.visibility = View.VISIBLE
+
+        val VALUES_PER_CH = 2 // [peak, rms]
+        val channelCount = levels.size / VALUES_PER_CH
+
+        if (container.childCount != channelCount) {
+            container.removeAllViews()
+
+            viewLifecycleOwner.lifecycleScope.launch {
+                val labels = VgmEngine.getChannelLevelLabels()
+                for (i in 0 until channelCount) {
+                    val view = layoutInflater.inflate(R.layout.item_vu_meter, container, false)
+                    val tvName = view.findViewById<TextView>(R.id.tv_channel_name)
+                    tvName.text = labels.getOrElse(i) { "" }
+                    container.addView(view)
+                }
+            }
+        } else {
+            for (i in 0 until channelCount) {
+                val view = container.getChildAt(i) ?: continue
+                val meterView = view.findViewById<ChannelSpectrumView>(R.id.channel_spectrum)
+                meterView.setLevel(levels[i * VALUES_PER_CH], levels[i * VALUES_PER_CH + 1])
+            }
+        }
     }
 
     private fun updateChannelSpectrums(spectrums: FloatArray?) {
         val container = binding.channelsMeterContainer
         if (spectrums == null || spectrums.isEmpty()) {
-            container.visibility = View.GONE
+            // Levels-only formats drive the same container via updateChannelLevels()
+            if (service?.channelLevels?.value == null) container.visibility = View.GONE
             return
         }
 
@@ -236,6 +279,21 @@ class NowPlayingFragment : BottomSheetDialogFragment() {
                 showStyledToast("Speed: $speedPercent%")
             }
         }
+        binding.btnTranspose.setOnClickListener { changeTranspose(1) }
+        binding.btnTranspose.setOnLongClickListener {
+            changeTranspose(-1)
+            true
+        }
+    }
+
+    private fun changeTranspose(step: Int) {
+        val svc = service ?: return
+        val semitones = (currentTranspose + step).coerceIn(-12, 12)
+        if (semitones == currentTranspose) return
+        currentTranspose = semitones
+        svc.setTranspose(semitones)
+        updateTransposeButton()
+        showStyledToast(if (semitones == 0) "Original key" else "Key: %+d".format(semitones))
     }
 
     private fun setupSeekbar() {
@@ -411,6 +469,7 @@ class NowPlayingFragment : BottomSheetDialogFragment() {
         
         // Update speed button
         updateSpeedButton()
+        updateTransposeButton()
     }
 
     private fun updateTrackFavoriteButton() {
@@ -454,7 +513,7 @@ class NowPlayingFragment : BottomSheetDialogFragment() {
         val binding = _binding ?: return
         val svc = service
         
-        // Hide speed button for KSS and tracker formats
+        // Hide speed button while nothing is loaded
         if (svc != null && !svc.isSpeedControlSupported()) {
             binding.btnSpeed.visibility = View.GONE
             return
@@ -475,6 +534,20 @@ class NowPlayingFragment : BottomSheetDialogFragment() {
         }
     }
 
+    private fun updateTransposeButton() {
+        val binding = _binding ?: return
+        val svc = service
+        binding.btnTranspose.visibility =
+            if (svc != null && svc.currentTrack == null) View.GONE else View.VISIBLE
+        if (currentTranspose == 0) {
+            binding.btnTranspose.setColorFilter(resources.getColor(R.color.vgmp_text_secondary, null))
+            binding.btnTranspose.alpha = 0.5f
+        } else {
+            binding.btnTranspose.setColorFilter(resources.getColor(R.color.vgmp_accent, null))
+            binding.btnTranspose.alpha = 1.0f
+        }
+    }
+
     private fun showStyledToast(message: String) {
         val context = context ?: return
         val inflater = LayoutInflater.from(context)
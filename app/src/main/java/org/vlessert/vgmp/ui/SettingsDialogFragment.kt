@@ -11,6 +11,7 @@ import androidx.lifecycle.lifecycleScope
 import org.vlessert.vgmp.MainActivity
 import org.vlessert.vgmp.R
 import org.vlessert.vgmp.databinding.FragmentSettingsBinding
+import org.vlessert.vgmp.engine.VgmEngine
 import org.vlessert.vgmp.library.GameLibrary
 import org.vlessert.vgmp.settings.SettingsManager
 import java.io.File
@@ -65,6 +66,29 @@ class SettingsDialogFragment : DialogFragment() {
         binding.seekbarFadeTimeout.progress = fadeTimeout
         binding.tvFadeTimeoutValue.text = "${fadeTimeout}s"
         
+        // Loop count
+        val loopCount = SettingsManager.getLoopCount(context)
+        binding.seekbarLoopCount.progress = loopCount
+        binding.tvLoopCountValue.text = "${loopCount}x"
+
+        // Crossfade
+        val crossfade = SettingsManager.getCrossfade(context)
+        binding.seekbarCrossfade.progress = crossfade
+        binding.tvCrossfadeValue.text = if (crossfade > 0) "${crossfade}s" else "Off"
+
+        // Decompressed VGZ cache
+        val vgzCacheMb = SettingsManager.getVgzCacheMb(context)
+        binding.seekbarVgzCache.max = SettingsManager.VGZ_CACHE_MAX_MB / SettingsManager.VGZ_CACHE_STEP_MB
+        binding.seekbarVgzCache.progress = vgzCacheMb / SettingsManager.VGZ_CACHE_STEP_MB
+        binding.tvVgzCacheValue.text = if (vgzCacheMb > 0) "$vgzCacheMb MB" else "Off"
+
+        // Volume normalisation
+        when (SettingsManager.getReplayGainMode(context)) {
+            SettingsManager.REPLAY_GAIN_OFF -> binding.radioReplayGainOff.isChecked = true
+            SettingsManager.REPLAY_GAIN_GAME -> binding.radioReplayGainGame.isChecked = true
+            else -> binding.radioReplayGainTrack.isChecked = true
+        }
+
         // Favorites only mode
         binding.switchFavoritesOnly.isChecked = SettingsManager.isFavoritesOnlyMode(context)
 
@@ -130,6 +154,54 @@ class SettingsDialogFragment : DialogFragment() {
             override fun onStopTrackingTouch(seekBar: SeekBar?) {}
         })
 
+        binding.seekbarLoopCount.setOnSeekBarChangeListener(object : SeekBar.OnSeekBarChangeListener {
+            override fun onProgressChanged(seekBar: SeekBar?, progress: Int, fromUser: Boolean) {
+                binding.tvLoopCountValue.text = "${progress}x"
+                if (fromUser) {
+                    SettingsManager.setLoopCount(context, progress)
+                }
+            }
+            override fun onStartTrackingTouch(seekBar: SeekBar?) {}
+            override fun onStopTrackingTouch(seekBar: SeekBar?) {}
+        })
+
+        binding.seekbarCrossfade.setOnSeekBarChangeListener(object : SeekBar.OnSeekBarChangeListener {
+            override fun onProgressChanged(seekBar: SeekBar?, progress: Int, fromUser: Boolean) {
+                binding.tvCrossfadeValue.text = if (progress > 0) "${progress}s" else "Off"
+                if (fromUser) {
+                    SettingsManager.setCrossfade(context, progress)
+                }
+            }
+            override fun onStartTrackingTouch(seekBar: SeekBar?) {}
+            override fun onStopTrackingTouch(seekBar: SeekBar?) {}
+        })
+
+        binding.seekbarVgzCache.setOnSeekBarChangeListener(object : SeekBar.OnSeekBarChangeListener {
+            override fun onProgressChanged(seekBar: SeekBar?, progress: Int, fromUser: Boolean) {
+                val megabytes = progress * SettingsManager.VGZ_CACHE_STEP_MB
+                binding.tvVgzCacheValue.text = if (megabytes > 0) "$megabytes MB" else "Off"
+                if (fromUser) {
+                    SettingsManager.setVgzCacheMb(context, megabytes)
+                }
+            }
+            override fun onStartTrackingTouch(seekBar: SeekBar?) {}
+            // Shrinking the cap deletes entries, so apply it once the thumb is let go
+            override fun onStopTrackingTouch(seekBar: SeekBar?) {
+                VgmEngine.setVgzCache(File(context.cacheDir, VgmEngine.VGZ_CACHE_DIR),
+                    SettingsManager.getVgzCacheBytes(context))
+            }
+        })
+
+        // Takes effect from the next track
+        binding.radioReplayGain.setOnCheckedChangeListener { _, checkedId ->
+            val mode = when (checkedId) {
+                R.id.radio_replay_gain_off -> SettingsManager.REPLAY_GAIN_OFF
+                R.id.radio_replay_gain_game -> SettingsManager.REPLAY_GAIN_GAME
+                else -> SettingsManager.REPLAY_GAIN_TRACK
+            }
+            SettingsManager.setReplayGainMode(context, mode)
+        }
+
         // Import/Export buttons
         binding.btnImport.setOnClickListener {
             showImportFilePicker()
@@ -32,6 +32,7 @@ class ChannelSpectrumView @JvmOverloads constructor(
     private var gradient: LinearGradient? = null
 
     fun setSpectrum(levels: FloatArray, offset: Int) {
+        levelMode = false
         for (i in 0 until NUM_BANDS) {
             val l = levels[offset + i].coerceIn(0f, 1f)
             if (l < buffer[i]) {
@@ -43,6 +44,24 @@ class ChannelSpectrumView @JvmOverloads constructor(
         invalidate()
     }
 
+    // Single-bar VU mode (peak/RMS meters for formats without channel spectrums)
+    private var levelMode = false
+    private var rmsLevel = 0f
+    private var peakLevel = 0f
+    private val peakPaint = Paint(Paint.ANTI_ALIAS_FLAG).apply {
+        style = Paint.Style.FILL
+        color = 0xFFFFFFFF.toInt()
+    }
+
+    fun setLevel(peak: Float, rms: Float) {
+        levelMode = true
+        val r = rms.coerceIn(0f, 1f)
+        rmsLevel = if (r < rmsLevel) rmsLevel * 0.82f + r * 0.18f else r
+        val p = peak.coerceIn(0f, 1f)
+        peakLevel = if (p < peakLevel) peakLevel * 0.95f else p  // slow peak hold
+        invalidate()
+    }
+
     override fun onDraw(canvas: Canvas) {
         super.onDraw(canvas)
 
@@ -64,6 +83,17 @@ class ChannelSpectrumView @JvmOverloads constructor(
 
         barPaint.shader = gradient
 
+        if (levelMode) {
+            canvas.drawRect(0f, 0f, w, h, dimPaint)
+            val barHeight = rmsLevel * h
+            if (barHeight > 0) {
+                canvas.drawRect(0f, h - barHeight, w, h, barPaint)
+            }
+            val peakY = h - peakLevel * h
+            canvas.drawRect(0f, peakY, w, (peakY + 2f).coerceAtMost(h), peakPaint)
+            return
+        }
+
         val bandWidth = (w - (spacing * (NUM_BANDS - 1))) / NUM_BANDS
         if (bandWidth <= 0) return
 
@@ -0,0 +1,39 @@
+/*
+ * native_test.h
+ *
+ * Checks for the native host tests. A failed check prints where it failed
+ * and the test goes on; main returns native_test_result().
+ */
+
+#ifndef NATIVE_TEST_H
+#define NATIVE_TEST_H
+
+#include <cstdio>
+
+static int gNativeTestFailures = 0;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      gNativeTestFailures++;                                                   \
+    }                                                                          \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                         \
+  do {                                                                         \
+    long long va = (long long)(a), vb = (long long)(b);                        \
+    if (va != vb) {                                                            \
+      fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n",        \
+              __FILE__, __LINE__, #a, #b, va, vb);                             \
+      gNativeTestFailures++;                                                   \
+    }                                                                          \
+  } while (0)
+
+static inline int native_test_result() {
+  if (gNativeTestFailures)
+    fprintf(stderr, "%d check(s) failed\n", gNativeTestFailures);
+  return gNativeTestFailures ? 1 : 0;
+}
+
+#endif // NATIVE_TEST_H
@@ -0,0 +1,295 @@
+/*
+ * transpose_test.cpp
+ *
+ * Shifts MIDI files and VGM clocks built in memory: which MIDI bytes move
+ * (running status, percussion, the RMID wrapper), which files are refused,
+ * and which VGM clock fields are rewritten.
+ */
+
+#include "native_test.h"
+#include "transpose.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// A format 1 Standard MIDI File, tracks appended one by one
+struct Smf {
+  std::vector<uint8_t> bytes;
+
+  Smf() {
+    add("MThd");
+    be32(6);
+    bytes.insert(bytes.end(), {0x00, 0x01, 0x00, 0x00, 0x00, 0x60});
+  }
+
+  void add(const char *tag) { bytes.insert(bytes.end(), tag, tag + 4); }
+
+  void be32(uint32_t v) {
+    for (int i = 3; i >= 0; i--)
+      bytes.push_back((uint8_t)(v >> (8 * i)));
+  }
+
+  // An MTrk chunk holding `events`; returns the offset of the first
+  size_t track(std::initializer_list<uint8_t> events) {
+    add("MTrk");
+    be32((uint32_t)events.size());
+    size_t at = bytes.size();
+    bytes.insert(bytes.end(), events);
+    bytes[11]++; // track count in MThd
+    return at;
+  }
+
+  bool transpose(int semitones, std::vector<uint8_t> *out) const {
+    return transpose_midi(bytes.data(), bytes.size(), semitones, out);
+  }
+};
+
+// A RIFF chunk header
+void chunk(std::vector<uint8_t> *riff, const char *tag, uint32_t size) {
+  riff->insert(riff->end(), tag, tag + 4);
+  for (int i = 0; i < 4; i++)
+    riff->push_back((uint8_t)(size >> (8 * i)));
+}
+
+// `smf` in a RIFF RMID file, after an odd-sized chunk that is padded
+std::vector<uint8_t> rmid(const std::vector<uint8_t> &smf) {
+  std::vector<uint8_t> riff;
+  chunk(&riff, "RIFF", (uint32_t)(4 + 12 + 8 + smf.size()));
+  riff.insert(riff.end(), {'R', 'M', 'I', 'D'});
+  chunk(&riff, "DISP", 3);
+  riff.insert(riff.end(), {1, 2, 3, 0});
+  chunk(&riff, "data", (uint32_t)smf.size());
+  riff.insert(riff.end(), smf.begin(), smf.end());
+  return riff;
+}
+
+void testRunningStatus() {
+  Smf smf;
+  size_t t = smf.track({
+      0x00, 0x90, 0x3C, 0x40, // note on C4
+      0x10, 0x40, 0x40,       // running status: note on E4
+      0x00, 0xB0, 0x07, 0x64, // volume, not a note
+      0x00, 0x50, 0x20,       // running status: still a controller
+      0x00, 0xC0, 0x05,       // program change, one data byte
+      0x00, 0x06,             // running status: another program
+      0x00, 0x80, 0x3C, 0x00, // note off C4
+      0x00, 0x40, 0x00,       // running status: note off E4
+      0x00, 0xA0, 0x3C, 0x10, // key pressure
+      0x00, 0xFF, 0x2F, 0x00, // end of track
+  });
+  std::vector<uint8_t> out;
+  CHECK(smf.transpose(2, &out));
+  CHECK_EQ(out.size(), smf.bytes.size());
+  if (out.size() != smf.bytes.size())
+    return;
+  const uint8_t *d = out.data() + t;
+  CHECK_EQ(d[2], 0x3E);
+  CHECK_EQ(d[3], 0x40); // velocity
+  CHECK_EQ(d[5], 0x42);
+  CHECK_EQ(d[9], 0x07);
+  CHECK_EQ(d[12], 0x50);
+  CHECK_EQ(d[16], 0x05);
+  CHECK_EQ(d[18], 0x06);
+  CHECK_EQ(d[21], 0x3E);
+  CHECK_EQ(d[24], 0x42);
+  CHECK_EQ(d[28], 0x3E);
+  CHECK_EQ(d[29], 0x10); // pressure
+
+  // The source is left alone
+  CHECK_EQ(smf.bytes[t + 2], 0x3C);
+}
+
+void testPercussion() {
+  Smf smf;
+  size_t t = smf.track({
+      0x00, 0x99, 0x24, 0x7F, // kick on channel 10
+      0x00, 0x26, 0x7F,       // running status: snare
+      0x00, 0x91, 0x24, 0x7F, // the same note on channel 2
+      0x00, 0x89, 0x24, 0x00, // kick off
+  });
+  std::vector<uint8_t> out;
+  CHECK(smf.transpose(-3, &out));
+  if (out.size() != smf.bytes.size())
+    return;
+  const uint8_t *d = out.data() + t;
+  CHECK_EQ(d[2], 0x24);
+  CHECK_EQ(d[5], 0x26);
+  CHECK_EQ(d[9], 0x21);
+  CHECK_EQ(d[13], 0x24);
+}
+
+void testRange() {
+  Smf smf;
+  size_t t = smf.track({
+      0x00, 0x90, 0x7D, 0x40, // 125
+      0x00, 0x90, 0x02, 0x40, // 2
+  });
+  std::vector<uint8_t> out;
+  CHECK(smf.transpose(5, &out));
+  if (out.size() == smf.bytes.size())
+    CHECK_EQ(out[t + 2], 0x7D + 5 - 12);
+  CHECK(smf.transpose(-5, &out));
+  if (out.size() == smf.bytes.size())
+    CHECK_EQ(out[t + 6], 0x02 - 5 + 12);
+}
+
+void testMetaAndSysex() {
+  Smf smf;
+  size_t t = smf.track({
+      0x00, 0xFF, 0x03, 0x02, 0x90, 0x3C, // track name that looks like a note
+      0x00, 0xF0, 0x03, 0x90, 0x3C, 0xF7, // sysex
+      0x00, 0x90, 0x3C, 0x40,
+  });
+  std::vector<uint8_t> out;
+  CHECK(smf.transpose(1, &out));
+  if (out.size() != smf.bytes.size())
+    return;
+  CHECK_EQ(out[t + 5], 0x3C);
+  CHECK_EQ(out[t + 10], 0x3C);
+  CHECK_EQ(out[t + 14], 0x3D);
+
+  // Meta events end running status
+  Smf cut;
+  cut.track({0x00, 0x90, 0x3C, 0x40, 0x00, 0xFF, 0x01, 0x00, 0x00, 0x3C,
+             0x40});
+  CHECK(!cut.transpose(1, &out));
+}
+
+void testRmid() {
+  Smf smf;
+  size_t t = smf.track({0x00, 0x90, 0x3C, 0x40, 0x00, 0x99, 0x24, 0x7F});
+  std::vector<uint8_t> riff = rmid(smf.bytes);
+  size_t at = riff.size() - smf.bytes.size();
+  std::vector<uint8_t> out;
+  CHECK(transpose_midi(riff.data(), riff.size(), 7, &out));
+  CHECK_EQ(out.size(), riff.size());
+  if (out.size() != riff.size())
+    return;
+  CHECK(memcmp(out.data(), riff.data(), at) == 0);
+  CHECK_EQ(out[at + t + 2], 0x43);
+  CHECK_EQ(out[at + t + 6], 0x24);
+
+  // A RIFF without a data chunk
+  std::vector<uint8_t> empty = rmid(smf.bytes);
+  memcpy(empty.data() + at - 8, "junk", 4);
+  CHECK(!transpose_midi(empty.data(), empty.size(), 7, &out));
+}
+
+void testMalformed() {
+  std::vector<uint8_t> out;
+  const uint8_t notMidi[16] = {'M', 'T', 'r', 'k'};
+  CHECK(!transpose_midi(notMidi, sizeof(notMidi), 1, &out));
+
+  // A header without tracks
+  Smf none;
+  CHECK(!none.transpose(1, &out));
+
+  // A data byte with no status before it
+  Smf orphan;
+  orphan.track({0x00, 0x3C, 0x40});
+  CHECK(!orphan.transpose(1, &out));
+
+  // A track longer than the file
+  Smf longer;
+  longer.track({0x00, 0x90, 0x3C, 0x40});
+  longer.bytes.pop_back();
+  CHECK(!longer.transpose(1, &out));
+
+  // A note cut short by the end of its track
+  Smf shorter;
+  shorter.track({0x00, 0x90, 0x3C});
+  CHECK(!shorter.transpose(1, &out));
+}
+
+// A VGM header of `version` whose stream starts at `dataStart`
+std::vector<uint8_t> vgmHeader(uint32_t version, uint32_t dataStart) {
+  std::vector<uint8_t> v(TRANSPOSE_VGM_HEADER_SIZE, 0);
+  memcpy(v.data(), "Vgm ", 4);
+  memcpy(v.data() + 0x08, &version, 4);
+  uint32_t rel = dataStart - 0x34;
+  if (version >= 0x150)
+    memcpy(v.data() + 0x34, &rel, 4);
+  return v;
+}
+
+uint32_t le32(const std::vector<uint8_t> &v, size_t at) {
+  uint32_t x;
+  memcpy(&x, v.data() + at, 4);
+  return x;
+}
+
+void setLe32(std::vector<uint8_t> *v, size_t at, uint32_t x) {
+  memcpy(v->data() + at, &x, 4);
+}
+
+void testVgmClocks() {
+  std::vector<uint8_t> header = vgmHeader(0x171, 0x100);
+  setLe32(&header, 0x0C, 3579545 | 0x40000000); // SN76489, NCR variant flag
+  setLe32(&header, 0x2C, 7670453);              // YM2612
+  setLe32(&header, 0x38, 0);                    // no SegaPCM
+  setLe32(&header, 0xE0, 3579545);              // GA20, the last field
+  std::vector<uint8_t> data = header;
+  data.resize(0x200, 0x66);
+
+  CHECK(transpose_vgm_clocks(data.data(), data.size(), header.data(),
+                             header.size(), 12));
+  CHECK_EQ(le32(data, 0x0C), (3579545 * 2) | 0x40000000);
+  CHECK_EQ(le32(data, 0x2C), 7670453 * 2);
+  CHECK_EQ(le32(data, 0x38), 0);
+  CHECK_EQ(le32(data, 0xE0), 3579545 * 2);
+  CHECK_EQ(data[0x100], 0x66);
+
+  // Always scaled from the untouched header, so shifts don't accumulate
+  CHECK(transpose_vgm_clocks(data.data(), data.size(), header.data(),
+                             header.size(), 1));
+  CHECK_EQ(le32(data, 0x2C),
+           (uint32_t)std::floor(7670453 * transpose_ratio(1) + 0.5));
+  CHECK(transpose_vgm_clocks(data.data(), data.size(), header.data(),
+                             header.size(), 0));
+  CHECK(memcmp(data.data(), header.data(), header.size()) == 0);
+}
+
+void testVgmHeaderEnd() {
+  // Commands right after 0x40: the fields past it are command bytes
+  std::vector<uint8_t> header = vgmHeader(0x171, 0x40);
+  setLe32(&header, 0x2C, 7670453);
+  setLe32(&header, 0x44, 3579545);
+  std::vector<uint8_t> data = header;
+  CHECK(transpose_vgm_clocks(data.data(), data.size(), header.data(),
+                             header.size(), 12));
+  CHECK_EQ(le32(data, 0x2C), 7670453 * 2);
+  CHECK_EQ(le32(data, 0x44), 3579545);
+
+  // Before 1.51 the clock list ends at the data offset field
+  std::vector<uint8_t> old = vgmHeader(0x150, 0x100);
+  setLe32(&old, 0x0C, 3579545);
+  setLe32(&old, 0x38, 8000000);
+  data = old;
+  CHECK(transpose_vgm_clocks(data.data(), data.size(), old.data(), old.size(),
+                             12));
+  CHECK_EQ(le32(data, 0x0C), 3579545 * 2);
+  CHECK_EQ(le32(data, 0x38), 8000000);
+
+  // Not a VGM
+  std::vector<uint8_t> other(0x100, 0);
+  CHECK(!transpose_vgm_clocks(other.data(), other.size(), other.data(),
+                              other.size(), 12));
+}
+
+} // namespace
+
+int main() {
+  CHECK(std::fabs(transpose_ratio(12) - 2.0) < 1e-12);
+  CHECK(std::fabs(transpose_ratio(-12) - 0.5) < 1e-12);
+  testRunningStatus();
+  testPercussion();
+  testRange();
+  testMetaAndSysex();
+  testRmid();
+  testMalformed();
+  testVgmClocks();
+  testVgmHeaderEnd();
+  return native_test_result();
+}